@@ -60,6 +60,7 @@ struct _CalendarWindowPrivate {
 	time_t      *current_time;
 
 	GtkWidget *locations_list;
+	GtkWidget *locations_expander;
 
 	GSettings  *settings;
 };
@@ -180,7 +181,8 @@ create_hig_frame (CalendarWindow *calwin,
 		  const char *title,
                   const char *button_label,
 		  const char *key,
-                  GCallback   callback)
+                  GCallback   callback,
+                  GtkWidget **expander_out)
 {
         GtkWidget *vbox;
         GtkWidget *label;
@@ -243,6 +245,9 @@ create_hig_frame (CalendarWindow *calwin,
 	g_settings_bind (calwin->priv->settings, key, expander, "expanded",
 			 G_SETTINGS_BIND_DEFAULT);
 
+        if (expander_out)
+                *expander_out = expander;
+
         return vbox;
 }
 
@@ -258,7 +263,8 @@ calendar_window_pack_locations (CalendarWindow *calwin, GtkWidget *vbox)
 	calwin->priv->locations_list = create_hig_frame (calwin,
 							 _("Locations"), _("Edit"),
 							 KEY_LOCATIONS_EXPANDED,
-							 G_CALLBACK (edit_locations));
+							 G_CALLBACK (edit_locations),
+							 &calwin->priv->locations_expander);
 
 	/* we show the widget before adding to the container, since adding to
 	 * the container changes the visibility depending on the state of the
@@ -306,6 +312,12 @@ calendar_window_get_locations_box (CalendarWindow *calwin)
 	return calwin->priv->locations_list;
 }
 
+GtkWidget *
+calendar_window_get_locations_expander (CalendarWindow *calwin)
+{
+	return calwin->priv->locations_expander;
+}
+
 static GObject *
 calendar_window_constructor (GType                  type,
 			     guint                  n_construct_properties,
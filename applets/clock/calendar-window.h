@@ -66,6 +66,7 @@ GtkWidget *calendar_window_new      (time_t     *static_current_time,
 void       calendar_window_refresh  (CalendarWindow *calwin);
 
 GtkWidget *calendar_window_get_locations_box (CalendarWindow *calwin);
+GtkWidget *calendar_window_get_locations_expander (CalendarWindow *calwin);
 
 gboolean   calendar_window_get_invert_order (CalendarWindow *calwin);
 void       calendar_window_set_invert_order (CalendarWindow *calwin,
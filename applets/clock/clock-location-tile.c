@@ -47,6 +47,7 @@ typedef struct {
         GtkSizeGroup *button_group;
 
         GtkWidget *weather_icon;
+        gchar *weather_icon_name;
 
         gulong location_weather_updated_id;
 } ClockLocationTilePrivate;
@@ -156,6 +157,9 @@ clock_location_tile_finalize (GObject *g_obj)
                 priv->current_group = NULL;
         }
 
+        g_free (priv->weather_icon_name);
+        priv->weather_icon_name = NULL;
+
         G_OBJECT_CLASS (clock_location_tile_parent_class)->finalize (g_obj);
 }
 
@@ -354,23 +358,21 @@ clock_location_tile_fill (ClockLocationTile *this)
 }
 
 static gboolean
-clock_needs_face_refresh (ClockLocationTile *this)
+clock_needs_face_refresh (ClockLocationTile *this,
+                          struct tm         *now)
 {
         ClockLocationTilePrivate *priv = PRIVATE (this);
-        struct tm now;
 
-        clock_location_localtime (priv->location, &now);
-
-        if (now.tm_year > priv->last_refresh.tm_year
-            || now.tm_mon > priv->last_refresh.tm_mon
-            || now.tm_mday > priv->last_refresh.tm_mday
-            || now.tm_hour > priv->last_refresh.tm_hour
-            || now.tm_min > priv->last_refresh.tm_min) {
+        if (now->tm_year != priv->last_refresh.tm_year
+            || now->tm_mon != priv->last_refresh.tm_mon
+            || now->tm_mday != priv->last_refresh.tm_mday
+            || now->tm_hour != priv->last_refresh.tm_hour
+            || now->tm_min != priv->last_refresh.tm_min) {
                 return TRUE;
         }
 
         if ((priv->size == CLOCK_FACE_LARGE)
-            && now.tm_sec > priv->last_refresh.tm_sec) {
+            && now->tm_sec != priv->last_refresh.tm_sec) {
                 return TRUE;
         }
 
@@ -378,20 +380,19 @@ clock_needs_face_refresh (ClockLocationTile *this)
 }
 
 static gboolean
-clock_needs_label_refresh (ClockLocationTile *this)
+clock_needs_label_refresh (ClockLocationTile *this,
+                           struct tm         *now,
+                           long               offset)
 {
         ClockLocationTilePrivate *priv = PRIVATE (this);
-        struct tm now;
-        long offset;
 
-        clock_location_localtime (priv->location, &now);
-        offset = clock_location_get_offset (priv->location);
-
-        if (now.tm_year > priv->last_refresh.tm_year
-            || now.tm_mon > priv->last_refresh.tm_mon
-            || now.tm_mday > priv->last_refresh.tm_mday
-            || now.tm_hour > priv->last_refresh.tm_hour
-            || now.tm_min > priv->last_refresh.tm_min
+        /* the label only shows minutes, so only a new minute (or a new
+         * UTC offset) changes it */
+        if (now->tm_year != priv->last_refresh.tm_year
+            || now->tm_mon != priv->last_refresh.tm_mon
+            || now->tm_mday != priv->last_refresh.tm_mday
+            || now->tm_hour != priv->last_refresh.tm_hour
+            || now->tm_min != priv->last_refresh.tm_min
             || offset != priv->last_offset) {
                 return TRUE;
         }
@@ -540,19 +541,21 @@ clock_location_tile_refresh (ClockLocationTile *this, gboolean force_refresh)
                 }
         }
 
-        if (clock_needs_face_refresh (this)) {
+        clock_location_localtime (priv->location, &now);
+        offset = clock_location_get_offset (priv->location);
+
+        if (clock_needs_face_refresh (this, &now)) {
                 clock_face_refresh (CLOCK_FACE (priv->clock_face));
         }
 
-        if (!force_refresh && !clock_needs_label_refresh (this)) {
+        if (!force_refresh && !clock_needs_label_refresh (this, &now, offset)) {
                 return;
         }
 
-        clock_location_localtime (priv->location, &now);
         tzname = clock_location_get_tzname (priv->location);
 
         copy_tm (&now, &(priv->last_refresh));
-        priv->last_offset = clock_location_get_offset (priv->location);
+        priv->last_offset = offset;
 
         tmp = g_strdup_printf ("<big><b>%s</b></big>",
                                clock_location_get_display_name (priv->location));
@@ -691,8 +694,13 @@ update_weather_icon (ClockLocation *loc, WeatherInfo *info, gpointer data)
         if (!info || !weather_info_is_valid (info))
                 return;
 
-        theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (priv->weather_icon)));
         icon_name = weather_info_get_icon_name (info);
+
+        /* weather updates mostly keep the same conditions */
+        if (g_strcmp0 (icon_name, priv->weather_icon_name) == 0)
+                return;
+
+        theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (priv->weather_icon)));
         icon_scale = gtk_widget_get_scale_factor (GTK_WIDGET (priv->weather_icon));
 
         surface = gtk_icon_theme_load_surface (theme, icon_name, 16, icon_scale,
@@ -701,6 +709,10 @@ update_weather_icon (ClockLocation *loc, WeatherInfo *info, gpointer data)
         if (surface) {
                 gtk_image_set_from_surface (GTK_IMAGE (priv->weather_icon), surface);
                 gtk_widget_set_margin_end (priv->weather_icon, 6);
+                cairo_surface_destroy (surface);
+
+                g_free (priv->weather_icon_name);
+                priv->weather_icon_name = g_strdup (icon_name);
         }
 }
 
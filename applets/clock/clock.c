@@ -157,6 +157,8 @@ struct _ClockData {
         /* Locations */
         GList *locations;
         GList *location_tiles;
+        /* the tiles are only built once the locations are expanded */
+        gboolean location_tiles_pending;
 
         /* runtime data */
         time_t             current_time;
@@ -509,6 +511,10 @@ update_location_tiles (ClockData *cd)
 {
         GList *l;
 
+        /* hidden tiles are brought up to date when they are mapped again */
+        if (!cd->cities_section || !gtk_widget_get_mapped (cd->cities_section))
+                return;
+
         for (l = cd->location_tiles; l; l = l->next) {
                 ClockLocationTile *tile;
 
@@ -1101,12 +1107,20 @@ location_tile_need_clock_format_cb(ClockLocationTile *tile, gpointer data)
         return cd->format;
 }
 
+static void
+cities_section_map_cb (GtkWidget *widget,
+                       ClockData *cd)
+{
+        update_location_tiles (cd);
+}
+
 static void
 create_cities_section (ClockData *cd)
 {
         GList *node;
         ClockLocationTile *city;
         GList *cities;
+        GtkWidget *expander;
 
         if (cd->cities_section) {
                 gtk_widget_destroy (cd->cities_section);
@@ -1117,6 +1131,15 @@ create_cities_section (ClockData *cd)
                 g_list_free (cd->location_tiles);
         cd->location_tiles = NULL;
 
+        /* Each tile formats its time and loads its weather icon, which adds
+         * up with many locations; don't build them until they are shown */
+        expander = calendar_window_get_locations_expander (CALENDAR_WINDOW (cd->calendar_popup));
+        if (!gtk_expander_get_expanded (GTK_EXPANDER (expander))) {
+                cd->location_tiles_pending = TRUE;
+                return;
+        }
+        cd->location_tiles_pending = FALSE;
+
         cd->cities_section = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
         gtk_container_set_border_width (GTK_CONTAINER (cd->cities_section), 0);
 
@@ -1158,9 +1181,21 @@ create_cities_section (ClockData *cd)
         gtk_box_pack_end (GTK_BOX (cd->clock_vbox),
                           cd->cities_section, FALSE, FALSE, 0);
 
+        g_signal_connect (cd->cities_section, "map",
+                          G_CALLBACK (cities_section_map_cb), cd);
+
         gtk_widget_show_all (cd->cities_section);
 }
 
+static void
+locations_expanded_cb (GtkExpander *expander,
+                       GParamSpec  *pspec,
+                       ClockData   *cd)
+{
+        if (cd->location_tiles_pending && gtk_expander_get_expanded (expander))
+                create_cities_section (cd);
+}
+
 static GList *
 map_need_locations_cb (ClockMap *map, gpointer data)
 {
@@ -1197,6 +1232,8 @@ create_map_section (ClockData *cd)
 static void
 update_calendar_popup (ClockData *cd)
 {
+        gint64 start;
+
         if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (cd->panel_button))) {
                 if (cd->calendar_popup) {
                         gtk_widget_destroy (cd->calendar_popup);
@@ -1213,6 +1250,8 @@ update_calendar_popup (ClockData *cd)
                 return;
         }
 
+        start = g_get_monotonic_time ();
+
         if (!cd->calendar_popup) {
                 cd->calendar_popup = create_calendar (cd);
                 g_object_add_weak_pointer (G_OBJECT (cd->calendar_popup),
@@ -1223,6 +1262,10 @@ update_calendar_popup (ClockData *cd)
                 create_cities_store (cd);
                 create_cities_section (cd);
                 create_map_section (cd);
+
+                g_signal_connect (calendar_window_get_locations_expander (CALENDAR_WINDOW (cd->calendar_popup)),
+                                  "notify::expanded",
+                                  G_CALLBACK (locations_expanded_cb), cd);
         }
 
         if (cd->calendar_popup && gtk_widget_get_realized (cd->panel_button)) {
@@ -1230,6 +1273,10 @@ update_calendar_popup (ClockData *cd)
                 position_calendar_popup (cd);
                 gtk_window_present (GTK_WINDOW (cd->calendar_popup));
         }
+
+        g_debug ("Calendar popup opened in %.1f ms (%u location tiles)",
+                 (g_get_monotonic_time () - start) / 1000.0,
+                 g_list_length (cd->location_tiles));
 }
 
 static void
@@ -3321,7 +3368,7 @@ clock_factory (MatePanelApplet *applet,
         return retval;
 }
 
-#ifdef CLOCK_INPROCESS
+#if defined(CLOCK_INPROCESS) || defined(CLOCK_SHARED_HOST)
 MATE_PANEL_APPLET_IN_PROCESS_FACTORY ("ClockAppletFactory",
                                  PANEL_TYPE_APPLET,
                                  "ClockApplet",
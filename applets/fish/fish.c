@@ -30,6 +30,7 @@
 #include <math.h>
 #include <string.h>
 #include <time.h>
+#include <sys/resource.h>
 
 #include <cairo.h>
 
@@ -39,6 +40,11 @@
 #include <gdk/gdkkeysyms.h>
 #include <gio/gio.h>
 
+#ifdef HAVE_X11
+#include <gdk/gdkx.h>
+#include <X11/Xlib.h>
+#endif
+
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
 
@@ -58,9 +64,25 @@
 #define FISH_SPEED_KEY   "speed"
 #define FISH_ROTATE_KEY  "rotate"
 
+/* Number of pre-scaled animation strips kept around, so that going back
+ * and forth between panel sizes or orientations doesn't rescale them */
+#define FISH_ATLAS_CACHE_SIZE 4
+
+/* How often the frame rate and CPU usage are reported, in seconds */
+#define FISH_STATS_INTERVAL 10
+
 #define LOCKDOWN_SCHEMA                       "org.mate.lockdown"
 #define LOCKDOWN_DISABLE_COMMAND_LINE_KEY     "disable-command-line"
 
+typedef struct {
+	gint                   width;
+	gint                   height;
+	gboolean               rotate;
+	MatePanelAppletOrient  orientation;
+	gboolean               april_fools;
+	cairo_surface_t       *surface;
+} FishAtlas;
+
 typedef struct {
 	MatePanelApplet        applet;
 
@@ -83,9 +105,17 @@ typedef struct {
 	cairo_surface_t   *surface;
 	gint               surface_width;
 	gint               surface_height;
+	GList             *atlases;
 
 	guint              timeout;
 	int                current_frame;
+	gint64             anim_start;
+	gboolean           hidden;
+	GdkWindow         *panel_window;
+
+	guint              stats_frames;
+	gint64             stats_start;
+	gint64             stats_cpu_start;
 	gboolean           in_applet;
 
 	GdkPixbuf         *pixbuf;
@@ -119,6 +149,7 @@ typedef struct {
 
 static gboolean load_fish_image          (FishApplet *fish);
 static void     update_pixmap            (FishApplet *fish);
+static void     fish_atlas_clear         (FishApplet *fish);
 static void     something_fishy_going_on (FishApplet *fish, const char *message);
 static void     display_fortune_dialog   (FishApplet *fish);
 static void     set_tooltip              (FishApplet *fish);
@@ -1193,34 +1224,215 @@ static void check_april_fools(FishApplet* fish)
 	}
 }
 
+static gint64 get_frame_interval(FishApplet *fish)
+{
+	return MAX ((gint64) (fish->speed * G_USEC_PER_SEC), 1000);
+}
+
+static gint64 get_frame_time(FishApplet *fish)
+{
+	GdkFrameClock *clock;
+
+	clock = gtk_widget_get_frame_clock (fish->drawing_area);
+	if (!clock)
+		return g_get_monotonic_time ();
+
+	return gdk_frame_clock_get_frame_time (clock);
+}
+
 static gboolean timeout_handler(gpointer data)
 {
 	FishApplet *fish = (FishApplet *) data;
+	int         frame;
 
 	check_april_fools (fish);
 
 	if (fish->april_fools)
 		return TRUE;
 
-	fish->current_frame++;
-	if (fish->current_frame >= fish->n_frames)
-		fish->current_frame = 0;
+	/* Frames follow the frame clock rather than counting wakeups, so a
+	 * late timeout doesn't slow the fish down */
+	frame = ((get_frame_time (fish) - fish->anim_start) / get_frame_interval (fish)) % fish->n_frames;
+	if (frame == fish->current_frame)
+		return TRUE;
 
+	fish->current_frame = frame;
 	gtk_widget_queue_draw (fish->drawing_area);
 
 	return TRUE;
 }
 
-static void setup_timeout(FishApplet *fish)
+static void stop_timeout(FishApplet *fish)
 {
 	if (fish->timeout)
 		g_source_remove (fish->timeout);
+	fish->timeout = 0;
+}
 
-	fish->timeout = g_timeout_add (fish->speed * 1000,
+static void setup_timeout(FishApplet *fish)
+{
+	stop_timeout (fish);
+
+	/* Nothing to animate until the fish is shown */
+	if (!fish->drawing_area || !gtk_widget_get_mapped (fish->drawing_area))
+		return;
+
+	if (fish->hidden)
+		return;
+
+	/* Resume from the frame that is currently shown */
+	fish->anim_start = get_frame_time (fish) - fish->current_frame * get_frame_interval (fish);
+
+	fish->timeout = g_timeout_add (get_frame_interval (fish) / 1000,
 				       timeout_handler,
 				       fish);
 }
 
+/* An autohidden panel keeps the applet mapped, but moves it off the
+ * monitor: the fish counts as hidden as soon as it isn't entirely on its
+ * monitor. This is only checked when the panel window moves. */
+static void update_hidden(FishApplet *fish)
+{
+	GdkWindow    *window;
+	GdkMonitor   *monitor;
+	GdkRectangle  monitor_geom;
+	GdkRectangle  area;
+	GdkRectangle  visible;
+	gboolean      hidden;
+
+	window = gtk_widget_get_window (fish->drawing_area);
+	if (!window)
+		return;
+
+	gdk_window_get_origin (window, &area.x, &area.y);
+	area.width  = gdk_window_get_width (window);
+	area.height = gdk_window_get_height (window);
+
+	monitor = gdk_display_get_monitor_at_window (gtk_widget_get_display (fish->drawing_area),
+						     window);
+	gdk_monitor_get_geometry (monitor, &monitor_geom);
+
+	hidden = !gdk_rectangle_intersect (&area, &monitor_geom, &visible) ||
+		 visible.width != area.width || visible.height != area.height;
+
+	if (hidden == fish->hidden)
+		return;
+
+	fish->hidden = hidden;
+
+	if (hidden)
+		stop_timeout (fish);
+	else {
+		/* Don't count the time spent hidden in the frame rate */
+		fish->stats_start = 0;
+		setup_timeout (fish);
+	}
+}
+
+#ifdef HAVE_X11
+static GdkFilterReturn panel_window_filter(GdkXEvent* gdk_xevent, GdkEvent* event, FishApplet* fish)
+{
+	XEvent *xevent = (XEvent *) gdk_xevent;
+
+	if (xevent->type == ConfigureNotify)
+		update_hidden (fish);
+
+	return GDK_FILTER_CONTINUE;
+}
+
+/* The panel moves its own toplevel when it hides; the fish may live in a
+ * plug of another process, so follow the window that is a child of the
+ * root window rather than our own toplevel. */
+static void watch_panel_window(FishApplet* fish)
+{
+	GdkDisplay *display;
+	Display    *xdisplay;
+	GtkWidget  *toplevel;
+	Window      xwindow;
+	Window      root;
+	Window      parent;
+	Window     *children;
+	guint       n_children;
+
+	display = gtk_widget_get_display (fish->drawing_area);
+	if (!GDK_IS_X11_DISPLAY (display))
+		return;
+
+	xdisplay = GDK_DISPLAY_XDISPLAY (display);
+	toplevel = gtk_widget_get_toplevel (fish->drawing_area);
+	xwindow = GDK_WINDOW_XID (gtk_widget_get_window (toplevel));
+
+	gdk_x11_display_error_trap_push (display);
+	for (;;) {
+		children = NULL;
+		if (!XQueryTree (xdisplay, xwindow, &root, &parent,
+				 &children, &n_children)) {
+			xwindow = None;
+			break;
+		}
+
+		if (children)
+			XFree (children);
+
+		if (parent == root || parent == None)
+			break;
+
+		xwindow = parent;
+	}
+	gdk_x11_display_error_trap_pop_ignored (display);
+
+	if (xwindow == None)
+		return;
+
+	fish->panel_window = gdk_x11_window_foreign_new_for_display (display, xwindow);
+	if (!fish->panel_window)
+		return;
+
+	gdk_window_set_events (fish->panel_window,
+			       gdk_window_get_events (fish->panel_window) | GDK_STRUCTURE_MASK);
+	gdk_window_add_filter (fish->panel_window,
+			       (GdkFilterFunc) panel_window_filter,
+			       fish);
+}
+#endif
+
+static void unwatch_panel_window(FishApplet* fish)
+{
+#ifdef HAVE_X11
+	if (!fish->panel_window)
+		return;
+
+	gdk_window_remove_filter (fish->panel_window,
+				  (GdkFilterFunc) panel_window_filter,
+				  fish);
+	g_object_unref (fish->panel_window);
+	fish->panel_window = NULL;
+#endif
+}
+
+static void fish_applet_map(GtkWidget* widget, FishApplet* fish)
+{
+	/* Don't count the time spent unmapped in the frame rate */
+	fish->stats_start = 0;
+
+#ifdef HAVE_X11
+	unwatch_panel_window (fish);
+	watch_panel_window (fish);
+#endif
+
+	fish->hidden = FALSE;
+	if (fish->panel_window)
+		update_hidden (fish);
+
+	setup_timeout (fish);
+}
+
+static void fish_applet_unmap(GtkWidget* widget, FishApplet* fish)
+{
+	unwatch_panel_window (fish);
+	stop_timeout (fish);
+}
+
 static void speed_changed_notify(GSettings* settings, gchar* key, FishApplet* fish)
 {
 	gdouble value;
@@ -1330,6 +1542,8 @@ static gboolean load_fish_image(FishApplet* fish)
 		g_object_unref (fish->pixbuf);
 	fish->pixbuf = pixbuf;
 
+	fish_atlas_clear (fish);
+
 	if (fish->preview_image)
 		gtk_image_set_from_pixbuf (GTK_IMAGE (fish->preview_image),
 					   fish->pixbuf);
@@ -1339,6 +1553,66 @@ static gboolean load_fish_image(FishApplet* fish)
 	return TRUE;
 }
 
+static void fish_atlas_free(FishAtlas *atlas)
+{
+	cairo_surface_destroy (atlas->surface);
+	g_free (atlas);
+}
+
+static void fish_atlas_clear(FishApplet* fish)
+{
+	g_list_free_full (fish->atlases, (GDestroyNotify) fish_atlas_free);
+	fish->atlases = NULL;
+
+	fish->surface = NULL;
+	fish->surface_width = 0;
+	fish->surface_height = 0;
+}
+
+static FishAtlas *fish_atlas_lookup(FishApplet* fish, int width, int height, gboolean rotate)
+{
+	GList *l;
+
+	for (l = fish->atlases; l; l = l->next) {
+		FishAtlas *atlas = l->data;
+
+		if (atlas->width == width &&
+		    atlas->height == height &&
+		    atlas->rotate == rotate &&
+		    (!rotate || atlas->orientation == fish->orientation) &&
+		    atlas->april_fools == fish->april_fools) {
+			/* Most recently used first */
+			fish->atlases = g_list_remove_link (fish->atlases, l);
+			fish->atlases = g_list_concat (l, fish->atlases);
+			return atlas;
+		}
+	}
+
+	return NULL;
+}
+
+static void fish_atlas_insert(FishApplet* fish, int width, int height, gboolean rotate, cairo_surface_t *surface)
+{
+	FishAtlas *atlas;
+
+	atlas = g_new0 (FishAtlas, 1);
+	atlas->width = width;
+	atlas->height = height;
+	atlas->rotate = rotate;
+	atlas->orientation = fish->orientation;
+	atlas->april_fools = fish->april_fools;
+	atlas->surface = surface;
+
+	fish->atlases = g_list_prepend (fish->atlases, atlas);
+
+	if (g_list_length (fish->atlases) > FISH_ATLAS_CACHE_SIZE) {
+		GList *last = g_list_last (fish->atlases);
+
+		fish_atlas_free (last->data);
+		fish->atlases = g_list_delete_link (fish->atlases, last);
+	}
+}
+
 static gboolean
 update_pixmap_in_idle (gpointer data)
 {
@@ -1351,6 +1625,7 @@ static void update_pixmap(FishApplet* fish)
 	GtkWidget     *widget = fish->drawing_area;
 	GtkRequisition prev_requisition;
 	GtkAllocation  allocation;
+	FishAtlas     *atlas;
 	int            width  = -1;
 	int            height = -1;
 	int            pixbuf_width = -1;
@@ -1412,13 +1687,22 @@ static void update_pixmap(FishApplet* fish)
 	if (width == 0 || height == 0)
 		return;
 
-	if (fish->surface)
-		cairo_surface_destroy (fish->surface);
+	atlas = fish_atlas_lookup (fish, width, height, rotate);
+	if (atlas) {
+		fish->surface = atlas->surface;
+		fish->surface_width = width;
+		fish->surface_height = height;
+
+		gtk_widget_queue_resize (widget);
+		return;
+	}
+
 	fish->surface = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
 													   CAIRO_CONTENT_COLOR_ALPHA,
 													   width, height);
 	fish->surface_width = width;
 	fish->surface_height = height;
+	fish_atlas_insert (fish, width, height, rotate, fish->surface);
 
 	gtk_widget_queue_resize (widget);
 
@@ -1471,6 +1755,48 @@ static void update_pixmap(FishApplet* fish)
 	cairo_destroy (cr);
 }
 
+static gint64 get_cpu_time(void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+	       usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/* The fish redraws steadily, which makes it a cheap way to notice when
+ * the panel gets slower at drawing. The CPU time is that of the whole
+ * applet process. */
+static void fish_update_stats(FishApplet* fish)
+{
+	gint64 now;
+	gint64 elapsed;
+
+	now = g_get_monotonic_time ();
+
+	if (fish->stats_start == 0) {
+		fish->stats_start = now;
+		fish->stats_cpu_start = get_cpu_time ();
+		fish->stats_frames = 0;
+		return;
+	}
+
+	fish->stats_frames++;
+
+	elapsed = now - fish->stats_start;
+	if (elapsed < FISH_STATS_INTERVAL * G_USEC_PER_SEC)
+		return;
+
+	g_debug ("%s the Fish: %.2f frames/s, %.1f%% CPU",
+		 fish->name,
+		 fish->stats_frames * (gdouble) G_USEC_PER_SEC / elapsed,
+		 (get_cpu_time () - fish->stats_cpu_start) * 100.0 / elapsed);
+
+	fish->stats_start = 0;
+}
+
 static gboolean fish_applet_draw(GtkWidget* widget, cairo_t *cr, FishApplet* fish)
 {
 	int width, height;
@@ -1500,6 +1826,8 @@ static gboolean fish_applet_draw(GtkWidget* widget, cairo_t *cr, FishApplet* fis
 	cairo_paint (cr);
 	cairo_restore (cr);
 
+	fish_update_stats (fish);
+
         return FALSE;
 }
 
@@ -1521,11 +1849,7 @@ static void fish_applet_realize(GtkWidget* widget, FishApplet* fish)
 
 static void fish_applet_unrealize(GtkWidget* widget, FishApplet* fish)
 {
-	if (fish->surface)
-		cairo_surface_destroy (fish->surface);
-	fish->surface = NULL;
-	fish->surface_width = 0;
-	fish->surface_height = 0;
+	fish_atlas_clear (fish);
 }
 
 static void fish_applet_change_orient(MatePanelApplet* applet, MatePanelAppletOrient orientation)
@@ -1659,6 +1983,10 @@ static void setup_fish_widget(FishApplet* fish)
 			  G_CALLBACK (fish_applet_size_allocate), fish);
 	g_signal_connect (fish->drawing_area, "draw",
 			  G_CALLBACK (fish_applet_draw), fish);
+	g_signal_connect (fish->drawing_area, "map",
+			  G_CALLBACK (fish_applet_map), fish);
+	g_signal_connect (fish->drawing_area, "unmap",
+			  G_CALLBACK (fish_applet_unmap), fish);
 
 	gtk_widget_add_events (widget, GDK_ENTER_NOTIFY_MASK |
 				       GDK_LEAVE_NOTIFY_MASK |
@@ -1788,6 +2116,8 @@ static void fish_applet_dispose (GObject *object)
 
 	fish->timeout = 0;
 
+	unwatch_panel_window (fish);
+
 	if (fish->settings)
 		g_object_unref (fish->settings);
 	fish->settings = NULL;
@@ -1808,11 +2138,7 @@ static void fish_applet_dispose (GObject *object)
 		g_free (fish->command);
 	fish->command = NULL;
 
-	if (fish->surface)
-		cairo_surface_destroy (fish->surface);
-	fish->surface = NULL;
-	fish->surface_width = 0;
-	fish->surface_height = 0;
+	fish_atlas_clear (fish);
 
 	if (fish->pixbuf)
 		g_object_unref (fish->pixbuf);
@@ -1849,8 +2175,11 @@ static void fish_applet_instance_init(FishApplet* fish, FishAppletClass* klass)
 	fish->frame         = NULL;
 	fish->drawing_area  = NULL;
 	fish->surface       = NULL;
+	fish->atlases       = NULL;
 	fish->timeout       = 0;
 	fish->current_frame = 0;
+	fish->hidden        = FALSE;
+	fish->panel_window  = NULL;
 	fish->in_applet     = FALSE;
 
 	fish->requisition.width  = -1;
@@ -1926,7 +2255,7 @@ static GType fish_applet_get_type(void)
 	return type;
 }
 
-#ifdef FISH_INPROCESS
+#if defined(FISH_INPROCESS) || defined(FISH_SHARED_HOST)
 	MATE_PANEL_APPLET_IN_PROCESS_FACTORY("FishAppletFactory", fish_applet_get_type(), "That-stupid-fish", fishy_factory, NULL)
 #else
 	MATE_PANEL_APPLET_OUT_PROCESS_FACTORY("FishAppletFactory", fish_applet_get_type(), "That-stupid-fish", fishy_factory, NULL)
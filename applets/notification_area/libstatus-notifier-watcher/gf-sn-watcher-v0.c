@@ -25,8 +25,15 @@ struct _GfSnWatcherV0
 
   guint                     bus_name_id;
 
-  GSList                   *hosts;
-  GSList                   *items;
+  /* bus name + object path -> GfWatch */
+  GHashTable               *hosts;
+  GHashTable               *items;
+
+  /* Value of RegisteredStatusNotifierItems, in registration order; the
+   * strings belong to the item watches */
+  GQueue                    registered_items;
+  guint                     update_items_id;
+  guint                     n_item_changes;
 };
 
 typedef enum
@@ -43,7 +50,11 @@ typedef struct
   gchar         *service;
   gchar         *bus_name;
   gchar         *object_path;
+  gchar         *id;
   guint          watch_id;
+
+  /* Link in registered_items, for items */
+  GList         *link;
 } GfWatch;
 
 static void gf_sn_watcher_v0_gen_init (GfSnWatcherV0GenIface *iface);
@@ -51,34 +62,69 @@ static void gf_sn_watcher_v0_gen_init (GfSnWatcherV0GenIface *iface);
 G_DEFINE_TYPE_WITH_CODE (GfSnWatcherV0, gf_sn_watcher_v0, GF_TYPE_SN_WATCHER_V0_GEN_SKELETON,
                          G_IMPLEMENT_INTERFACE (GF_TYPE_SN_WATCHER_V0_GEN, gf_sn_watcher_v0_gen_init))
 
+static gboolean
+update_registered_items_cb (gpointer user_data)
+{
+  GfSnWatcherV0 *v0;
+  const gchar **items;
+  GList *l;
+  guint i;
+
+  v0 = GF_SN_WATCHER_V0 (user_data);
+  v0->update_items_id = 0;
+
+  items = g_new (const gchar *, v0->registered_items.length + 1);
+  for (l = v0->registered_items.head, i = 0; l != NULL; l = l->next, i++)
+    items[i] = l->data;
+  items[i] = NULL;
+
+  gf_sn_watcher_v0_gen_set_registered_items (GF_SN_WATCHER_V0_GEN (v0),
+                                             (const gchar * const *) items);
+  g_free (items);
+
+  g_debug ("RegisteredStatusNotifierItems updated: %u items, %u changes",
+           v0->registered_items.length, v0->n_item_changes);
+  v0->n_item_changes = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Setting the property copies and compares the whole list, so a burst of
+ * registrations (at login, or when a host restarts) only sets it once.
+ * Method calls already queued are dispatched before the idle, later ones
+ * after it, so callers never see an outdated value once they got a
+ * reply. */
 static void
 update_registered_items (GfSnWatcherV0 *v0)
 {
-  GVariantBuilder builder;
-  GSList *l;
-  GVariant *variant;
-  const gchar **items;
+  v0->n_item_changes++;
 
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+  if (v0->update_items_id == 0)
+    v0->update_items_id = g_idle_add_full (G_PRIORITY_DEFAULT,
+                                           update_registered_items_cb,
+                                           v0, NULL);
+}
 
-  for (l = v0->items; l != NULL; l = g_slist_next (l))
-    {
-      GfWatch *watch;
-      gchar *item;
+static void
+add_registered_item (GfSnWatcherV0 *v0,
+                     GfWatch       *watch)
+{
+  g_queue_push_tail (&v0->registered_items, watch->id);
+  watch->link = v0->registered_items.tail;
 
-      watch = (GfWatch *) l->data;
+  update_registered_items (v0);
+}
 
-      item = g_strdup_printf ("%s%s", watch->bus_name, watch->object_path);
-      g_variant_builder_add (&builder, "s", item);
-      g_free (item);
-    }
+static void
+remove_registered_item (GfSnWatcherV0 *v0,
+                        GfWatch       *watch)
+{
+  g_assert (watch->link != NULL && watch->link->data == watch->id);
 
-  variant = g_variant_builder_end (&builder);
-  items = g_variant_get_strv (variant, NULL);
+  g_queue_delete_link (&v0->registered_items, watch->link);
+  watch->link = NULL;
 
-  gf_sn_watcher_v0_gen_set_registered_items (GF_SN_WATCHER_V0_GEN (v0), items);
-  g_variant_unref (variant);
-  g_free (items);
+  update_registered_items (v0);
 }
 
 static void
@@ -94,6 +140,7 @@ gf_watch_free (gpointer data)
   g_free (watch->service);
   g_free (watch->bus_name);
   g_free (watch->object_path);
+  g_free (watch->id);
 
   g_free (watch);
 }
@@ -113,9 +160,9 @@ name_vanished_cb (GDBusConnection *connection,
 
   if (watch->type == GF_WATCH_TYPE_HOST)
     {
-      v0->hosts = g_slist_remove (v0->hosts, watch);
+      g_hash_table_remove (v0->hosts, watch->id);
 
-      if (v0->hosts == NULL)
+      if (g_hash_table_size (v0->hosts) == 0)
         {
           gf_sn_watcher_v0_gen_set_is_host_registered (gen, FALSE);
           gf_sn_watcher_v0_gen_emit_host_registered (gen);
@@ -123,22 +170,17 @@ name_vanished_cb (GDBusConnection *connection,
     }
   else if (watch->type == GF_WATCH_TYPE_ITEM)
     {
-      gchar *tmp;
-
-      v0->items = g_slist_remove (v0->items, watch);
+      remove_registered_item (v0, watch);
 
-      update_registered_items (v0);
+      gf_sn_watcher_v0_gen_emit_item_unregistered (gen, watch->id);
 
-      tmp = g_strdup_printf ("%s%s", watch->bus_name, watch->object_path);
-      gf_sn_watcher_v0_gen_emit_item_unregistered (gen, tmp);
-      g_free (tmp);
+      /* This frees the watch */
+      g_hash_table_remove (v0->items, watch->id);
     }
   else
     {
       g_assert_not_reached ();
     }
-
-  gf_watch_free (watch);
 }
 
 static GfWatch *
@@ -158,6 +200,7 @@ gf_watch_new (GfSnWatcherV0 *v0,
   watch->service = g_strdup (service);
   watch->bus_name = g_strdup (bus_name);
   watch->object_path = g_strdup (object_path);
+  watch->id = g_strdup_printf ("%s%s", bus_name, object_path);
   watch->watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION, bus_name,
                                       G_BUS_NAME_WATCHER_FLAGS_NONE, NULL,
                                       name_vanished_cb, watch, NULL);
@@ -166,26 +209,18 @@ gf_watch_new (GfSnWatcherV0 *v0,
 }
 
 static GfWatch *
-gf_watch_find (GSList      *list,
+gf_watch_find (GHashTable  *table,
                const gchar *bus_name,
                const gchar *object_path)
 {
-  GSList *l;
-
-  for (l = list; l != NULL; l = g_slist_next (l))
-    {
-      GfWatch *watch;
+  GfWatch *watch;
+  gchar *id;
 
-      watch = (GfWatch *) l->data;
+  id = g_strdup_printf ("%s%s", bus_name, object_path);
+  watch = g_hash_table_lookup (table, id);
+  g_free (id);
 
-      if (g_strcmp0 (watch->bus_name, bus_name) == 0 &&
-          g_strcmp0 (watch->object_path, object_path) == 0)
-        {
-          return watch;
-        }
-    }
-
-  return NULL;
+  return watch;
 }
 
 static gboolean
@@ -234,7 +269,7 @@ gf_sn_watcher_v0_handle_register_host (GfSnWatcherV0Gen      *object,
     }
 
   watch = gf_watch_new (v0, GF_WATCH_TYPE_HOST, service, bus_name, object_path);
-  v0->hosts = g_slist_prepend (v0->hosts, watch);
+  g_hash_table_insert (v0->hosts, watch->id, watch);
 
   if (!gf_sn_watcher_v0_gen_get_is_host_registered (object))
     {
@@ -256,7 +291,6 @@ gf_sn_watcher_v0_handle_register_item (GfSnWatcherV0Gen      *object,
   const gchar *bus_name;
   const gchar *object_path;
   GfWatch *watch;
-  gchar *tmp;
 
   v0 = GF_SN_WATCHER_V0 (object);
 
@@ -308,13 +342,11 @@ gf_sn_watcher_v0_handle_register_item (GfSnWatcherV0Gen      *object,
     }
 
   watch = gf_watch_new (v0, GF_WATCH_TYPE_ITEM, service, bus_name, object_path);
-  v0->items = g_slist_prepend (v0->items, watch);
+  g_hash_table_insert (v0->items, watch->id, watch);
 
-  update_registered_items (v0);
+  add_registered_item (v0, watch);
 
-  tmp = g_strdup_printf ("%s%s", bus_name, object_path);
-  gf_sn_watcher_v0_gen_emit_item_registered (object, tmp);
-  g_free (tmp);
+  gf_sn_watcher_v0_gen_emit_item_registered (object, watch->id);
 
   gf_sn_watcher_v0_gen_complete_register_item (object, invocation);
 
@@ -365,17 +397,18 @@ gf_sn_watcher_v0_dispose (GObject *object)
       v0->bus_name_id = 0;
     }
 
-  if (v0->hosts != NULL)
+  if (v0->update_items_id > 0)
     {
-      g_slist_free_full (v0->hosts, gf_watch_free);
-      v0->hosts = NULL;
+      g_source_remove (v0->update_items_id);
+      v0->update_items_id = 0;
     }
 
-  if (v0->items != NULL)
-    {
-      g_slist_free_full (v0->items, gf_watch_free);
-      v0->items = NULL;
-    }
+  g_clear_pointer (&v0->hosts, g_hash_table_destroy);
+
+  /* The queue borrows its strings from the item watches */
+  g_queue_clear (&v0->registered_items);
+
+  g_clear_pointer (&v0->items, g_hash_table_destroy);
 
   G_OBJECT_CLASS (gf_sn_watcher_v0_parent_class)->dispose (object);
 }
@@ -395,6 +428,12 @@ gf_sn_watcher_v0_init (GfSnWatcherV0 *v0)
 {
   GBusNameOwnerFlags flags;
 
+  v0->hosts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     NULL, gf_watch_free);
+  v0->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     NULL, gf_watch_free);
+  g_queue_init (&v0->registered_items);
+
   flags = G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
           G_BUS_NAME_OWNER_FLAGS_REPLACE;
 
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Registers and unregisters thousands of fake StatusNotifierItems with a
+ * watcher running on a private bus, checks RegisteredStatusNotifierItems
+ * along the way and prints how long each phase took.
+ *
+ * Items are spread over several client connections; an item goes away
+ * when the connection that registered it is closed, as it does when an
+ * application quits.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gf-sn-watcher-v0.h"
+
+#define WATCHER_NAME      "org.kde.StatusNotifierWatcher"
+#define WATCHER_PATH      "/StatusNotifierWatcher"
+#define WATCHER_INTERFACE "org.kde.StatusNotifierWatcher"
+
+/* Give up if the watcher doesn't catch up within this many seconds */
+#define TIMEOUT 120
+
+static gint n_clients = 20;
+static gint n_items = 250;
+
+static GOptionEntry entries[] =
+{
+  { "clients", 0, 0, G_OPTION_ARG_INT, &n_clients,
+    "Number of client connections (default: 20)", "N" },
+  { "items", 0, 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items registered by each client (default: 250)", "N" },
+  { NULL }
+};
+
+static guint n_pending = 0;
+static gboolean failed = FALSE;
+
+static void
+register_item_cb (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  GVariant *ret;
+  GError *error = NULL;
+
+  ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+                                       result, &error);
+  if (ret == NULL)
+    {
+      g_printerr ("RegisterStatusNotifierItem failed: %s\n", error->message);
+      g_error_free (error);
+      failed = TRUE;
+    }
+  else
+    g_variant_unref (ret);
+
+  n_pending--;
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+  gboolean *timed_out = user_data;
+
+  *timed_out = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+static guint
+count_registered_items (GfSnWatcherV0 *watcher)
+{
+  const gchar * const *items;
+
+  items = gf_sn_watcher_v0_gen_get_registered_items (GF_SN_WATCHER_V0_GEN (watcher));
+
+  return items ? g_strv_length ((gchar **) items) : 0;
+}
+
+/* Iterates the main context until there are no pending calls and the
+ * watcher publishes @n_expected items */
+static gboolean
+wait_for_items (GfSnWatcherV0 *watcher,
+                guint          n_expected)
+{
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  timeout_id = g_timeout_add_seconds (TIMEOUT, timeout_cb, &timed_out);
+
+  while (!timed_out &&
+         (n_pending > 0 || count_registered_items (watcher) != n_expected))
+    g_main_context_iteration (NULL, TRUE);
+
+  if (timed_out)
+    {
+      g_printerr ("Timed out with %u items registered, %u expected\n",
+                  count_registered_items (watcher), n_expected);
+      return FALSE;
+    }
+
+  g_source_remove (timeout_id);
+
+  return TRUE;
+}
+
+static void
+watcher_appeared_cb (GDBusConnection *connection,
+                     const gchar     *name,
+                     const gchar     *name_owner,
+                     gpointer         user_data)
+{
+  gboolean *appeared = user_data;
+
+  *appeared = TRUE;
+}
+
+/* Items of a client must be listed in the order they were registered */
+static gboolean
+check_order (GfSnWatcherV0    *watcher,
+             GDBusConnection **clients)
+{
+  const gchar * const *items;
+  gint *next;
+  gint i;
+  gint j;
+
+  items = gf_sn_watcher_v0_gen_get_registered_items (GF_SN_WATCHER_V0_GEN (watcher));
+  if (items == NULL)
+    return TRUE;
+
+  next = g_new0 (gint, n_clients);
+
+  for (i = 0; items[i] != NULL; i++)
+    {
+      for (j = 0; j < n_clients; j++)
+        {
+          const gchar *name;
+          gsize len;
+
+          if (clients[j] == NULL)
+            continue;
+
+          name = g_dbus_connection_get_unique_name (clients[j]);
+          len = strlen (name);
+
+          if (strncmp (items[i], name, len) == 0 && items[i][len] == '/')
+            {
+              gchar *expected;
+              gboolean ok;
+
+              expected = g_strdup_printf ("%s/org/mate/TestItem/%d",
+                                          name, next[j]++);
+              ok = g_strcmp0 (items[i], expected) == 0;
+              g_free (expected);
+
+              if (!ok)
+                {
+                  g_printerr ("Item %s is out of order\n", items[i]);
+                  g_free (next);
+                  return FALSE;
+                }
+
+              break;
+            }
+        }
+    }
+
+  g_free (next);
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GTestDBus *bus;
+  GfSnWatcherV0 *watcher;
+  GDBusConnection **clients;
+  gboolean appeared = FALSE;
+  guint watch_id;
+  gint64 start;
+  gint i;
+  gint j;
+  int retval = EXIT_FAILURE;
+
+  context = g_option_context_new ("- stress the StatusNotifierWatcher");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return EXIT_FAILURE;
+    }
+  g_option_context_free (context);
+
+  if (n_clients < 1 || n_items < 1)
+    {
+      g_printerr ("--clients and --items must be positive\n");
+      return EXIT_FAILURE;
+    }
+
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+
+  watcher = gf_sn_watcher_v0_new ();
+
+  watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION, WATCHER_NAME,
+                               G_BUS_NAME_WATCHER_FLAGS_NONE,
+                               watcher_appeared_cb, NULL,
+                               &appeared, NULL);
+  while (!appeared)
+    g_main_context_iteration (NULL, TRUE);
+  g_bus_unwatch_name (watch_id);
+
+  clients = g_new0 (GDBusConnection *, n_clients);
+  for (i = 0; i < n_clients; i++)
+    {
+      clients[i] = g_dbus_connection_new_for_address_sync (g_test_dbus_get_bus_address (bus),
+                                                           G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                           G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                           NULL, NULL, &error);
+      if (clients[i] == NULL)
+        {
+          g_printerr ("Failed to connect client %d: %s\n", i, error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+
+  /* Register all the items at once, as happens at login */
+  start = g_get_monotonic_time ();
+
+  for (j = 0; j < n_items; j++)
+    {
+      for (i = 0; i < n_clients; i++)
+        {
+          gchar *path;
+
+          path = g_strdup_printf ("/org/mate/TestItem/%d", j);
+          g_dbus_connection_call (clients[i], WATCHER_NAME, WATCHER_PATH,
+                                  WATCHER_INTERFACE, "RegisterStatusNotifierItem",
+                                  g_variant_new ("(s)", path), NULL,
+                                  G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                                  register_item_cb, NULL);
+          g_free (path);
+          n_pending++;
+        }
+    }
+
+  if (!wait_for_items (watcher, n_clients * n_items) || failed)
+    goto out;
+
+  g_print ("Registered %d items from %d clients in %.1f ms\n",
+           n_clients * n_items, n_clients,
+           (g_get_monotonic_time () - start) / 1000.0);
+
+  if (!check_order (watcher, clients))
+    goto out;
+
+  /* Drop the clients one at a time; the watcher must forget their items
+   * and keep the remaining ones in order */
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_clients; i++)
+    {
+      g_dbus_connection_close_sync (clients[i], NULL, NULL);
+      g_clear_object (&clients[i]);
+
+      if (!wait_for_items (watcher, (n_clients - i - 1) * n_items))
+        goto out;
+
+      if (!check_order (watcher, clients))
+        goto out;
+    }
+
+  g_print ("Unregistered %d items from %d clients in %.1f ms\n",
+           n_clients * n_items, n_clients,
+           (g_get_monotonic_time () - start) / 1000.0);
+
+  retval = EXIT_SUCCESS;
+
+out:
+  for (i = 0; i < n_clients; i++)
+    g_clear_object (&clients[i]);
+  g_free (clients);
+
+  g_object_unref (watcher);
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  return retval;
+}
@@ -516,7 +516,7 @@ applet_factory (MatePanelApplet *applet,
   return TRUE;
 }
 
-#ifdef NOTIFICATION_AREA_INPROCESS
+#if defined(NOTIFICATION_AREA_INPROCESS) || defined(NOTIFICATION_AREA_SHARED_HOST)
 	MATE_PANEL_APPLET_IN_PROCESS_FACTORY ("NotificationAreaAppletFactory",
 				 NA_TYPE_TRAY_APPLET,
 				 "NotificationArea",
@@ -34,13 +34,6 @@
 
 #define MIN_ICON_SIZE_DEFAULT 24
 
-typedef struct
-{
-  GtkOrientation  orientation;
-  gint            index;
-  NaGrid         *grid;
-} SortData;
-
 struct _NaGrid
 {
   GtkGrid    parent;
@@ -53,8 +46,15 @@ struct _NaGrid
   gint       rows;
   gint       length;
 
-  GSList    *hosts;
-  GSList    *items;
+  /* orientation and rows or columns the items were last laid out for */
+  GtkOrientation layout_orientation;
+  gint           layout_size;
+
+  GSList     *hosts;
+  GSequence  *items;
+  GHashTable *item_iters;
+
+  NaGridStats stats;
 };
 
 enum
@@ -68,7 +68,8 @@ G_DEFINE_TYPE (NaGrid, na_grid, GTK_TYPE_GRID)
 
 static gint
 compare_items (gconstpointer a,
-               gconstpointer b)
+               gconstpointer b,
+               gpointer      user_data)
 {
   NaItem *item1;
   NaItem *item2;
@@ -95,41 +96,63 @@ compare_items (gconstpointer a,
 }
 
 static void
-sort_items (GtkWidget *item,
-            SortData  *data)
+get_item_cell (NaGrid *self,
+               gint    index,
+               gint   *col,
+               gint   *row)
 {
-  gint col, row, left_attach, top_attach;
-
   /* row / col number depends on whether we are horizontal or vertical */
-  if (data->orientation == GTK_ORIENTATION_HORIZONTAL)
+  if (self->layout_orientation == GTK_ORIENTATION_HORIZONTAL)
     {
-      col = data->index / data->grid->rows;
-      row = data->index % data->grid->rows;
+      *col = index / self->layout_size;
+      *row = index % self->layout_size;
     }
   else
     {
-      row = data->index / data->grid->cols;
-      col = data->index % data->grid->cols;
+      *row = index / self->layout_size;
+      *col = index % self->layout_size;
     }
+}
 
-  /* only update item position if it has changed from current */
-  gtk_container_child_get (GTK_CONTAINER (data->grid),
-                           item,
-                           "left-attach", &left_attach,
-                           "top-attach", &top_attach,
-                           NULL);
+/* Moves the items from @iter to the end to the cell matching their index.
+ * Items before @iter are left alone, so inserting or removing an item only
+ * touches the ones that follow it. */
+static void
+relayout_items (NaGrid        *self,
+                GSequenceIter *iter)
+{
+  gint index;
+
+  self->stats.n_relayouts++;
 
-  if (left_attach != col || top_attach != row)
+  for (index = g_sequence_iter_get_position (iter);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter), index++)
     {
-      gtk_container_child_set (GTK_CONTAINER (data->grid),
+      GtkWidget *item = g_sequence_get (iter);
+      gint col, row, left_attach, top_attach;
+
+      self->stats.n_sorted_items++;
+
+      get_item_cell (self, index, &col, &row);
+
+      /* only update item position if it has changed from current */
+      gtk_container_child_get (GTK_CONTAINER (self),
                                item,
-                               "left-attach", col,
-                               "top-attach", row,
+                               "left-attach", &left_attach,
+                               "top-attach", &top_attach,
                                NULL);
-    }
 
-  /* increment to index of next item */
-  data->index++;
+      if (left_attach != col || top_attach != row)
+        {
+          gtk_container_child_set (GTK_CONTAINER (self),
+                                   item,
+                                   "left-attach", col,
+                                   "top-attach", row,
+                                   NULL);
+          self->stats.n_moved_items++;
+        }
+    }
 }
 
 static void
@@ -138,10 +161,13 @@ refresh_grid (NaGrid *self)
   GtkOrientation orientation;
   GtkAllocation allocation;
   gint rows, cols, length;
-  
+  gint layout_size;
+
+  self->stats.n_refreshes++;
+
   orientation = gtk_orientable_get_orientation (GTK_ORIENTABLE (self));
   gtk_widget_get_allocation (GTK_WIDGET (self), &allocation);
-  length = g_slist_length (self->items);
+  length = g_sequence_get_length (self->items);
 
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
@@ -151,6 +177,7 @@ refresh_grid (NaGrid *self)
       cols = MAX (1, length / rows);
       if (length % rows)
         cols++;
+      layout_size = rows;
     }
   else
     {
@@ -160,22 +187,22 @@ refresh_grid (NaGrid *self)
       rows = MAX (1, length / cols);
       if (length % cols)
         rows++;
+      layout_size = cols;
     }
-  
-  if (self->cols != cols || self->rows != rows || self->length != length)
+
+  self->cols = cols;
+  self->rows = rows;
+  self->length = length;
+
+  /* Cells only depend on the number of rows (horizontal) or columns
+   * (vertical); added and removed items are placed by their callbacks */
+  if (self->layout_orientation != orientation ||
+      self->layout_size != layout_size)
     {
-      self->cols = cols;
-      self->rows = rows;
-      self->length = length;
-      
-      SortData data;
-      data.orientation = gtk_orientable_get_orientation (GTK_ORIENTABLE (self));
-      data.index = 0;
-      data.grid = self;
-
-      g_slist_foreach (self->items,
-                       (GFunc) sort_items,
-                       &data);
+      self->layout_orientation = orientation;
+      self->layout_size = layout_size;
+
+      relayout_items (self, g_sequence_get_begin_iter (self->items));
     }
 }
 
@@ -195,6 +222,10 @@ item_added_cb (NaHost *host,
                NaItem *item,
                NaGrid *self)
 {
+  GSequenceIter *iter;
+  GSequenceIter *next;
+  gint col, row;
+
   g_return_if_fail (NA_IS_HOST (host));
   g_return_if_fail (NA_IS_ITEM (item));
   g_return_if_fail (NA_IS_GRID (self));
@@ -203,17 +234,23 @@ item_added_cb (NaHost *host,
                           item, "orientation",
                           G_BINDING_SYNC_CREATE);
 
-  self->items = g_slist_prepend (self->items, item);
+  iter = g_sequence_insert_sorted (self->items, item, compare_items, NULL);
+  g_hash_table_insert (self->item_iters, item, iter);
+
+  get_item_cell (self, g_sequence_iter_get_position (iter), &col, &row);
 
   gtk_widget_set_hexpand (GTK_WIDGET (item), TRUE);
   gtk_widget_set_vexpand (GTK_WIDGET (item), TRUE);
   gtk_grid_attach (GTK_GRID (self),
                    GTK_WIDGET (item),
-                   self->cols - 1,
-                   self->rows - 1,
+                   col, row,
                    1, 1);
 
-  self->items = g_slist_sort (self->items, compare_items);
+  /* shift the items after the new one */
+  next = g_sequence_iter_next (iter);
+  if (!g_sequence_iter_is_end (next))
+    relayout_items (self, next);
+
   refresh_grid (self);
 }
 
@@ -222,12 +259,26 @@ item_removed_cb (NaHost *host,
                  NaItem *item,
                  NaGrid *self)
 {
+  GSequenceIter *iter;
+  GSequenceIter *next;
+
   g_return_if_fail (NA_IS_HOST (host));
   g_return_if_fail (NA_IS_ITEM (item));
   g_return_if_fail (NA_IS_GRID (self));
 
+  iter = g_hash_table_lookup (self->item_iters, item);
+  g_return_if_fail (iter != NULL);
+
+  next = g_sequence_iter_next (iter);
+  g_hash_table_remove (self->item_iters, item);
+  g_sequence_remove (iter);
+
   gtk_container_remove (GTK_CONTAINER (self), GTK_WIDGET (item));
-  self->items = g_slist_remove (self->items, item);
+
+  /* shift the items after the removed one */
+  if (!g_sequence_iter_is_end (next))
+    relayout_items (self, next);
+
   refresh_grid (self);
 }
 
@@ -242,8 +293,12 @@ na_grid_init (NaGrid *self)
   self->rows = 1;
   self->length = 0;
 
+  self->layout_orientation = GTK_ORIENTATION_HORIZONTAL;
+  self->layout_size = 1;
+
   self->hosts = NULL;
-  self->items = NULL;
+  self->items = g_sequence_new (NULL);
+  self->item_iters = g_hash_table_new (NULL, NULL);
   
   gtk_grid_set_row_homogeneous (GTK_GRID (self), TRUE);
   gtk_grid_set_column_homogeneous (GTK_GRID (self), TRUE);
@@ -292,8 +347,11 @@ static gboolean
 na_grid_draw (GtkWidget *grid,
               cairo_t   *cr)
 {
+  NaGrid *self = NA_GRID (grid);
   GList *child;
   GList *children = gtk_container_get_children (GTK_CONTAINER (grid));
+  gint64 start = g_get_monotonic_time ();
+  gint64 elapsed;
 
   for (child = children; child; child = child->next)
     {
@@ -308,6 +366,11 @@ na_grid_draw (GtkWidget *grid,
 
   g_list_free (children);
 
+  elapsed = g_get_monotonic_time () - start;
+  self->stats.n_draws++;
+  self->stats.draw_time += elapsed;
+  self->stats.max_draw_time = MAX (self->stats.max_draw_time, elapsed);
+
   return TRUE;
 }
 
@@ -344,7 +407,9 @@ na_grid_unrealize (GtkWidget *widget)
       self->hosts = NULL;
     }
 
-  g_clear_pointer (&self->items, g_slist_free);
+  g_sequence_remove_range (g_sequence_get_begin_iter (self->items),
+                           g_sequence_get_end_iter (self->items));
+  g_hash_table_remove_all (self->item_iters);
 
   GTK_WIDGET_CLASS (na_grid_parent_class)->unrealize (widget);
 }
@@ -357,6 +422,17 @@ na_grid_size_allocate (GtkWidget     *widget,
   refresh_grid (NA_GRID (widget));
 }
 
+static void
+na_grid_finalize (GObject *object)
+{
+  NaGrid *self = NA_GRID (object);
+
+  g_sequence_free (self->items);
+  g_hash_table_destroy (self->item_iters);
+
+  G_OBJECT_CLASS (na_grid_parent_class)->finalize (object);
+}
+
 static void
 na_grid_get_property (GObject    *object,
                       guint       property_id,
@@ -411,6 +487,7 @@ na_grid_class_init (NaGridClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  gobject_class->finalize = na_grid_finalize;
   gobject_class->get_property = na_grid_get_property;
   gobject_class->set_property = na_grid_set_property;
 
@@ -451,3 +528,15 @@ na_grid_force_redraw (NaGrid *grid)
   for (node = grid->hosts; node; node = node->next)
     na_host_force_redraw (node->data);
 }
+
+/* Counters for the relayout and drawing paths, used by testtray to spot
+ * regressions with many icons */
+void
+na_grid_get_stats (NaGrid      *grid,
+                   NaGridStats *stats)
+{
+  g_return_if_fail (NA_IS_GRID (grid));
+  g_return_if_fail (stats != NULL);
+
+  *stats = grid->stats;
+}
@@ -38,10 +38,23 @@ G_BEGIN_DECLS
 #define NA_TYPE_GRID (na_grid_get_type ())
 G_DECLARE_FINAL_TYPE (NaGrid, na_grid, NA, GRID, GtkGrid)
 
+typedef struct
+{
+  guint  n_refreshes;     /* refresh_grid() calls */
+  guint  n_relayouts;     /* full or partial relayouts */
+  guint  n_sorted_items;  /* items visited while relaying out */
+  guint  n_moved_items;   /* ... of which changed cell */
+  guint  n_draws;
+  gint64 draw_time;       /* total time spent in draw, in microseconds */
+  gint64 max_draw_time;
+} NaGridStats;
+
 void            na_grid_set_min_icon_size       (NaGrid *grid,
                                                  gint    min_icon_size);
 GtkWidget      *na_grid_new                     (GtkOrientation orientation);
 void            na_grid_force_redraw            (NaGrid *grid);
+void            na_grid_get_stats               (NaGrid      *grid,
+                                                 NaGridStats *stats);
 
 G_END_DECLS
 
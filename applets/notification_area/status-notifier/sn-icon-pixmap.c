@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2016 Alberts Muktupāvels
+ * Copyright (C) 2017 Colomban Wendling <cwendling@hypra.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "sn-icon-pixmap.h"
+
+/* x * a / 255, rounded; exact for all 8-bit x and a */
+#define PREMULTIPLY(x, a, t) \
+  ((t) = (x) * (a), ((t) + (((t) + 128) >> 8) + 128) >> 8)
+
+/**
+ * sn_icon_pixmap_convert:
+ * @dest: (out caller-allocates): @n_pixels Cairo ARGB32 pixels
+ * @src: @n_pixels pixels of IconPixmap data
+ * @n_pixels: the number of pixels to convert
+ *
+ * Converts big-endian, non-premultiplied ARGB pixels, as sent in
+ * IconPixmap, to Cairo's native-endian premultiplied ARGB32, in a single
+ * pass.
+ */
+void
+sn_icon_pixmap_convert (guint32      *dest,
+                        const guchar *src,
+                        gint          n_pixels)
+{
+  gint i = 0;
+
+#if defined(__SSE2__)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i half = _mm_set1_epi16 (128);
+    /* Alpha is multiplied by 255, i.e. kept as is */
+    const __m128i alpha_mask = _mm_set_epi16 (0, 0, 0, 255, 0, 0, 0, 255);
+    const __m128i color_mask = _mm_set_epi16 (-1, -1, -1, 0, -1, -1, -1, 0);
+
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        __m128i pixels = _mm_loadu_si128 ((const __m128i *) (src + i * 4));
+        __m128i halves[2];
+        gint j;
+
+        halves[0] = _mm_unpacklo_epi8 (pixels, zero);
+        halves[1] = _mm_unpackhi_epi8 (pixels, zero);
+
+        for (j = 0; j < 2; j++)
+          {
+            __m128i x = halves[j];
+            __m128i alpha;
+            __m128i t;
+
+            /* Each pixel is A R G B in 16-bit lanes */
+            alpha = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (0, 0, 0, 0)),
+                                         _MM_SHUFFLE (0, 0, 0, 0));
+            alpha = _mm_or_si128 (_mm_and_si128 (alpha, color_mask), alpha_mask);
+
+            t = _mm_mullo_epi16 (x, alpha);
+            t = _mm_add_epi16 (t, _mm_add_epi16 (_mm_srli_epi16 (_mm_add_epi16 (t, half), 8),
+                                                 half));
+            t = _mm_srli_epi16 (t, 8);
+
+            /* B G R A, i.e. a native little-endian ARGB32 pixel */
+            halves[j] = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (t, _MM_SHUFFLE (0, 1, 2, 3)),
+                                             _MM_SHUFFLE (0, 1, 2, 3));
+          }
+
+        _mm_storeu_si128 ((__m128i *) (dest + i),
+                          _mm_packus_epi16 (halves[0], halves[1]));
+      }
+  }
+#elif defined(__ARM_NEON) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+  {
+    for (; i + 8 <= n_pixels; i += 8)
+      {
+        uint8x8x4_t in = vld4_u8 (src + i * 4);
+        uint8x8x4_t out;
+        gint j;
+
+        /* in is A, R, G, B; out is B, G, R, A */
+        out.val[3] = in.val[0];
+        for (j = 1; j < 4; j++)
+          {
+            uint16x8_t t = vmull_u8 (in.val[j], in.val[0]);
+
+            t = vaddq_u16 (t, vrshrq_n_u16 (t, 8));
+            out.val[3 - j] = vrshrn_n_u16 (t, 8);
+          }
+
+        vst4_u8 ((guint8 *) (dest + i), out);
+      }
+  }
+#endif
+
+  for (; i < n_pixels; i++)
+    {
+      const guchar *p = src + i * 4;
+      guint a = p[0];
+      guint t;
+      guint r = PREMULTIPLY (p[1], a, t);
+      guint g = PREMULTIPLY (p[2], a, t);
+      guint b = PREMULTIPLY (p[3], a, t);
+
+      dest[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
@@ -20,6 +20,7 @@
 
 #include <math.h>
 
+#include "sn-icon-pixmap.h"
 #include "sn-item.h"
 #include "sn-item-v0.h"
 #include "sn-item-v0-gen.h"
@@ -41,6 +42,31 @@ typedef struct
   gchar         *text;
 } SnTooltip;
 
+/* Groups of properties announced by the New* signals */
+typedef enum
+{
+  SN_PROPERTY_TITLE          = 1 << 0,
+  SN_PROPERTY_ICON           = 1 << 1,
+  SN_PROPERTY_OVERLAY_ICON   = 1 << 2,
+  SN_PROPERTY_ATTENTION_ICON = 1 << 3,
+  SN_PROPERTY_TOOLTIP        = 1 << 4
+} SnPropertyGroup;
+
+static const struct
+{
+  const gchar     *name;
+  SnPropertyGroup  group;
+} refreshed_properties[] = {
+  { "Title",               SN_PROPERTY_TITLE },
+  { "IconName",            SN_PROPERTY_ICON },
+  { "IconPixmap",          SN_PROPERTY_ICON },
+  { "OverlayIconName",     SN_PROPERTY_OVERLAY_ICON },
+  { "OverlayIconPixmap",   SN_PROPERTY_OVERLAY_ICON },
+  { "AttentionIconName",   SN_PROPERTY_ATTENTION_ICON },
+  { "AttentionIconPixmap", SN_PROPERTY_ATTENTION_ICON },
+  { "ToolTip",             SN_PROPERTY_TOOLTIP }
+};
+
 struct _SnItemV0
 {
   SnItem         parent;
@@ -71,6 +97,14 @@ struct _SnItemV0
   gboolean       item_is_menu;
 
   guint          update_id;
+
+  /* Properties whose New* signal arrived since the last refresh, and
+   * those being fetched */
+  SnPropertyGroup dirty;
+  SnPropertyGroup refreshing;
+  guint           refresh_id;
+  guint           n_pending_gets;
+  guint           calls_requested;
 };
 
 enum
@@ -357,84 +391,40 @@ queue_update (SnItemV0 *v0)
   g_source_set_name_by_id (v0->update_id, "[status-notifier] update_cb");
 }
 
-static cairo_surface_t *
-surface_from_variant (GVariant *variant,
-                      gint      width,
-                      gint      height)
-{
-  cairo_format_t format;
-  gint stride;
-  guint32 *data;
-  gint x;
-  gint y;
-  guchar *p;
-
-  format = CAIRO_FORMAT_ARGB32;
-  stride = cairo_format_stride_for_width (format, width);
-  data = (guint32 *) g_variant_get_data (variant);
-
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-  {
-    gint i;
-
-    for (i = 0; i < width * height; i++)
-      data[i] = GUINT32_FROM_BE (data[i]);
-  }
-#endif
-
-  p = (guchar *) data;
-  /* premultiply alpha for Cairo */
-  for (y = 0; y < height; y++)
-    {
-      for (x = 0; x < width; x++)
-        {
-          guchar alpha = p[x * 4 + 3];
-
-          p[x * 4 + 0] = (p[x * 4 + 0] * alpha) / 255;
-          p[x * 4 + 1] = (p[x * 4 + 1] * alpha) / 255;
-          p[x * 4 + 2] = (p[x * 4 + 2] * alpha) / 255;
-        }
-
-      p += stride;
-    }
-
-  return cairo_image_surface_create_for_data ((guchar *) data, format,
-                                              width, height, stride);
-}
-
 static cairo_surface_t *
 icon_surface_new (GVariant *variant,
                   gint      width,
                   gint      height)
 {
   cairo_surface_t *surface;
-  cairo_surface_t *tmp;
-  cairo_t *cr;
+  const guchar *src;
+  guchar *dest;
+  gint stride;
+  gint y;
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+  if (width <= 0 || height <= 0 ||
+      g_variant_get_size (variant) < (gsize) width * height * 4)
     return NULL;
 
-  tmp = surface_from_variant (variant, width, height);
-  if (cairo_surface_status (tmp) != CAIRO_STATUS_SUCCESS)
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
     {
       cairo_surface_destroy (surface);
       return NULL;
     }
 
-  cr = cairo_create (surface);
-  if (cairo_status (cr) != CAIRO_STATUS_SUCCESS)
-    {
-      cairo_surface_destroy (surface);
-      cairo_surface_destroy (tmp);
-      return NULL;
-    }
+  src = g_variant_get_data (variant);
+  dest = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
 
-  cairo_set_source_surface (cr, tmp, 0, 0);
-  cairo_paint (cr);
+  cairo_surface_flush (surface);
 
-  cairo_surface_destroy (tmp);
-  cairo_destroy (cr);
+  for (y = 0; y < height; y++)
+    sn_icon_pixmap_convert ((guint32 *) (dest + y * stride),
+                              src + y * width * 4,
+                              width);
+
+  cairo_surface_mark_dirty (surface);
 
   return surface;
 }
@@ -591,233 +581,307 @@ get_property (GObject      *source_object,
 }
 
 static void
-update_property (SnItemV0            *v0,
-                 const gchar         *property,
-                 GAsyncReadyCallback  callback)
+set_refreshed_property (SnItemV0    *v0,
+                        const gchar *name,
+                        GVariant    *value)
 {
-  GDBusProxy *proxy;
-  SnItem *item;
-
-  proxy = G_DBUS_PROXY (v0->proxy);
-  item = SN_ITEM (v0);
-
-  g_dbus_connection_call (g_dbus_proxy_get_connection (proxy),
-                          sn_item_get_bus_name (item),
-                          sn_item_get_object_path (item),
-                          "org.freedesktop.DBus.Properties", "Get",
-                          g_variant_new ("(ss)", SN_ITEM_INTERFACE, property),
-                          G_VARIANT_TYPE ("(v)"),
-                          G_DBUS_CALL_FLAGS_NONE, -1,
-                          v0->cancellable, callback, v0);
+  if (g_strcmp0 (name, "Title") == 0)
+    {
+      g_clear_pointer (&v0->title, g_free);
+      v0->title = value ? g_variant_dup_string (value, NULL) : NULL;
+    }
+  else if (g_strcmp0 (name, "IconName") == 0)
+    {
+      g_clear_pointer (&v0->icon_name, g_free);
+      v0->icon_name = value ? g_variant_dup_string (value, NULL) : NULL;
+    }
+  else if (g_strcmp0 (name, "IconPixmap") == 0)
+    {
+      g_clear_pointer (&v0->icon_pixmap, icon_pixmap_free);
+      v0->icon_pixmap = value ? icon_pixmap_new (value) : NULL;
+    }
+  else if (g_strcmp0 (name, "OverlayIconName") == 0)
+    {
+      g_clear_pointer (&v0->overlay_icon_name, g_free);
+      v0->overlay_icon_name = value ? g_variant_dup_string (value, NULL) : NULL;
+    }
+  else if (g_strcmp0 (name, "OverlayIconPixmap") == 0)
+    {
+      g_clear_pointer (&v0->overlay_icon_pixmap, icon_pixmap_free);
+      v0->overlay_icon_pixmap = value ? icon_pixmap_new (value) : NULL;
+    }
+  else if (g_strcmp0 (name, "AttentionIconName") == 0)
+    {
+      g_clear_pointer (&v0->attention_icon_name, g_free);
+      v0->attention_icon_name = value ? g_variant_dup_string (value, NULL) : NULL;
+    }
+  else if (g_strcmp0 (name, "AttentionIconPixmap") == 0)
+    {
+      g_clear_pointer (&v0->attention_icon_pixmap, icon_pixmap_free);
+      v0->attention_icon_pixmap = value ? icon_pixmap_new (value) : NULL;
+    }
+  else if (g_strcmp0 (name, "ToolTip") == 0)
+    {
+      g_clear_pointer (&v0->tooltip, sn_tooltip_free);
+      v0->tooltip = value ? sn_tooltip_new (value) : NULL;
+    }
 }
 
-static void
-update_title (GObject      *source_object,
-              GAsyncResult *res,
-              gpointer      user_data)
+static void refresh_properties (SnItemV0 *v0);
+
+static gboolean
+refresh_cb (gpointer user_data)
 {
   SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
 
   v0 = SN_ITEM_V0 (user_data);
 
-  g_clear_pointer (&v0->title, g_free);
-  v0->title = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
+  v0->refresh_id = 0;
+  refresh_properties (v0);
 
-  queue_update (v0);
+  return G_SOURCE_REMOVE;
 }
 
 static void
-new_title_cb (SnItemV0 *v0)
+refresh_done (SnItemV0 *v0)
 {
-  update_property (v0, "Title", update_title);
+  v0->refreshing = 0;
+
+  /* A single widget update for everything that was refreshed */
+  queue_update (v0);
+
+  /* Signals that arrived while fetching */
+  if (v0->dirty != 0 && v0->refresh_id == 0)
+    {
+      v0->refresh_id = g_idle_add (refresh_cb, v0);
+      g_source_set_name_by_id (v0->refresh_id, "[status-notifier] refresh_cb");
+    }
 }
 
+typedef struct
+{
+  SnItemV0    *v0;
+  const gchar *name;
+} RefreshGet;
+
 static void
-update_icon_name (GObject      *source_object,
-                  GAsyncResult *res,
-                  gpointer      user_data)
+refresh_get_cb (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
 {
+  RefreshGet *get;
   SnItemV0 *v0;
   GVariant *variant;
   gboolean cancelled;
 
-  variant = get_property (source_object, res, user_data, &cancelled);
+  get = user_data;
+
+  variant = get_property (source_object, res, get->v0, &cancelled);
   if (cancelled)
-    return;
+    {
+      g_free (get);
+      return;
+    }
 
-  v0 = SN_ITEM_V0 (user_data);
+  v0 = get->v0;
 
-  g_clear_pointer (&v0->icon_name, g_free);
-  v0->icon_name = g_variant_dup_string (variant, NULL);
+  set_refreshed_property (v0, get->name, variant);
   g_clear_pointer (&variant, g_variant_unref);
+  g_free (get);
 
-  queue_update (v0);
+  if (--v0->n_pending_gets == 0)
+    refresh_done (v0);
 }
 
 static void
-update_icon_pixmap (GObject      *source_object,
+refresh_get_all_cb (GObject      *source_object,
                     GAsyncResult *res,
                     gpointer      user_data)
 {
   SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+  GVariant *properties;
+  GVariantIter *iter;
+  GError *error;
+  gchar *key;
+  GVariant *value;
+  guint i;
 
-  v0 = SN_ITEM_V0 (user_data);
+  error = NULL;
+  properties = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+                                              res, &error);
 
-  g_clear_pointer (&v0->icon_pixmap, icon_pixmap_free);
-  v0->icon_pixmap = icon_pixmap_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free (error);
+      return;
+    }
 
-  queue_update (v0);
-}
+  v0 = SN_ITEM_V0 (user_data);
 
-static void
-new_icon_cb (SnItemV0 *v0)
-{
-  update_property (v0, "IconName", update_icon_name);
-  update_property (v0, "IconPixmap", update_icon_pixmap);
-}
+  if (error)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      refresh_done (v0);
+      return;
+    }
 
-static void
-update_overlay_icon_name (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
-{
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  /* Properties missing from the reply are unset, like a failed Get */
+  for (i = 0; i < G_N_ELEMENTS (refreshed_properties); i++)
+    {
+      if (v0->refreshing & refreshed_properties[i].group)
+        set_refreshed_property (v0, refreshed_properties[i].name, NULL);
+    }
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+  g_variant_get (properties, "(a{sv})", &iter);
+  while (g_variant_iter_next (iter, "{sv}", &key, &value))
+    {
+      for (i = 0; i < G_N_ELEMENTS (refreshed_properties); i++)
+        {
+          if ((v0->refreshing & refreshed_properties[i].group) &&
+              g_strcmp0 (key, refreshed_properties[i].name) == 0)
+            {
+              set_refreshed_property (v0, key, value);
+              break;
+            }
+        }
 
-  v0 = SN_ITEM_V0 (user_data);
+      g_variant_unref (value);
+      g_free (key);
+    }
 
-  g_clear_pointer (&v0->overlay_icon_name, g_free);
-  v0->overlay_icon_name = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
+  g_variant_iter_free (iter);
+  g_variant_unref (properties);
 
-  queue_update (v0);
+  refresh_done (v0);
 }
 
+/* Fetches every property whose New* signal arrived since the last
+ * refresh. A single group is fetched with Get; several at once with a
+ * single GetAll, which also returns the properties nobody asked for but
+ * saves a round trip per property. */
 static void
-update_overlay_icon_pixmap (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
+refresh_properties (SnItemV0 *v0)
 {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  GDBusConnection *connection;
+  SnItem *item;
+  SnPropertyGroup group;
+  guint n_groups;
+  guint n_calls;
+  guint i;
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
+  if (v0->dirty == 0 || v0->refreshing != 0)
     return;
 
-  v0 = SN_ITEM_V0 (user_data);
+  connection = g_dbus_proxy_get_connection (G_DBUS_PROXY (v0->proxy));
+  item = SN_ITEM (v0);
 
-  g_clear_pointer (&v0->overlay_icon_pixmap, icon_pixmap_free);
-  v0->overlay_icon_pixmap = icon_pixmap_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
+  v0->refreshing = v0->dirty;
+  v0->dirty = 0;
 
-  queue_update (v0);
-}
+  n_groups = 0;
+  for (group = SN_PROPERTY_TITLE; group <= SN_PROPERTY_TOOLTIP; group <<= 1)
+    {
+      if (v0->refreshing & group)
+        n_groups++;
+    }
 
-static void
-new_overlay_icon_cb (SnItemV0 *v0)
-{
-  update_property (v0, "OverlayIconName", update_overlay_icon_name);
-  update_property (v0, "OverlayIconPixmap", update_overlay_icon_pixmap);
+  if (n_groups > 1)
+    {
+      g_dbus_connection_call (connection,
+                              sn_item_get_bus_name (item),
+                              sn_item_get_object_path (item),
+                              "org.freedesktop.DBus.Properties", "GetAll",
+                              g_variant_new ("(s)", SN_ITEM_INTERFACE),
+                              G_VARIANT_TYPE ("(a{sv})"),
+                              G_DBUS_CALL_FLAGS_NONE, -1,
+                              v0->cancellable, refresh_get_all_cb, v0);
+      n_calls = 1;
+    }
+  else
+    {
+      n_calls = 0;
+      for (i = 0; i < G_N_ELEMENTS (refreshed_properties); i++)
+        {
+          RefreshGet *get;
+
+          if (!(v0->refreshing & refreshed_properties[i].group))
+            continue;
+
+          get = g_new0 (RefreshGet, 1);
+          get->v0 = v0;
+          get->name = refreshed_properties[i].name;
+
+          g_dbus_connection_call (connection,
+                                  sn_item_get_bus_name (item),
+                                  sn_item_get_object_path (item),
+                                  "org.freedesktop.DBus.Properties", "Get",
+                                  g_variant_new ("(ss)", SN_ITEM_INTERFACE, get->name),
+                                  G_VARIANT_TYPE ("(v)"),
+                                  G_DBUS_CALL_FLAGS_NONE, -1,
+                                  v0->cancellable, refresh_get_cb, get);
+          n_calls++;
+        }
+
+      v0->n_pending_gets = n_calls;
+    }
+
+  g_debug ("Refreshing %s%s with %u calls instead of %u",
+           sn_item_get_bus_name (item), sn_item_get_object_path (item),
+           n_calls, v0->calls_requested);
+  v0->calls_requested = 0;
 }
 
 static void
-update_attention_icon_name (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
+queue_refresh (SnItemV0        *v0,
+               SnPropertyGroup  group)
 {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  guint i;
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+  v0->dirty |= group;
 
-  v0 = SN_ITEM_V0 (user_data);
+  /* What fetching the group right away would have cost */
+  for (i = 0; i < G_N_ELEMENTS (refreshed_properties); i++)
+    {
+      if (refreshed_properties[i].group == group)
+        v0->calls_requested++;
+    }
 
-  g_clear_pointer (&v0->attention_icon_name, g_free);
-  v0->attention_icon_name = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
+  if (v0->refresh_id != 0 || v0->refreshing != 0)
+    return;
 
-  queue_update (v0);
+  v0->refresh_id = g_idle_add (refresh_cb, v0);
+  g_source_set_name_by_id (v0->refresh_id, "[status-notifier] refresh_cb");
 }
 
 static void
-update_attention_icon_pixmap (GObject      *source_object,
-                              GAsyncResult *res,
-                              gpointer      user_data)
+new_title_cb (SnItemV0 *v0)
 {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
-
-  v0 = SN_ITEM_V0 (user_data);
-
-  g_clear_pointer (&v0->attention_icon_pixmap, icon_pixmap_free);
-  v0->attention_icon_pixmap = icon_pixmap_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
-
-  queue_update (v0);
+  queue_refresh (v0, SN_PROPERTY_TITLE);
 }
 
 static void
-new_attention_icon_cb (SnItemV0 *v0)
+new_icon_cb (SnItemV0 *v0)
 {
-  update_property (v0, "AttentionIconName", update_attention_icon_name);
-  update_property (v0, "AttentionIconPixmap", update_attention_icon_pixmap);
+  queue_refresh (v0, SN_PROPERTY_ICON);
 }
 
 static void
-update_tooltip (GObject      *source_object,
-                GAsyncResult *res,
-                gpointer      user_data)
+new_overlay_icon_cb (SnItemV0 *v0)
 {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
-
-  v0 = SN_ITEM_V0 (user_data);
-
-  g_clear_pointer (&v0->tooltip, sn_tooltip_free);
-  v0->tooltip = sn_tooltip_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
+  queue_refresh (v0, SN_PROPERTY_OVERLAY_ICON);
+}
 
-  queue_update (v0);
+static void
+new_attention_icon_cb (SnItemV0 *v0)
+{
+  queue_refresh (v0, SN_PROPERTY_ATTENTION_ICON);
 }
 
 static void
 new_tooltip_cb (SnItemV0 *v0)
 {
-  update_property (v0, "ToolTip", update_tooltip);
+  queue_refresh (v0, SN_PROPERTY_TOOLTIP);
 }
 
 static void
@@ -1077,6 +1141,12 @@ sn_item_v0_dispose (GObject *object)
   g_clear_object (&v0->cancellable);
   g_clear_object (&v0->proxy);
 
+  if (v0->refresh_id != 0)
+    {
+      g_source_remove (v0->refresh_id);
+      v0->refresh_id = 0;
+    }
+
   if (v0->update_id != 0)
     {
       g_source_remove (v0->update_id);
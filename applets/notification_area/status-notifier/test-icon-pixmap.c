@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks sn_icon_pixmap_convert() against a plain reference conversion
+ * and measures how long it takes for the usual tray icon sizes.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include "sn-icon-pixmap.h"
+
+static const gint sizes[] = { 16, 22, 24, 32, 48, 64, 96, 128, 256 };
+
+static gint n_iterations = 2000;
+
+static GOptionEntry entries[] =
+{
+  { "iterations", 0, 0, G_OPTION_ARG_INT, &n_iterations,
+    "Conversions timed per icon size (default: 2000)", "N" },
+  { NULL }
+};
+
+static guint32
+reference_pixel (const guchar *p)
+{
+  guint a = p[0];
+  guint r = (p[1] * a + 127) / 255;
+  guint g = (p[2] * a + 127) / 255;
+  guint b = (p[3] * a + 127) / 255;
+
+  return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static void
+fill_random (guchar *data,
+             gsize   len,
+             GRand  *rand)
+{
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    data[i] = g_rand_int_range (rand, 0, 256);
+}
+
+/* Every alpha and color value, and runs of all lengths so that both the
+ * vector loop and the scalar remainder are covered */
+static gboolean
+check_conversion (GRand *rand)
+{
+  static guchar src[256 * 256 * 4];
+  static guint32 dest[256 * 256 + 1];
+  gint n_pixels;
+  gint i;
+
+  for (i = 0; i < 256 * 256; i++)
+    {
+      src[i * 4] = i >> 8;
+      src[i * 4 + 1] = i & 0xff;
+      src[i * 4 + 2] = 255 - (i & 0xff);
+      src[i * 4 + 3] = (i * 7) & 0xff;
+    }
+
+  sn_icon_pixmap_convert (dest, src, 256 * 256);
+
+  for (i = 0; i < 256 * 256; i++)
+    {
+      if (dest[i] != reference_pixel (src + i * 4))
+        {
+          g_printerr ("Pixel %d: got 0x%08x, expected 0x%08x\n",
+                      i, dest[i], reference_pixel (src + i * 4));
+          return FALSE;
+        }
+    }
+
+  for (n_pixels = 0; n_pixels <= 33; n_pixels++)
+    {
+      fill_random (src, n_pixels * 4, rand);
+      dest[n_pixels] = 0xdeadbeef;
+
+      sn_icon_pixmap_convert (dest, src, n_pixels);
+
+      for (i = 0; i < n_pixels; i++)
+        {
+          if (dest[i] != reference_pixel (src + i * 4))
+            {
+              g_printerr ("Pixel %d of %d: got 0x%08x, expected 0x%08x\n",
+                          i, n_pixels, dest[i], reference_pixel (src + i * 4));
+              return FALSE;
+            }
+        }
+
+      if (dest[n_pixels] != 0xdeadbeef)
+        {
+          g_printerr ("Converting %d pixels wrote past the end\n", n_pixels);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+benchmark_conversion (GRand *rand)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      gint n_pixels = sizes[i] * sizes[i];
+      guchar *src;
+      guint32 *dest;
+      gint64 start;
+      gint64 elapsed;
+      gint j;
+
+      src = g_malloc (n_pixels * 4);
+      dest = g_new (guint32, n_pixels);
+      fill_random (src, n_pixels * 4, rand);
+
+      start = g_get_monotonic_time ();
+      for (j = 0; j < n_iterations; j++)
+        sn_icon_pixmap_convert (dest, src, n_pixels);
+      elapsed = g_get_monotonic_time () - start;
+
+      g_print ("%3dx%-3d  %8.2f us/icon  %6.2f ns/pixel\n",
+               sizes[i], sizes[i],
+               (gdouble) elapsed / n_iterations,
+               elapsed * 1000.0 / n_iterations / n_pixels);
+
+      g_free (src);
+      g_free (dest);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GRand *rand;
+  gboolean ok;
+
+  context = g_option_context_new ("- check and time IconPixmap conversion");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return EXIT_FAILURE;
+    }
+  g_option_context_free (context);
+
+  rand = g_rand_new_with_seed (42);
+
+  ok = check_conversion (rand);
+  if (ok && n_iterations > 0)
+    benchmark_conversion (rand);
+
+  g_rand_free (rand);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
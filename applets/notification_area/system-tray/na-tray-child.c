@@ -25,6 +25,7 @@
 #error file should only be built when HAVE_X11 is enabled
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "na-tray-child.h"
@@ -34,6 +35,9 @@
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+#include <X11/extensions/Xdamage.h>
+#include <xcb/xcb.h>
 
 #include "na-item.h"
 
@@ -43,6 +47,20 @@ enum
   PROP_ORIENTATION
 };
 
+/* The properties of an icon window the tray needs when docking it. They
+ * are requested together without waiting, so that docking many icons at
+ * once costs a single round trip rather than several per icon. */
+struct _NaTrayChildQuery
+{
+  GdkScreen                          *screen;
+  Window                              icon_window;
+  xcb_get_window_attributes_cookie_t  attributes_cookie;
+  xcb_get_property_cookie_t           title_cookie;
+  xcb_get_property_cookie_t           wm_class_cookie;
+};
+
+static char *latin1_to_utf8 (const char *latin1);
+
 static void na_item_init (NaItemInterface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (NaTrayChild, na_tray_child, GTK_TYPE_SOCKET,
@@ -55,10 +73,159 @@ na_tray_child_finalize (GObject *object)
   NaTrayChild *child = NA_TRAY_CHILD (object);
 
   g_clear_pointer (&child->id, g_free);
+  g_clear_pointer (&child->title, g_free);
+  g_clear_pointer (&child->res_name, g_free);
+  g_clear_pointer (&child->res_class, g_free);
 
   G_OBJECT_CLASS (na_tray_child_parent_class)->finalize (object);
 }
 
+static int damage_event_base = -1;
+
+static gboolean
+na_tray_child_have_damage (Display *xdisplay)
+{
+  if (damage_event_base == -1)
+    {
+      int error_base;
+
+      if (!XDamageQueryExtension (xdisplay, &damage_event_base, &error_base))
+        damage_event_base = 0;
+    }
+
+  return damage_event_base != 0;
+}
+
+static GdkFilterReturn
+na_tray_child_damage_filter (GdkXEvent *gdk_xevent,
+                             GdkEvent  *event,
+                             gpointer   data);
+
+static void
+na_tray_child_stop_repaint_watch (NaTrayChild *child)
+{
+  GdkDisplay *display;
+
+  if (child->damage == None)
+    return;
+
+  display = gtk_widget_get_display (GTK_WIDGET (child));
+
+  gdk_x11_display_error_trap_push (display);
+  XDamageDestroy (GDK_DISPLAY_XDISPLAY (display), child->damage);
+  gdk_x11_display_error_trap_pop_ignored (display);
+  child->damage = None;
+
+  gdk_window_remove_filter (child->plug_window,
+                            na_tray_child_damage_filter,
+                            child);
+}
+
+/* Reports the first repaint of the client after its window was exposed
+ * for a background change, then stops listening: only the repaints we
+ * caused are counted. */
+static GdkFilterReturn
+na_tray_child_damage_filter (GdkXEvent *gdk_xevent,
+                             GdkEvent  *event,
+                             gpointer   data)
+{
+  NaTrayChild *child = NA_TRAY_CHILD (data);
+  XEvent *xevent = (XEvent *) gdk_xevent;
+  XDamageNotifyEvent *damage_event;
+
+  if (xevent->type != damage_event_base + XDamageNotify)
+    return GDK_FILTER_CONTINUE;
+
+  damage_event = (XDamageNotifyEvent *) xevent;
+  if (damage_event->damage != child->damage)
+    return GDK_FILTER_CONTINUE;
+
+  g_debug ("Tray icon 0x%lx repainted %.1f ms after its background changed",
+           child->icon_window,
+           (g_get_monotonic_time () - child->expose_time) / 1000.0);
+
+  na_tray_child_stop_repaint_watch (child);
+
+  return GDK_FILTER_REMOVE;
+}
+
+/* The title fetched when docking stays valid until the icon window
+ * changes its _NET_WM_NAME. GtkSocket already selects PropertyNotify on
+ * the plug window, so watching for it costs nothing. */
+static GdkFilterReturn
+na_tray_child_title_filter (GdkXEvent *gdk_xevent,
+                            GdkEvent  *event,
+                            gpointer   data)
+{
+  NaTrayChild *child = NA_TRAY_CHILD (data);
+  XEvent *xevent = (XEvent *) gdk_xevent;
+
+  if (xevent->type == PropertyNotify &&
+      xevent->xproperty.atom == gdk_x11_get_xatom_by_name_for_display (gtk_widget_get_display (GTK_WIDGET (child)),
+                                                                       "_NET_WM_NAME"))
+    child->title_valid = FALSE;
+
+  return GDK_FILTER_CONTINUE;
+}
+
+static void
+na_tray_child_unwatch_title (NaTrayChild *child)
+{
+  if (!child->plug_window)
+    return;
+
+  na_tray_child_stop_repaint_watch (child);
+
+  gdk_window_remove_filter (child->plug_window,
+                            na_tray_child_title_filter,
+                            child);
+  g_clear_object (&child->plug_window);
+
+  /* Nothing tells us about changes anymore */
+  child->title_valid = FALSE;
+  child->background_known = FALSE;
+}
+
+static void
+na_tray_child_plug_added (GtkSocket *socket)
+{
+  NaTrayChild *child = NA_TRAY_CHILD (socket);
+  GdkWindow *plug_window;
+
+  if (GTK_SOCKET_CLASS (na_tray_child_parent_class)->plug_added)
+    GTK_SOCKET_CLASS (na_tray_child_parent_class)->plug_added (socket);
+
+  na_tray_child_unwatch_title (child);
+
+  plug_window = gtk_socket_get_plug_window (socket);
+  if (!plug_window)
+    return;
+
+  child->plug_window = g_object_ref (plug_window);
+  gdk_window_add_filter (child->plug_window,
+                         na_tray_child_title_filter,
+                         child);
+}
+
+static gboolean
+na_tray_child_plug_removed (GtkSocket *socket)
+{
+  na_tray_child_unwatch_title (NA_TRAY_CHILD (socket));
+
+  if (GTK_SOCKET_CLASS (na_tray_child_parent_class)->plug_removed)
+    return GTK_SOCKET_CLASS (na_tray_child_parent_class)->plug_removed (socket);
+
+  return FALSE;
+}
+
+static void
+na_tray_child_unrealize (GtkWidget *widget)
+{
+  na_tray_child_unwatch_title (NA_TRAY_CHILD (widget));
+
+  GTK_WIDGET_CLASS (na_tray_child_parent_class)->unrealize (widget);
+}
+
 static void
 na_tray_child_realize (GtkWidget *widget)
 {
@@ -379,9 +546,11 @@ na_tray_child_class_init (NaTrayChildClass *klass)
 {
   GObjectClass *gobject_class;
   GtkWidgetClass *widget_class;
+  GtkSocketClass *socket_class;
 
   gobject_class = (GObjectClass *)klass;
   widget_class = (GtkWidgetClass *)klass;
+  socket_class = (GtkSocketClass *)klass;
 
   gobject_class->finalize = na_tray_child_finalize;
   gobject_class->get_property = na_tray_child_get_property;
@@ -389,58 +558,177 @@ na_tray_child_class_init (NaTrayChildClass *klass)
 
   widget_class->style_set = na_tray_child_style_set;
   widget_class->realize = na_tray_child_realize;
+  widget_class->unrealize = na_tray_child_unrealize;
 #if !GTK_CHECK_VERSION (3, 23, 0)
   widget_class->get_preferred_width = na_tray_child_get_preferred_width;
   widget_class->get_preferred_height = na_tray_child_get_preferred_height;
 #endif
   widget_class->draw = na_tray_child_draw;
 
+  socket_class->plug_added = na_tray_child_plug_added;
+  socket_class->plug_removed = na_tray_child_plug_removed;
+
   /* we don't really care actually */
   g_object_class_override_property (gobject_class, PROP_ORIENTATION, "orientation");
 }
 
-GtkWidget *
-na_tray_child_new (GdkScreen *screen,
-                   Window     icon_window)
+/**
+ * na_tray_child_query_new;
+ * @screen: the #GdkScreen the icon window is on
+ * @icon_window: the icon window to embed
+ *
+ * Requests the attributes, title and class of @icon_window. The requests
+ * are sent with the next flush of the connection; nothing waits for the
+ * replies until na_tray_child_new_from_query() is called.
+ *
+ * Return value: a new #NaTrayChildQuery, or %NULL if not running on X11
+ */
+NaTrayChildQuery *
+na_tray_child_query_new (GdkScreen *screen,
+                         Window     icon_window)
 {
-  XWindowAttributes window_attributes;
-  Display *xdisplay;
+  NaTrayChildQuery *query;
+  xcb_connection_t *connection;
   GdkDisplay *display;
-  NaTrayChild *child;
-  GdkVisual *visual;
-  gboolean visual_has_alpha;
-  int red_prec, green_prec, blue_prec, depth;
-  int result;
 
   g_return_val_if_fail (GDK_IS_SCREEN (screen), NULL);
   g_return_val_if_fail (icon_window != None, NULL);
 
-  xdisplay = GDK_SCREEN_XDISPLAY (screen);
-
-  /* We need to determine the visual of the window we are embedding and create
-   * the socket in the same visual.
-   */
-
   display = gdk_screen_get_display (screen);
   if (!GDK_IS_X11_DISPLAY (display)) {
     g_warning ("na_tray only works on X11");
     return NULL;
   }
-  gdk_x11_display_error_trap_push (display);
-  result = XGetWindowAttributes (xdisplay, icon_window,
-                                 &window_attributes);
-  gdk_x11_display_error_trap_pop_ignored (display);
 
-  if (!result) /* Window already gone */
+  connection = XGetXCBConnection (GDK_DISPLAY_XDISPLAY (display));
+
+  query = g_new0 (NaTrayChildQuery, 1);
+  query->screen = g_object_ref (screen);
+  query->icon_window = icon_window;
+
+  query->attributes_cookie =
+    xcb_get_window_attributes (connection, icon_window);
+  query->title_cookie =
+    xcb_get_property (connection, FALSE, icon_window,
+                      gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_NAME"),
+                      gdk_x11_get_xatom_by_name_for_display (display, "UTF8_STRING"),
+                      0, G_MAXUINT32);
+  query->wm_class_cookie =
+    xcb_get_property (connection, FALSE, icon_window,
+                      XCB_ATOM_WM_CLASS, XCB_ATOM_STRING,
+                      0, 2048);
+
+  return query;
+}
+
+Window
+na_tray_child_query_get_window (NaTrayChildQuery *query)
+{
+  return query->icon_window;
+}
+
+static gchar *
+na_tray_child_query_get_title (xcb_get_property_reply_t *reply,
+                               Atom                      utf8_string)
+{
+  const gchar *val;
+  int nitems;
+
+  if (!reply ||
+      reply->type != utf8_string ||
+      reply->format != 8)
     return NULL;
 
-  visual = gdk_x11_screen_lookup_visual (screen,
-                                         window_attributes.visual->visualid);
-  if (!visual) /* Icon window is on another screen? */
+  val = xcb_get_property_value (reply);
+  nitems = xcb_get_property_value_length (reply);
+
+  if (nitems == 0 || !g_utf8_validate (val, nitems, NULL))
     return NULL;
 
+  return g_strndup (val, nitems);
+}
+
+static void
+na_tray_child_query_get_wm_class (xcb_get_property_reply_t  *reply,
+                                  gchar                    **res_name,
+                                  gchar                    **res_class)
+{
+  gchar *val;
+  int len;
+  int name_len;
+
+  *res_name = NULL;
+  *res_class = NULL;
+
+  if (!reply || reply->format != 8)
+    return;
+
+  len = xcb_get_property_value_length (reply);
+  if (len == 0)
+    return;
+
+  /* Both strings are NUL-terminated, one after the other */
+  val = g_strndup (xcb_get_property_value (reply), len);
+  name_len = strlen (val);
+
+  *res_name = latin1_to_utf8 (val);
+  if (name_len + 1 < len)
+    *res_class = latin1_to_utf8 (val + name_len + 1);
+
+  g_free (val);
+}
+
+/**
+ * na_tray_child_new_from_query;
+ * @query: (transfer full): a #NaTrayChildQuery
+ *
+ * Collects the replies to @query and creates the socket for the icon
+ * window, in the same visual as the icon window. @query is freed.
+ *
+ * Return value: a new #NaTrayChild, or %NULL if the icon window is gone
+ */
+GtkWidget *
+na_tray_child_new_from_query (NaTrayChildQuery *query)
+{
+  xcb_get_window_attributes_reply_t *attributes;
+  xcb_get_property_reply_t *title_reply;
+  xcb_get_property_reply_t *wm_class_reply;
+  xcb_connection_t *connection;
+  GdkDisplay *display;
+  GdkScreen *screen;
+  NaTrayChild *child;
+  GdkVisual *visual;
+  gboolean visual_has_alpha;
+  int red_prec, green_prec, blue_prec, depth;
+
+  g_return_val_if_fail (query != NULL, NULL);
+
+  screen = query->screen;
+  display = gdk_screen_get_display (screen);
+  connection = XGetXCBConnection (GDK_DISPLAY_XDISPLAY (display));
+
+  /* Errors, e.g. when the window is already gone, come back in place of
+   * the replies */
+  attributes = xcb_get_window_attributes_reply (connection,
+                                                query->attributes_cookie,
+                                                NULL);
+  title_reply = xcb_get_property_reply (connection, query->title_cookie, NULL);
+  wm_class_reply = xcb_get_property_reply (connection, query->wm_class_cookie, NULL);
+
+  child = NULL;
+
+  if (!attributes) /* Window already gone */
+    goto out;
+
+  /* We need to determine the visual of the window we are embedding and create
+   * the socket in the same visual.
+   */
+  visual = gdk_x11_screen_lookup_visual (screen, attributes->visual);
+  if (!visual) /* Icon window is on another screen? */
+    goto out;
+
   child = g_object_new (NA_TYPE_TRAY_CHILD, NULL);
-  child->icon_window = icon_window;
+  child->icon_window = query->icon_window;
 
   gtk_widget_set_visual (GTK_WIDGET (child), visual);
 
@@ -453,17 +741,49 @@ na_tray_child_new (GdkScreen *screen,
 
   visual_has_alpha = red_prec + blue_prec + green_prec < depth;
   child->has_alpha = (visual_has_alpha &&
-                      gdk_display_supports_composite (gdk_screen_get_display (screen)));
+                      gdk_display_supports_composite (display));
 
   child->composited = child->has_alpha;
 
-  return GTK_WIDGET (child);
+  child->title = na_tray_child_query_get_title (title_reply,
+                                                gdk_x11_get_xatom_by_name_for_display (display, "UTF8_STRING"));
+  child->title_valid = TRUE;
+  na_tray_child_query_get_wm_class (wm_class_reply,
+                                    &child->res_name, &child->res_class);
+  child->wm_class_fetched = TRUE;
+
+out:
+  free (attributes);
+  free (title_reply);
+  free (wm_class_reply);
+  na_tray_child_query_free (query);
+
+  return child ? GTK_WIDGET (child) : NULL;
 }
 
-char *
-na_tray_child_get_title (NaTrayChild *child)
+void
+na_tray_child_query_free (NaTrayChildQuery *query)
+{
+  g_object_unref (query->screen);
+  g_free (query);
+}
+
+GtkWidget *
+na_tray_child_new (GdkScreen *screen,
+                   Window     icon_window)
+{
+  NaTrayChildQuery *query;
+
+  query = na_tray_child_query_new (screen, icon_window);
+  if (!query)
+    return NULL;
+
+  return na_tray_child_new_from_query (query);
+}
+
+static gchar *
+na_tray_child_fetch_title (NaTrayChild *child)
 {
-  char *retval = NULL;
   GdkDisplay *display;
   Atom utf8_string, atom, type;
   int result;
@@ -471,8 +791,7 @@ na_tray_child_get_title (NaTrayChild *child)
   gulong nitems;
   gulong bytes_after;
   gchar *val;
-
-  g_return_val_if_fail (NA_IS_TRAY_CHILD (child), NULL);
+  gchar *retval;
 
   display = gtk_widget_get_display (GTK_WIDGET (child));
 
@@ -514,6 +833,32 @@ na_tray_child_get_title (NaTrayChild *child)
   return retval;
 }
 
+/**
+ * na_tray_child_get_title;
+ * @child: a #NaTrayChild
+ *
+ * Gets the current _NET_WM_NAME of the icon window. The title read when
+ * docking is reused until the icon window changes it.
+ *
+ * Return value: a newly allocated string, or %NULL
+ */
+char *
+na_tray_child_get_title (NaTrayChild *child)
+{
+  g_return_val_if_fail (NA_IS_TRAY_CHILD (child), NULL);
+
+  if (!child->title_valid)
+    {
+      g_free (child->title);
+      child->title = na_tray_child_fetch_title (child);
+
+      /* only trust it while the plug window is being watched */
+      child->title_valid = child->plug_window != NULL;
+    }
+
+  return g_strdup (child->title);
+}
+
 /**
  * na_tray_child_has_alpha;
  * @child: a #NaTrayChild
@@ -559,23 +904,186 @@ na_tray_child_set_composited (NaTrayChild *child,
                                composited);
 }
 
-/* If we are faking transparency with a window-relative background, force a
- * redraw of the icon. This should be called if the background changes or if
- * the child is shifted with respect to the background.
+static cairo_user_data_key_t pattern_serial_key;
+
+/* Patterns are recreated when a background changes, but a new pattern
+ * can end up at the address of a freed one: tag them instead */
+static guint
+get_pattern_serial (cairo_pattern_t *pattern)
+{
+  static guint next_serial = 1;
+  guint serial;
+
+  serial = GPOINTER_TO_UINT (cairo_pattern_get_user_data (pattern,
+                                                          &pattern_serial_key));
+  if (serial == 0)
+    {
+      serial = next_serial++;
+      cairo_pattern_set_user_data (pattern, &pattern_serial_key,
+                                   GUINT_TO_POINTER (serial), NULL);
+    }
+
+  return serial;
+}
+
+/* The first ancestor window with a background of its own provides the
+ * parent-relative background of the icon. The windows, their positions
+ * and their backgrounds are all known to GDK, so nothing is asked from
+ * the X server. */
+static gboolean
+na_tray_child_get_background (NaTrayChild           *child,
+                              NaTrayChildBackground *background)
+{
+  GdkWindow *window;
+  cairo_pattern_t *pattern;
+  int x, y;
+
+  memset (background, 0, sizeof (NaTrayChildBackground));
+
+  window = gtk_widget_get_window (GTK_WIDGET (child));
+  pattern = NULL;
+  x = 0;
+  y = 0;
+
+  while (window && !pattern)
+    {
+      int window_x, window_y;
+
+      gdk_window_get_position (window, &window_x, &window_y);
+      x += window_x;
+      y += window_y;
+
+      window = gdk_window_get_parent (window);
+      if (window)
+        {
+          G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+          pattern = gdk_window_get_background_pattern (window);
+          G_GNUC_END_IGNORE_DEPRECATIONS
+        }
+    }
+
+  if (!pattern)
+    return FALSE;
+
+  if (cairo_pattern_get_type (pattern) == CAIRO_PATTERN_TYPE_SOLID)
+    {
+      /* the same everywhere */
+      cairo_pattern_get_rgba (pattern,
+                              &background->color.red,
+                              &background->color.green,
+                              &background->color.blue,
+                              &background->color.alpha);
+      return TRUE;
+    }
+
+  background->pattern_serial = get_pattern_serial (pattern);
+  cairo_pattern_get_matrix (pattern, &background->matrix);
+  background->x = x;
+  background->y = y;
+
+  return TRUE;
+}
+
+static gboolean
+na_tray_child_background_equal (const NaTrayChildBackground *a,
+                                const NaTrayChildBackground *b)
+{
+  if (a->pattern_serial != b->pattern_serial)
+    return FALSE;
+
+  if (a->pattern_serial == 0)
+    return gdk_rgba_equal (&a->color, &b->color);
+
+  return a->x == b->x && a->y == b->y &&
+         a->matrix.xx == b->matrix.xx && a->matrix.yx == b->matrix.yx &&
+         a->matrix.xy == b->matrix.xy && a->matrix.yy == b->matrix.yy &&
+         a->matrix.x0 == b->matrix.x0 && a->matrix.y0 == b->matrix.y0;
+}
+
+/**
+ * na_tray_child_force_redraw;
+ * @child: a #NaTrayChild
+ *
+ * Redraws the icon if the background it shows changed. This should be
+ * called if the background changes or if the child is shifted with
+ * respect to the background.
+ *
+ * Icons with an alpha channel are composited by the tray itself, so only
+ * the tray repaints. Icons faking transparency with a parent-relative
+ * background are exposed if the part of the background under them is
+ * different from the last time; opaque icons don't show the background
+ * and are left alone.
+ *
+ * Return value: %TRUE if the client was asked to repaint
  */
-void
+gboolean
 na_tray_child_force_redraw (NaTrayChild *child)
 {
   GtkWidget *widget = GTK_WIDGET (child);
+  NaTrayChildBackground background;
+  GdkDisplay *display;
+  Display *xdisplay;
+
+  g_return_val_if_fail (NA_IS_TRAY_CHILD (child), FALSE);
+
+  if (!gtk_widget_get_mapped (widget))
+    return FALSE;
+
+  if (child->has_alpha)
+    {
+      GtkWidget *parent = gtk_widget_get_parent (widget);
+      GtkAllocation allocation;
+
+      gtk_widget_get_allocation (widget, &allocation);
+      if (parent)
+        gtk_widget_queue_draw_area (parent,
+                                    allocation.x, allocation.y,
+                                    allocation.width, allocation.height);
+      return FALSE;
+    }
+
+  if (!child->parent_relative_bg || !child->plug_window)
+    return FALSE;
+
+  if (na_tray_child_get_background (child, &background))
+    {
+      if (child->background_known &&
+          na_tray_child_background_equal (&child->background, &background))
+        return FALSE;
+
+      child->background = background;
+      child->background_known = TRUE;
+    }
+  else
+    child->background_known = FALSE;
+
+  display = gtk_widget_get_display (widget);
+  xdisplay = GDK_DISPLAY_XDISPLAY (display);
+
+  /* XClearArea() has the server paint the new background before the
+   * client gets the Expose, which is what clients drawing over a
+   * parent-relative background expect; a synthetic Expose would leave
+   * the old background under the icon. */
+  gdk_x11_display_error_trap_push (display);
+  XClearArea (xdisplay,
+              GDK_WINDOW_XID (child->plug_window),
+              0, 0, 0, 0,
+              True);
 
-  if (gtk_widget_get_mapped (widget))
+  /* Created after the clear so that only the client repaint is seen */
+  if (child->damage == None && na_tray_child_have_damage (xdisplay))
     {
-    /* Hiding and showing is the safe way to do it, but can result in more
-     * flickering.
-     */
-    gtk_widget_hide(widget);
-    gtk_widget_show_all(widget);
+      child->damage = XDamageCreate (xdisplay,
+                                     GDK_WINDOW_XID (child->plug_window),
+                                     XDamageReportNonEmpty);
+      gdk_window_add_filter (child->plug_window,
+                             na_tray_child_damage_filter,
+                             child);
     }
+  child->expose_time = g_get_monotonic_time ();
+  gdk_x11_display_error_trap_pop_ignored (display);
+
+  return TRUE;
 }
 
 /* from libwnck/xutils.c, comes as LGPLv2+ */
@@ -657,10 +1165,22 @@ na_tray_child_get_wm_class (NaTrayChild  *child,
 
   g_return_if_fail (NA_IS_TRAY_CHILD (child));
 
-  display = gtk_widget_get_display (GTK_WIDGET (child));
+  /* WM_CLASS is set before the window is mapped and doesn't change
+   * afterwards; it is looked up on every sort of the tray */
+  if (!child->wm_class_fetched)
+    {
+      display = gtk_widget_get_display (GTK_WIDGET (child));
+
+      _get_wmclass (GDK_DISPLAY_XDISPLAY (display),
+                    child->icon_window,
+                    &child->res_class,
+                    &child->res_name);
+      child->wm_class_fetched = TRUE;
+    }
 
-  _get_wmclass (GDK_DISPLAY_XDISPLAY (display),
-                child->icon_window,
-                res_class,
-                res_name);
+  if (res_name)
+    *res_name = g_strdup (child->res_name);
+
+  if (res_class)
+    *res_class = g_strdup (child->res_class);
 }
@@ -48,6 +48,19 @@ extern "C" {
 typedef struct _NaTrayChild	  NaTrayChild;
 typedef struct _NaTrayChildClass  NaTrayChildClass;
 typedef struct _NaTrayChildChild  NaTrayChildChild;
+typedef struct _NaTrayChildQuery  NaTrayChildQuery;
+typedef struct _NaTrayChildBackground NaTrayChildBackground;
+
+/* What the parent-relative background of an icon shows: a solid color,
+ * or the part of a background pattern at the offset of the icon */
+struct _NaTrayChildBackground
+{
+  guint          pattern_serial; /* 0 for a solid color */
+  GdkRGBA        color;
+  cairo_matrix_t matrix;
+  int            x;
+  int            y;
+};
 
 struct _NaTrayChild
 {
@@ -56,8 +69,18 @@ struct _NaTrayChild
   guint has_alpha : 1;
   guint composited : 1;
   guint parent_relative_bg : 1;
+  guint wm_class_fetched : 1;
+  guint title_valid : 1;
+  guint background_known : 1;
 
   gchar *id;
+  gchar *title;
+  GdkWindow *plug_window;
+  NaTrayChildBackground background;
+  XID damage;
+  gint64 expose_time;
+  gchar *res_name;
+  gchar *res_class;
 };
 
 struct _NaTrayChildClass
@@ -69,11 +92,16 @@ GType           na_tray_child_get_type        (void);
 
 GtkWidget      *na_tray_child_new            (GdkScreen    *screen,
                                               Window        icon_window);
+NaTrayChildQuery *na_tray_child_query_new    (GdkScreen    *screen,
+                                              Window        icon_window);
+Window          na_tray_child_query_get_window (NaTrayChildQuery *query);
+GtkWidget      *na_tray_child_new_from_query (NaTrayChildQuery *query);
+void            na_tray_child_query_free     (NaTrayChildQuery *query);
 char           *na_tray_child_get_title      (NaTrayChild  *child);
 gboolean        na_tray_child_has_alpha      (NaTrayChild  *child);
 void            na_tray_child_set_composited (NaTrayChild  *child,
                                               gboolean      composited);
-void            na_tray_child_force_redraw   (NaTrayChild  *child);
+gboolean        na_tray_child_force_redraw   (NaTrayChild  *child);
 void            na_tray_child_get_wm_class   (NaTrayChild  *child,
 					      char        **res_name,
 					      char        **res_class);
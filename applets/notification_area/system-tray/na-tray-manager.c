@@ -64,8 +64,14 @@ typedef struct
 #ifdef GDK_WINDOWING_X11
   Window window;
 #endif
+
+  GList *link;  /* in manager->message_queue */
 } PendingMessage;
 
+/* Upper bound for the text of all messages being reassembled; the oldest
+ * ones are dropped to make room for new ones */
+#define MAX_PENDING_MESSAGES_SIZE (64 * 1024)
+
 static guint manager_signals[LAST_SIGNAL] = { 0 };
 
 #define SYSTEM_TRAY_REQUEST_DOCK    0
@@ -93,12 +99,39 @@ static void na_tray_manager_unmanage (NaTrayManager *manager);
 
 G_DEFINE_TYPE (NaTrayManager, na_tray_manager, G_TYPE_OBJECT)
 
+static guint
+pending_message_hash (gconstpointer key)
+{
+  const PendingMessage *msg = key;
+
+  return (guint) msg->window * 31 + (guint) msg->id;
+}
+
+static gboolean
+pending_message_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const PendingMessage *msg1 = a;
+  const PendingMessage *msg2 = b;
+
+  return msg1->window == msg2->window && msg1->id == msg2->id;
+}
+
+static void pending_message_remove (NaTrayManager  *manager,
+                                    PendingMessage *msg);
+
 static void
 na_tray_manager_init (NaTrayManager *manager)
 {
   manager->invisible = NULL;
   manager->socket_table = g_hash_table_new (NULL, NULL);
 
+  manager->messages = g_hash_table_new (pending_message_hash,
+                                        pending_message_equal);
+  manager->message_windows = g_hash_table_new (NULL, NULL);
+  g_queue_init (&manager->message_queue);
+  manager->messages_size = 0;
+
   manager->padding = 0;
   manager->icon_size = 0;
 
@@ -207,7 +240,10 @@ na_tray_manager_finalize (GObject *object)
 
   na_tray_manager_unmanage (manager);
 
-  g_list_free (manager->messages);
+  while (manager->message_queue.head != NULL)
+    pending_message_remove (manager, manager->message_queue.head->data);
+  g_hash_table_destroy (manager->messages);
+  g_hash_table_destroy (manager->message_windows);
   g_hash_table_destroy (manager->socket_table);
 
   G_OBJECT_CLASS (na_tray_manager_parent_class)->finalize (object);
@@ -278,22 +314,10 @@ na_tray_manager_plug_removed (GtkSocket       *socket,
 }
 
 static void
-na_tray_manager_handle_dock_request (NaTrayManager       *manager,
-				     XClientMessageEvent *xevent)
+na_tray_manager_dock_child (NaTrayManager *manager,
+                            GtkWidget     *child)
 {
-  Window icon_window = xevent->data.l[2];
-  GtkWidget *child;
-
-  if (g_hash_table_lookup (manager->socket_table,
-                           GINT_TO_POINTER (icon_window)))
-    {
-      /* We already got this notification earlier, ignore this one */
-      return;
-    }
-
-  child = na_tray_child_new (manager->screen, icon_window);
-  if (child == NULL) /* already gone or other error */
-    return;
+  Window icon_window = NA_TRAY_CHILD (child)->icon_window;
 
   g_signal_emit (manager, manager_signals[TRAY_ICON_ADDED], 0,
 		 child);
@@ -324,6 +348,91 @@ na_tray_manager_handle_dock_request (NaTrayManager       *manager,
   gtk_widget_show (child);
 }
 
+/* Dock requests that arrive together (e.g. when the tray comes up and
+ * every client redocks) are answered from one idle, after all of their
+ * queries were sent, so their replies come back in one round trip. */
+static gboolean
+na_tray_manager_dock_pending (gpointer data)
+{
+  NaTrayManager *manager = data;
+  GList *pending, *l;
+  guint n_docked = 0;
+  guint n_requests;
+
+  pending = manager->pending_docks;
+  manager->pending_docks = NULL;
+  manager->pending_docks_id = 0;
+
+  n_requests = g_list_length (pending);
+
+  for (l = pending; l; l = l->next)
+    {
+      GtkWidget *child;
+
+      child = na_tray_child_new_from_query (l->data);
+      if (child == NULL) /* already gone or other error */
+        continue;
+
+      na_tray_manager_dock_child (manager, child);
+      n_docked++;
+    }
+
+  g_list_free (pending);
+
+  g_debug ("Docked %u of %u tray icons in %.1f ms",
+           n_docked, n_requests,
+           (g_get_monotonic_time () - manager->pending_docks_start) / 1000.0);
+
+  return FALSE;
+}
+
+static void
+na_tray_manager_clear_pending_docks (NaTrayManager *manager)
+{
+  if (manager->pending_docks_id)
+    g_source_remove (manager->pending_docks_id);
+  manager->pending_docks_id = 0;
+
+  g_list_free_full (manager->pending_docks,
+                    (GDestroyNotify) na_tray_child_query_free);
+  manager->pending_docks = NULL;
+}
+
+static void
+na_tray_manager_handle_dock_request (NaTrayManager       *manager,
+				     XClientMessageEvent *xevent)
+{
+  Window icon_window = xevent->data.l[2];
+  NaTrayChildQuery *query;
+  GList *l;
+
+  if (g_hash_table_lookup (manager->socket_table,
+                           GINT_TO_POINTER (icon_window)))
+    {
+      /* We already got this notification earlier, ignore this one */
+      return;
+    }
+
+  for (l = manager->pending_docks; l; l = l->next)
+    {
+      if (na_tray_child_query_get_window (l->data) == icon_window)
+        return;
+    }
+
+  query = na_tray_child_query_new (manager->screen, icon_window);
+  if (query == NULL)
+    return;
+
+  if (manager->pending_docks == NULL)
+    manager->pending_docks_start = g_get_monotonic_time ();
+
+  manager->pending_docks = g_list_append (manager->pending_docks, query);
+
+  if (!manager->pending_docks_id)
+    manager->pending_docks_id = g_idle_add (na_tray_manager_dock_pending,
+                                            manager);
+}
+
 static void
 pending_message_free (PendingMessage *message)
 {
@@ -331,45 +440,68 @@ pending_message_free (PendingMessage *message)
   g_free (message);
 }
 
+static void
+pending_message_remove (NaTrayManager  *manager,
+                        PendingMessage *msg)
+{
+  g_hash_table_remove (manager->messages, msg);
+
+  if (g_hash_table_lookup (manager->message_windows,
+                           GINT_TO_POINTER (msg->window)) == msg)
+    g_hash_table_remove (manager->message_windows,
+                         GINT_TO_POINTER (msg->window));
+
+  g_queue_delete_link (&manager->message_queue, msg->link);
+  manager->messages_size -= msg->len;
+
+  pending_message_free (msg);
+}
+
+static PendingMessage *
+pending_message_lookup (NaTrayManager *manager,
+                        Window         window,
+                        long           id)
+{
+  PendingMessage key;
+
+  key.window = window;
+  key.id = id;
+
+  return g_hash_table_lookup (manager->messages, &key);
+}
+
 static void
 na_tray_manager_handle_message_data (NaTrayManager *manager,
                                      XClientMessageEvent *xevent)
 {
-  GList               *p;
+  PendingMessage      *msg;
   int                  len;
 
-  /* Try to see if we can find the pending message in the list */
-  for (p = manager->messages; p; p = p->next)
-    {
-      PendingMessage *msg = p->data;
-
-      if (xevent->window == msg->window)
-	{
-	  /* Append the message */
-	  len = MIN (msg->remaining_len, 20);
+  /* Data goes to the last message the window began */
+  msg = g_hash_table_lookup (manager->message_windows,
+                             GINT_TO_POINTER (xevent->window));
+  if (!msg)
+    return;
 
-	  memcpy ((msg->str + msg->len - msg->remaining_len),
-		  &xevent->data, len);
-	  msg->remaining_len -= len;
+  /* Append the message */
+  len = MIN (msg->remaining_len, 20);
 
-	  if (msg->remaining_len == 0)
-	    {
-	      GtkSocket *socket;
+  memcpy ((msg->str + msg->len - msg->remaining_len),
+          &xevent->data, len);
+  msg->remaining_len -= len;
 
-	      socket = g_hash_table_lookup (manager->socket_table,
-                                            GINT_TO_POINTER (msg->window));
+  if (msg->remaining_len == 0)
+    {
+      GtkSocket *socket;
 
-	      if (socket)
-		  g_signal_emit (manager, manager_signals[MESSAGE_SENT], 0,
-				 socket, msg->str, msg->id, msg->timeout);
+      socket = g_hash_table_lookup (manager->socket_table,
+                                    GINT_TO_POINTER (msg->window));
 
-	      pending_message_free (msg);
-	      manager->messages = g_list_remove_link (manager->messages, p);
-              g_list_free_1 (p);
-	    }
+      if (socket)
+          g_signal_emit (manager, manager_signals[MESSAGE_SENT], 0,
+                         socket, msg->str, msg->id, msg->timeout);
 
-          break;
-	}
+      pending_message_remove (manager, msg);
     }
 }
 
@@ -378,7 +510,6 @@ na_tray_manager_handle_begin_message (NaTrayManager       *manager,
 				      XClientMessageEvent *xevent)
 {
   GtkSocket      *socket;
-  GList          *p;
   PendingMessage *msg;
   long            timeout;
   long            len;
@@ -395,28 +526,32 @@ na_tray_manager_handle_begin_message (NaTrayManager       *manager,
   id      = xevent->data.l[4];
 
   /* Check if the same message is already in the queue and remove it if so */
-  for (p = manager->messages; p; p = p->next)
-    {
-      PendingMessage *pmsg = p->data;
-
-      if (xevent->window == pmsg->window &&
-	  id == pmsg->id)
-	{
-	  /* Hmm, we found it, now remove it */
-	  pending_message_free (pmsg);
-	  manager->messages = g_list_remove_link (manager->messages, p);
-          g_list_free_1 (p);
-	  break;
-	}
-    }
+  msg = pending_message_lookup (manager, xevent->window, id);
+  if (msg)
+    pending_message_remove (manager, msg);
 
   if (len == 0)
     {
       g_signal_emit (manager, manager_signals[MESSAGE_SENT], 0,
                      socket, "", id, timeout);
     }
+  else if (len < 0 || len > MAX_PENDING_MESSAGES_SIZE)
+    {
+      g_debug ("Ignoring message %ld of %ld bytes from window 0x%lx",
+               id, len, xevent->window);
+    }
   else
     {
+      /* Make room by dropping the oldest incomplete messages */
+      while (manager->messages_size + len > MAX_PENDING_MESSAGES_SIZE)
+        {
+          PendingMessage *oldest = manager->message_queue.head->data;
+
+          g_debug ("Dropping incomplete message %ld from window 0x%lx",
+                   oldest->id, oldest->window);
+          pending_message_remove (manager, oldest);
+        }
+
       /* Now add the new message to the queue */
       msg = g_new0 (PendingMessage, 1);
       msg->window = xevent->window;
@@ -426,7 +561,13 @@ na_tray_manager_handle_begin_message (NaTrayManager       *manager,
       msg->remaining_len = msg->len;
       msg->str = g_malloc (msg->len + 1);
       msg->str[msg->len] = '\0';
-      manager->messages = g_list_prepend (manager->messages, msg);
+
+      g_queue_push_tail (&manager->message_queue, msg);
+      msg->link = manager->message_queue.tail;
+      g_hash_table_add (manager->messages, msg);
+      g_hash_table_replace (manager->message_windows,
+                            GINT_TO_POINTER (msg->window), msg);
+      manager->messages_size += len;
     }
 }
 
@@ -434,26 +575,16 @@ static void
 na_tray_manager_handle_cancel_message (NaTrayManager       *manager,
 				       XClientMessageEvent *xevent)
 {
-  GList     *p;
-  GtkSocket *socket;
-  long       id;
+  PendingMessage *msg;
+  GtkSocket      *socket;
+  long            id;
 
   id = xevent->data.l[2];
 
   /* Check if the message is in the queue and remove it if so */
-  for (p = manager->messages; p; p = p->next)
-    {
-      PendingMessage *msg = p->data;
-
-      if (xevent->window == msg->window &&
-	  id == msg->id)
-	{
-	  pending_message_free (msg);
-	  manager->messages = g_list_remove_link (manager->messages, p);
-          g_list_free_1 (p);
-	  break;
-	}
-    }
+  msg = pending_message_lookup (manager, xevent->window, id);
+  if (msg)
+    pending_message_remove (manager, msg);
 
   socket = g_hash_table_lookup (manager->socket_table,
                                 GINT_TO_POINTER (xevent->window));
@@ -489,7 +620,7 @@ na_tray_manager_window_filter (GdkXEvent *xev,
                xevent->xclient.data.l[1] == SYSTEM_TRAY_BEGIN_MESSAGE)
         {
           na_tray_manager_handle_begin_message (manager,
-                                                (XClientMessageEvent *) event);
+                                                (XClientMessageEvent *) xevent);
           return GDK_FILTER_REMOVE;
         }
       /* _NET_SYSTEM_TRAY_OPCODE: SYSTEM_TRAY_CANCEL_MESSAGE */
@@ -497,14 +628,14 @@ na_tray_manager_window_filter (GdkXEvent *xev,
                xevent->xclient.data.l[1] == SYSTEM_TRAY_CANCEL_MESSAGE)
         {
           na_tray_manager_handle_cancel_message (manager,
-                                                 (XClientMessageEvent *) event);
+                                                 (XClientMessageEvent *) xevent);
           return GDK_FILTER_REMOVE;
         }
       /* _NET_SYSTEM_TRAY_MESSAGE_DATA */
       else if (xevent->xclient.message_type == manager->message_data_atom)
         {
           na_tray_manager_handle_message_data (manager,
-                                               (XClientMessageEvent *) event);
+                                               (XClientMessageEvent *) xevent);
           return GDK_FILTER_REMOVE;
         }
     }
@@ -541,6 +672,8 @@ na_tray_manager_unmanage (NaTrayManager *manager)
   GtkWidget  *invisible;
   GdkWindow  *window;
 
+  na_tray_manager_clear_pending_docks (manager);
+
   if (manager->invisible == NULL)
     return;
 
@@ -63,8 +63,15 @@ struct _NaTrayManager
   GdkRGBA warning;
   GdkRGBA success;
 
-  GList *messages;
+  GHashTable *messages;         /* PendingMessage set, by window and id */
+  GHashTable *message_windows;  /* Window -> PendingMessage receiving data */
+  GQueue message_queue;         /* PendingMessage, oldest first */
+  gsize messages_size;
   GHashTable *socket_table;
+
+  GList *pending_docks;
+  guint pending_docks_id;
+  gint64 pending_docks_start;
 };
 
 struct _NaTrayManagerClass
@@ -714,9 +714,26 @@ static gboolean
 idle_redraw_cb (NaTray *tray)
 {
   NaTrayPrivate *priv = tray->priv;
+  GHashTableIter iter;
+  gpointer icon, icon_tray;
+  guint n_icons = 0;
+  guint n_exposed = 0;
+
+  /* The icon table is shared by all the trays of the screen; only the
+   * icons of this tray are on the background that changed */
+  g_hash_table_iter_init (&iter, priv->trays_screen->icon_table);
+  while (g_hash_table_iter_next (&iter, &icon, &icon_tray))
+    {
+      if (icon_tray != tray)
+        continue;
+
+      n_icons++;
+      if (na_tray_child_force_redraw (NA_TRAY_CHILD (icon)))
+        n_exposed++;
+    }
 
-  g_hash_table_foreach (priv->trays_screen->icon_table,
-                        (GHFunc) na_tray_child_force_redraw, NULL);
+  /* the client repaints that follow are reported by the children */
+  g_debug ("Background changed: %u icons, %u exposed", n_icons, n_exposed);
 
   priv->idle_redraw_id = 0;
 
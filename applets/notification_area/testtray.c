@@ -24,8 +24,11 @@
 #include <string.h>
 #include <stdio.h>
 #include <signal.h>
+#include <sys/resource.h>
 #include <glib-unix.h>
 #include <gtk/gtk.h>
+#include <gtk/gtkx.h>
+#include <X11/Xlib.h>
 #include "system-tray/na-tray-manager.h"
 #ifdef PROVIDE_WATCHER_SERVICE
 # include "libstatus-notifier-watcher/gf-status-notifier-watcher.h"
@@ -34,8 +37,31 @@
 
 #define NOTIFICATION_AREA_ICON "mate-panel-notification-area"
 
+#define SYSTEM_TRAY_REQUEST_DOCK 0
+#define SYSTEM_TRAY_BEGIN_MESSAGE 1
+#define STRESS_ICON_SIZE 16
+
 static guint n_windows = 0;
 
+static gint stress = 0;
+static gint stress_client = 0;
+static gint duration = 30;
+static gint churn_interval = 100;
+static GSubprocess *stress_subprocess = NULL;
+
+static GOptionEntry entries[] =
+{
+  { "stress", 0, 0, G_OPTION_ARG_INT, &stress,
+    "Spawn N synthetic XEmbed and N StatusNotifierItem clients and print statistics as JSON lines", "N" },
+  { "duration", 0, 0, G_OPTION_ARG_INT, &duration,
+    "Stop a stress run after SECONDS (default: 30)", "SECONDS" },
+  { "churn-interval", 0, 0, G_OPTION_ARG_INT, &churn_interval,
+    "Change the icon, title or status of one client in ten, or send a balloon message, every MSEC (default: 100)", "MSEC" },
+  { "stress-client", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_INT, &stress_client,
+    NULL, NULL },
+  { NULL }
+};
+
 typedef struct
 {
   GdkScreen *screen;
@@ -43,6 +69,9 @@ typedef struct
   GtkWidget *window;
   GtkWidget *traybox;
   GtkLabel *count_label;
+  gint64 start_time;
+  guint n_tray_children;
+  guint n_sn_items;
 } TrayData;
 
 static void
@@ -69,8 +98,26 @@ update_child_count (TrayData *data)
 static void
 tray_added_cb (GtkContainer *box, GtkWidget *icon, TrayData *data)
 {
-  g_print ("[Screen %u tray %p] Child %p added to tray: \"%s\"\n",
-	   data->screen_num, data->traybox, icon, "XXX");//na_tray_child_get_title (icon));
+  char *title = NULL;
+
+  if (NA_IS_TRAY_CHILD (icon))
+    data->n_tray_children++;
+  else
+    data->n_sn_items++;
+
+  /* keep stdout machine-readable */
+  if (stress > 0)
+    return;
+
+  if (NA_IS_TRAY_CHILD (icon))
+    title = na_tray_child_get_title (NA_TRAY_CHILD (icon));
+
+  /* Clients redock as soon as the tray shows up, so the time of the last
+   * icon added is how long docking all of them took */
+  g_print ("[Screen %u tray %p] Child %p added to tray: \"%s\" (%.1f ms after start)\n",
+	   data->screen_num, data->traybox, icon, title ? title : "",
+	   (g_get_monotonic_time () - data->start_time) / 1000.0);
+  g_free (title);
 
   update_child_count (data);
 }
@@ -78,6 +125,14 @@ tray_added_cb (GtkContainer *box, GtkWidget *icon, TrayData *data)
 static void
 tray_removed_cb (GtkContainer *box, GtkWidget *icon, TrayData *data)
 {
+  if (NA_IS_TRAY_CHILD (icon))
+    data->n_tray_children--;
+  else
+    data->n_sn_items--;
+
+  if (stress > 0)
+    return;
+
   g_print ("[Screen %u tray %p] Child %p removed from tray\n",
 	   data->screen_num, data->traybox, icon);
 
@@ -181,6 +236,7 @@ create_tray_on_screen (GdkScreen *screen,
   gtk_label_set_yalign (GTK_LABEL (label), 0.5);
   gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
 
+  data->start_time = g_get_monotonic_time ();
   data->traybox = na_grid_new (GTK_ORIENTATION_HORIZONTAL);
   gtk_box_pack_start (GTK_BOX (vbox), GTK_WIDGET (data->traybox), TRUE, TRUE, 0);
 
@@ -243,20 +299,545 @@ status_notifier_watcher_maybe_new (void)
 }
 #endif
 
+static void
+print_stress_stats (TrayData *data,
+                    gboolean  final)
+{
+  NaGridStats stats;
+  struct rusage usage;
+
+  na_grid_get_stats (NA_GRID (data->traybox), &stats);
+  getrusage (RUSAGE_SELF, &usage);
+
+  g_print ("{\"elapsed_ms\": %" G_GINT64_FORMAT ", \"final\": %s, "
+           "\"tray_children\": %u, \"sn_items\": %u, "
+           "\"refreshes\": %u, \"relayouts\": %u, "
+           "\"sorted_items\": %u, \"moved_items\": %u, "
+           "\"draws\": %u, \"draw_us_total\": %" G_GINT64_FORMAT ", "
+           "\"draw_us_max\": %" G_GINT64_FORMAT ", \"max_rss_kb\": %ld}\n",
+           (g_get_monotonic_time () - data->start_time) / 1000,
+           final ? "true" : "false",
+           data->n_tray_children, data->n_sn_items,
+           stats.n_refreshes, stats.n_relayouts,
+           stats.n_sorted_items, stats.n_moved_items,
+           stats.n_draws, stats.draw_time, stats.max_draw_time,
+           usage.ru_maxrss);
+}
+
+static gboolean
+stress_report_cb (gpointer user_data)
+{
+  print_stress_stats (user_data, FALSE);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+stress_done_cb (gpointer user_data)
+{
+  print_stress_stats (user_data, TRUE);
+  gtk_main_quit ();
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+start_stress (TrayData    *data,
+              const gchar *self)
+{
+  gchar *n_clients;
+  gchar *interval;
+  GError *error = NULL;
+
+  n_clients = g_strdup_printf ("--stress-client=%d", stress);
+  interval = g_strdup_printf ("--churn-interval=%d", churn_interval);
+
+  stress_subprocess = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, &error,
+                                        self, n_clients, interval, NULL);
+  g_free (n_clients);
+  g_free (interval);
+
+  if (stress_subprocess == NULL)
+    {
+      g_warning ("Failed to spawn stress clients: %s", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  g_timeout_add_seconds (1, stress_report_cb, data);
+  g_timeout_add_seconds (duration, stress_done_cb, data);
+
+  return TRUE;
+}
+
+/* The synthetic clients, all living in one --stress-client process */
+
+typedef struct
+{
+  GtkWidget       *plug;
+  guint            serial;
+} StressPlug;
+
+typedef struct
+{
+  GDBusConnection *connection;
+  gchar           *object_path;
+  gchar           *id;
+  gchar           *title;
+  const gchar     *status;
+  guint            serial;
+  guint            registration_id;
+} StressItem;
+
+typedef struct
+{
+  GdkDisplay      *display;
+  GPtrArray       *plugs;
+  GPtrArray       *items;
+  GDBusConnection *connection;
+  GRand           *rand;
+  Atom             selection_atom;
+  Window           manager_window;
+  guint            dock_id;
+  guint            watch_id;
+} StressClient;
+
+static const gchar stress_item_xml[] =
+  "<node>"
+  "  <interface name='org.kde.StatusNotifierItem'>"
+  "    <property name='Category' type='s' access='read'/>"
+  "    <property name='Id' type='s' access='read'/>"
+  "    <property name='Title' type='s' access='read'/>"
+  "    <property name='Status' type='s' access='read'/>"
+  "    <property name='IconPixmap' type='a(iiay)' access='read'/>"
+  "    <signal name='NewTitle'/>"
+  "    <signal name='NewIcon'/>"
+  "    <signal name='NewStatus'>"
+  "      <arg type='s'/>"
+  "    </signal>"
+  "  </interface>"
+  "</node>";
+
+static void
+stress_color (guint    serial,
+              gdouble *r,
+              gdouble *g,
+              gdouble *b)
+{
+  *r = (serial & 1) ? 1.0 : 0.2;
+  *g = (serial & 2) ? 1.0 : 0.2;
+  *b = (serial & 4) ? 1.0 : 0.2;
+}
+
+static gboolean
+stress_plug_draw_cb (GtkWidget  *widget,
+                     cairo_t    *cr,
+                     StressPlug *plug)
+{
+  gdouble r, g, b;
+
+  stress_color (plug->serial, &r, &g, &b);
+  cairo_set_source_rgb (cr, r, g, b);
+  cairo_paint (cr);
+
+  return TRUE;
+}
+
+static void
+stress_plug_set_title (StressPlug *plug,
+                       guint       index)
+{
+  gchar *title;
+
+  title = g_strdup_printf ("XEmbed client %u (%u)", index, plug->serial);
+  gtk_window_set_title (GTK_WINDOW (plug->plug), title);
+  g_free (title);
+}
+
+static void
+stress_plug_dock (StressPlug *plug,
+                  Window      manager_window)
+{
+  GdkDisplay *display;
+  XClientMessageEvent ev;
+
+  display = gtk_widget_get_display (plug->plug);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = manager_window;
+  ev.message_type = gdk_x11_get_xatom_by_name_for_display (display,
+                                                           "_NET_SYSTEM_TRAY_OPCODE");
+  ev.format = 32;
+  ev.data.l[0] = CurrentTime;
+  ev.data.l[1] = SYSTEM_TRAY_REQUEST_DOCK;
+  ev.data.l[2] = gtk_plug_get_id (GTK_PLUG (plug->plug));
+
+  gdk_x11_display_error_trap_push (display);
+  XSendEvent (GDK_DISPLAY_XDISPLAY (display), manager_window,
+              False, NoEventMask, (XEvent *) &ev);
+  gdk_x11_display_error_trap_pop_ignored (display);
+}
+
+static void
+stress_plug_send_message (StressPlug *plug,
+                          Window      manager_window)
+{
+  GdkDisplay *display;
+  Display *xdisplay;
+  XClientMessageEvent ev;
+  gchar *message;
+  glong len;
+  glong sent;
+
+  display = gtk_widget_get_display (plug->plug);
+  xdisplay = GDK_DISPLAY_XDISPLAY (display);
+  message = g_strdup_printf ("Balloon message %u from an XEmbed client",
+                             plug->serial);
+  len = strlen (message);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = gtk_plug_get_id (GTK_PLUG (plug->plug));
+  ev.message_type = gdk_x11_get_xatom_by_name_for_display (display,
+                                                           "_NET_SYSTEM_TRAY_OPCODE");
+  ev.format = 32;
+  ev.data.l[0] = CurrentTime;
+  ev.data.l[1] = SYSTEM_TRAY_BEGIN_MESSAGE;
+  ev.data.l[2] = 1000;
+  ev.data.l[3] = len;
+  ev.data.l[4] = plug->serial;
+
+  gdk_x11_display_error_trap_push (display);
+  XSendEvent (xdisplay, manager_window, False, NoEventMask, (XEvent *) &ev);
+
+  /* the text follows in 20 bytes fragments */
+  ev.message_type = gdk_x11_get_xatom_by_name_for_display (display,
+                                                           "_NET_SYSTEM_TRAY_MESSAGE_DATA");
+  ev.format = 8;
+  for (sent = 0; sent < len; sent += 20)
+    {
+      memset (ev.data.b, 0, sizeof (ev.data.b));
+      memcpy (ev.data.b, message + sent, MIN (20, len - sent));
+      XSendEvent (xdisplay, manager_window, False, NoEventMask, (XEvent *) &ev);
+    }
+  gdk_x11_display_error_trap_pop_ignored (display);
+
+  g_free (message);
+}
+
+static gboolean
+stress_dock_cb (gpointer user_data)
+{
+  StressClient *client = user_data;
+  Window manager_window;
+  guint i;
+
+  manager_window = XGetSelectionOwner (GDK_DISPLAY_XDISPLAY (client->display),
+                                       client->selection_atom);
+  if (manager_window == None)
+    return G_SOURCE_CONTINUE;
+
+  client->manager_window = manager_window;
+
+  for (i = 0; i < client->plugs->len; i++)
+    {
+      StressPlug *plug = g_ptr_array_index (client->plugs, i);
+
+      stress_plug_dock (plug, manager_window);
+      gtk_widget_show_all (plug->plug);
+    }
+
+  client->dock_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static GVariant *
+stress_item_pixmap_new (StressItem *item)
+{
+  guchar data[STRESS_ICON_SIZE * STRESS_ICON_SIZE * 4];
+  GVariantBuilder builder;
+  gdouble r, g, b;
+  guint i;
+
+  stress_color (item->serial, &r, &g, &b);
+
+  for (i = 0; i < STRESS_ICON_SIZE * STRESS_ICON_SIZE; i++)
+    {
+      data[i * 4] = 0xff;
+      data[i * 4 + 1] = r * 0xff;
+      data[i * 4 + 2] = g * 0xff;
+      data[i * 4 + 3] = b * 0xff;
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+  g_variant_builder_add (&builder, "(ii@ay)",
+                         STRESS_ICON_SIZE, STRESS_ICON_SIZE,
+                         g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                    data, sizeof (data), 1));
+
+  return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+stress_item_get_property (GDBusConnection  *connection,
+                          const gchar      *sender,
+                          const gchar      *object_path,
+                          const gchar      *interface_name,
+                          const gchar      *property_name,
+                          GError          **error,
+                          gpointer          user_data)
+{
+  StressItem *item = user_data;
+
+  if (g_strcmp0 (property_name, "Category") == 0)
+    return g_variant_new_string ("ApplicationStatus");
+  else if (g_strcmp0 (property_name, "Id") == 0)
+    return g_variant_new_string (item->id);
+  else if (g_strcmp0 (property_name, "Title") == 0)
+    return g_variant_new_string (item->title);
+  else if (g_strcmp0 (property_name, "Status") == 0)
+    return g_variant_new_string (item->status);
+  else if (g_strcmp0 (property_name, "IconPixmap") == 0)
+    return stress_item_pixmap_new (item);
+
+  g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+               "Unknown property '%s'", property_name);
+  return NULL;
+}
+
+static const GDBusInterfaceVTable stress_item_vtable =
+{
+  NULL,
+  stress_item_get_property,
+  NULL
+};
+
+static void
+watcher_appeared_cb (GDBusConnection *connection,
+                     const gchar     *name,
+                     const gchar     *name_owner,
+                     gpointer         user_data)
+{
+  StressClient *client = user_data;
+  guint i;
+
+  for (i = 0; i < client->items->len; i++)
+    {
+      StressItem *item = g_ptr_array_index (client->items, i);
+
+      g_dbus_connection_call (connection, name_owner,
+                              "/StatusNotifierWatcher",
+                              "org.kde.StatusNotifierWatcher",
+                              "RegisterStatusNotifierItem",
+                              g_variant_new ("(s)", item->object_path),
+                              NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+                              NULL, NULL, NULL);
+    }
+}
+
+static void
+stress_churn_plug (StressClient *client)
+{
+  StressPlug *plug;
+  guint index;
+
+  index = g_rand_int_range (client->rand, 0, client->plugs->len);
+  plug = g_ptr_array_index (client->plugs, index);
+  plug->serial++;
+
+  switch (g_rand_int_range (client->rand, 0, 3))
+    {
+      case 0:
+        stress_plug_set_title (plug, index);
+        break;
+
+      case 1:
+        gtk_widget_queue_draw (plug->plug);
+        break;
+
+      default:
+        if (client->manager_window != None)
+          stress_plug_send_message (plug, client->manager_window);
+        break;
+    }
+}
+
+static void
+stress_churn_item (StressClient *client)
+{
+  StressItem *item;
+  const gchar *signal_name;
+  GVariant *parameters = NULL;
+
+  item = g_ptr_array_index (client->items,
+                            g_rand_int_range (client->rand, 0, client->items->len));
+  item->serial++;
+
+  switch (g_rand_int_range (client->rand, 0, 3))
+    {
+      case 0:
+        g_free (item->title);
+        item->title = g_strdup_printf ("%s (%u)", item->id, item->serial);
+        signal_name = "NewTitle";
+        break;
+
+      case 1:
+        signal_name = "NewIcon";
+        break;
+
+      default:
+        if (g_strcmp0 (item->status, "Active") == 0)
+          item->status = "NeedsAttention";
+        else
+          item->status = "Active";
+        signal_name = "NewStatus";
+        parameters = g_variant_new ("(s)", item->status);
+        break;
+    }
+
+  g_dbus_connection_emit_signal (item->connection, NULL, item->object_path,
+                                 "org.kde.StatusNotifierItem", signal_name,
+                                 parameters, NULL);
+}
+
+static gboolean
+stress_churn_cb (gpointer user_data)
+{
+  StressClient *client = user_data;
+  guint n_changes;
+  guint i;
+
+  n_changes = MAX (1, client->plugs->len / 10);
+
+  for (i = 0; i < n_changes; i++)
+    {
+      stress_churn_plug (client);
+      stress_churn_item (client);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static int
+run_stress_client (gint n_clients)
+{
+  StressClient client;
+  GDBusNodeInfo *node_info;
+  GError *error = NULL;
+  gchar *selection_name;
+  gint i;
+
+  client.display = gdk_display_get_default ();
+  client.manager_window = None;
+  client.plugs = g_ptr_array_new ();
+  client.items = g_ptr_array_new ();
+  client.rand = g_rand_new ();
+
+  client.connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (client.connection == NULL)
+    {
+      g_warning ("Failed to connect to the session bus: %s", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  node_info = g_dbus_node_info_new_for_xml (stress_item_xml, NULL);
+
+  for (i = 0; i < n_clients; i++)
+    {
+      StressPlug *plug;
+      StressItem *item;
+      GtkWidget *area;
+
+      plug = g_new0 (StressPlug, 1);
+      plug->plug = gtk_plug_new (0);
+      area = gtk_drawing_area_new ();
+      gtk_widget_set_size_request (area, STRESS_ICON_SIZE, STRESS_ICON_SIZE);
+      g_signal_connect (area, "draw", G_CALLBACK (stress_plug_draw_cb), plug);
+      gtk_container_add (GTK_CONTAINER (plug->plug), area);
+      stress_plug_set_title (plug, i);
+      gtk_widget_realize (plug->plug);
+      g_ptr_array_add (client.plugs, plug);
+
+      item = g_new0 (StressItem, 1);
+      item->connection = client.connection;
+      item->object_path = g_strdup_printf ("/org/mate/testtray/Item%d", i);
+      item->id = g_strdup_printf ("testtray-%d", i);
+      item->title = g_strdup (item->id);
+      item->status = "Active";
+      item->registration_id =
+        g_dbus_connection_register_object (client.connection,
+                                           item->object_path,
+                                           node_info->interfaces[0],
+                                           &stress_item_vtable,
+                                           item, NULL, &error);
+      if (error != NULL)
+        {
+          g_warning ("%s", error->message);
+          g_clear_error (&error);
+        }
+      g_ptr_array_add (client.items, item);
+    }
+
+  g_dbus_node_info_unref (node_info);
+
+  selection_name = g_strdup_printf ("_NET_SYSTEM_TRAY_S%d",
+                                    gdk_x11_screen_get_screen_number (gdk_screen_get_default ()));
+  client.selection_atom = gdk_x11_get_xatom_by_name_for_display (client.display,
+                                                                 selection_name);
+  g_free (selection_name);
+
+  /* the tray may not have been created yet */
+  client.dock_id = g_timeout_add (100, stress_dock_cb, &client);
+  client.watch_id = g_bus_watch_name_on_connection (client.connection,
+                                                    "org.kde.StatusNotifierWatcher",
+                                                    G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                    watcher_appeared_cb, NULL,
+                                                    &client, NULL);
+  if (n_clients > 0)
+    g_timeout_add (MAX (1, churn_interval), stress_churn_cb, &client);
+
+  gtk_main ();
+
+  return 0;
+}
+
 int
 main (int argc, char *argv[])
 {
   GdkDisplay *display;
   GdkScreen *screen;
+  GOptionContext *context;
+  GError *error = NULL;
+  TrayData *data;
+  int status = 0;
 #ifdef PROVIDE_WATCHER_SERVICE
   GfStatusNotifierWatcher *service;
 #endif
 
-  gtk_init (&argc, &argv);
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context,
+                                "To measure the tray with many icons without a desktop, run e.g.\n"
+                                "  xvfb-run -a dbus-run-session -- testtray --stress=300");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+  g_option_context_free (context);
 
   g_unix_signal_add (SIGTERM, signal_handler, NULL);
   g_unix_signal_add (SIGINT, signal_handler, NULL);
 
+  if (stress_client > 0)
+    return run_stress_client (stress_client);
+
 #ifdef PROVIDE_WATCHER_SERVICE
   service = status_notifier_watcher_maybe_new ();
 #endif
@@ -266,14 +847,23 @@ main (int argc, char *argv[])
   display = gdk_display_get_default ();
   screen = gdk_display_get_default_screen (display);
 
-  create_tray_on_screen (screen, FALSE);
+  data = create_tray_on_screen (screen, stress > 0);
 
-  gtk_main ();
+  if (stress > 0 && !start_stress (data, argv[0]))
+    status = 1;
+  else
+    gtk_main ();
+
+  if (stress_subprocess != NULL)
+    {
+      g_subprocess_force_exit (stress_subprocess);
+      g_object_unref (stress_subprocess);
+    }
 
 #ifdef PROVIDE_WATCHER_SERVICE
   if (service)
     g_object_unref (service);
 #endif
 
-  return 0;
+  return status;
 }
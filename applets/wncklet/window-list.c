@@ -32,6 +32,15 @@
 #define WINDOW_LIST_ICON "mate-panel-window-list"
 #define WINDOW_LIST_SCHEMA "org.mate.panel.applet.window-list"
 
+/* Number of decoded icons kept around; a few sizes of the icons of the
+ * applications currently open */
+#define ICON_CACHE_SIZE 64
+
+typedef struct {
+	char* key;
+	GdkPixbuf* pixbuf; /* NULL if the icon could not be loaded */
+} IconCacheEntry;
+
 typedef struct {
 	GtkWidget* applet;
 	GtkWidget* tasklist;
@@ -48,6 +57,13 @@ typedef struct {
 
 	GtkIconTheme* icon_theme;
 
+	/* Icon cache, in least recently used order, and its lookup table */
+	GQueue icon_cache;
+	GHashTable* icon_cache_table;
+	guint icon_cache_hits;
+	guint icon_cache_misses;
+	gint64 icon_decode_time;
+
 	/* Properties: */
 	GtkWidget* properties_dialog;
 	GtkWidget* show_current_radio;
@@ -96,9 +112,44 @@ static void response_cb(GtkWidget* widget, int id, TasklistData* tasklist)
 	}
 }
 
+static void icon_cache_entry_free(IconCacheEntry* entry)
+{
+	g_free(entry->key);
+
+	if (entry->pixbuf)
+		g_object_unref(entry->pixbuf);
+
+	g_free(entry);
+}
+
+static void icon_cache_clear(TasklistData* tasklist)
+{
+	g_hash_table_remove_all(tasklist->icon_cache_table);
+	g_queue_foreach(&tasklist->icon_cache, (GFunc) icon_cache_entry_free, NULL);
+	g_queue_clear(&tasklist->icon_cache);
+}
+
+static void icon_theme_changed(GtkIconTheme* icon_theme, TasklistData* tasklist)
+{
+	icon_cache_clear(tasklist);
+}
+
 static void applet_realized(MatePanelApplet* applet, TasklistData* tasklist)
 {
-	tasklist->icon_theme = gtk_icon_theme_get_for_screen(gtk_widget_get_screen(tasklist->applet));
+	GtkIconTheme* icon_theme;
+
+	icon_theme = gtk_icon_theme_get_for_screen(gtk_widget_get_screen(tasklist->applet));
+
+	if (icon_theme == tasklist->icon_theme)
+		return;
+
+	if (tasklist->icon_theme)
+		g_signal_handlers_disconnect_by_func(tasklist->icon_theme, icon_theme_changed, tasklist);
+
+	tasklist->icon_theme = icon_theme;
+	g_signal_connect(icon_theme, "changed", G_CALLBACK(icon_theme_changed), tasklist);
+
+	icon_cache_clear(tasklist);
 }
 
 static void applet_change_orient(MatePanelApplet* applet, MatePanelAppletOrient orient, TasklistData* tasklist)
@@ -345,18 +396,12 @@ static void applet_size_allocate(GtkWidget *widget, GtkAllocation *allocation, T
 		mate_panel_applet_set_size_hints(MATE_PANEL_APPLET(tasklist->applet), size_hints, len, 0);
 }
 
-static GdkPixbuf* icon_loader_func(const char* icon, int size, unsigned int flags, void* data)
+static GdkPixbuf* icon_loader_load(TasklistData* tasklist, const char* icon, int size, unsigned int flags)
 {
-	TasklistData* tasklist;
 	GdkPixbuf* retval;
 	char* icon_no_extension;
 	char* p;
 
-	tasklist = data;
-
-	if (icon == NULL || strcmp(icon, "") == 0)
-		return NULL;
-
 	if (g_path_is_absolute(icon))
 	{
 		if (g_file_test(icon, G_FILE_TEST_EXISTS))
@@ -368,7 +413,7 @@ static GdkPixbuf* icon_loader_func(const char* icon, int size, unsigned int flag
 			char* basename;
 
 			basename = g_path_get_basename(icon);
-			retval = icon_loader_func(basename, size, flags, data);
+			retval = icon_loader_load(tasklist, basename, size, flags);
 			g_free(basename);
 
 			return retval;
@@ -391,6 +436,59 @@ static GdkPixbuf* icon_loader_func(const char* icon, int size, unsigned int flag
 	return retval;
 }
 
+static GdkPixbuf* icon_loader_func(const char* icon, int size, unsigned int flags, void* data)
+{
+	TasklistData* tasklist;
+	IconCacheEntry* entry;
+	GList* link;
+	char* key;
+	gint64 start;
+
+	tasklist = data;
+
+	if (icon == NULL || strcmp(icon, "") == 0)
+		return NULL;
+
+	key = g_strdup_printf("%u:%d:%s", flags, size, icon);
+	link = g_hash_table_lookup(tasklist->icon_cache_table, key);
+
+	if (link)
+	{
+		g_free(key);
+
+		/* move to the most recently used end */
+		g_queue_unlink(&tasklist->icon_cache, link);
+		g_queue_push_head_link(&tasklist->icon_cache, link);
+
+		tasklist->icon_cache_hits++;
+		entry = link->data;
+	}
+	else
+	{
+		start = g_get_monotonic_time();
+
+		entry = g_new0(IconCacheEntry, 1);
+		entry->key = key;
+		entry->pixbuf = icon_loader_load(tasklist, icon, size, flags);
+
+		tasklist->icon_cache_misses++;
+		tasklist->icon_decode_time += g_get_monotonic_time() - start;
+
+		g_queue_push_head(&tasklist->icon_cache, entry);
+		g_hash_table_insert(tasklist->icon_cache_table, entry->key, tasklist->icon_cache.head);
+
+		if (tasklist->icon_cache.length > ICON_CACHE_SIZE)
+		{
+			IconCacheEntry* oldest = g_queue_pop_tail(&tasklist->icon_cache);
+
+			g_hash_table_remove(tasklist->icon_cache_table, oldest->key);
+			icon_cache_entry_free(oldest);
+		}
+	}
+
+	return entry->pixbuf ? g_object_ref(entry->pixbuf) : NULL;
+}
+
 gboolean window_list_applet_fill(MatePanelApplet* applet)
 {
 	TasklistData* tasklist;
@@ -402,6 +500,9 @@ gboolean window_list_applet_fill(MatePanelApplet* applet)
 
 	tasklist->applet = GTK_WIDGET(applet);
 
+	g_queue_init(&tasklist->icon_cache);
+	tasklist->icon_cache_table = g_hash_table_new(g_str_hash, g_str_equal);
+
 	provider = gtk_css_provider_new ();
 	screen = gdk_screen_get_default ();
 	gtk_css_provider_load_from_data (provider,
@@ -704,6 +805,15 @@ static void destroy_tasklist(GtkWidget* widget, TasklistData* tasklist)
 
 	g_object_unref(tasklist->settings);
 
+	if (tasklist->icon_theme)
+		g_signal_handlers_disconnect_by_func(tasklist->icon_theme, icon_theme_changed, tasklist);
+
+	g_debug("Icon cache: %u hits, %u misses, %" G_GINT64_FORMAT " us spent loading icons",
+	        tasklist->icon_cache_hits, tasklist->icon_cache_misses, tasklist->icon_decode_time);
+
+	icon_cache_clear(tasklist);
+	g_hash_table_destroy(tasklist->icon_cache_table);
+
 	if (tasklist->properties_dialog)
 		gtk_widget_destroy(tasklist->properties_dialog);
 
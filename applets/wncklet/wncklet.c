@@ -141,7 +141,7 @@ static gboolean wncklet_factory(MatePanelApplet* applet, const char* iid, gpoint
 }
 
 
-#ifdef WNCKLET_INPROCESS
+#if defined(WNCKLET_INPROCESS) || defined(WNCKLET_SHARED_HOST)
 	MATE_PANEL_APPLET_IN_PROCESS_FACTORY("WnckletFactory", PANEL_TYPE_APPLET, "WindowNavigationApplets", wncklet_factory, NULL)
 #else
 	MATE_PANEL_APPLET_OUT_PROCESS_FACTORY("WnckletFactory", PANEL_TYPE_APPLET, "WindowNavigationApplets", wncklet_factory, NULL)
@@ -359,3 +359,21 @@ mate_panel_applet_factory_get_applet_widget (const gchar *id,
 
 	return GTK_WIDGET (object);
 }
+
+gboolean
+mate_panel_applet_factory_exists (const gchar *factory_id)
+{
+	if (!factories)
+		return FALSE;
+
+	return g_hash_table_lookup (factories, factory_id) != NULL;
+}
+
+guint
+mate_panel_applet_factory_count (void)
+{
+	if (!factories)
+		return 0;
+
+	return g_hash_table_size (factories);
+}
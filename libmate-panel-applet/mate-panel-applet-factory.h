@@ -46,6 +46,8 @@ MatePanelAppletFactory *mate_panel_applet_factory_new              (const gchar
 gboolean            mate_panel_applet_factory_register_service (MatePanelAppletFactory *factory);
 GtkWidget          *mate_panel_applet_factory_get_applet_widget (const gchar        *id,
                                                             guint               uid);
+gboolean            mate_panel_applet_factory_exists           (const gchar        *factory_id);
+guint               mate_panel_applet_factory_count            (void);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,326 @@
+/*
+ * mate-panel-applet-host.c: run several applet factories in one process
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Applets marked with SharedHost=true in their .mate-panel-applet file are
+ * built as modules, like in-process applets, but the panel loads them in
+ * this host instead of in itself. Every factory still owns its own bus
+ * name and its applets are still embedded with GtkPlug, so a crash only
+ * takes down the host; the panel restarts it when the applets are
+ * reloaded. What is shared is the GTK initialization, the icon theme and
+ * the session bus connection, which otherwise each applet process would
+ * pay for on its own.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <gmodule.h>
+#include <gtk/gtk.h>
+
+#include "mate-panel-applet.h"
+#include "mate-panel-applet-factory.h"
+#include "panel-applet-private.h"
+
+#define MATE_PANEL_APPLET_HOST_SERVICE_NAME "org.mate.panel.applet.SharedHost"
+#define MATE_PANEL_APPLET_HOST_OBJECT_PATH  "/org/mate/panel/applet/SharedHost"
+
+/* How often to check whether all factories went away */
+#define MATE_PANEL_APPLET_HOST_IDLE_TIMEOUT 30
+
+typedef gint (* ActivateAppletFunc) (void);
+
+typedef struct {
+	GModule            *module;
+	ActivateAppletFunc  activate_applet;
+	guint               rss_kb;
+} HostedFactory;
+
+static GHashTable *hosted_factories = NULL;
+static gchar     **opt_modules = NULL;
+
+static const GOptionEntry options[] = {
+	{ "module", 'm', 0, G_OPTION_ARG_STRING_ARRAY, &opt_modules,
+	  "Applet factory module to load", "ID=LOCATION" },
+	{ NULL }
+};
+
+static guint
+get_resident_kb (void)
+{
+	gchar  *contents;
+	gulong  resident = 0;
+
+	if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+		return 0;
+
+	if (sscanf (contents, "%*u %lu", &resident) != 1)
+		resident = 0;
+	g_free (contents);
+
+	return (guint) (resident * (sysconf (_SC_PAGESIZE) / 1024));
+}
+
+static gboolean
+host_load_factory (const gchar  *factory_id,
+		   const gchar  *location,
+		   guint        *rss_kb,
+		   GError      **error)
+{
+	HostedFactory *hosted;
+	guint          rss_before;
+	guint          rss_after;
+
+	hosted = g_hash_table_lookup (hosted_factories, factory_id);
+	if (hosted) {
+		/* The factory goes away with its last applet; the module
+		 * stays resident and just has to register it again. */
+		if (!mate_panel_applet_factory_exists (factory_id) &&
+		    hosted->activate_applet () != 0) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "Failed to reactivate factory %s", factory_id);
+			return FALSE;
+		}
+
+		*rss_kb = hosted->rss_kb;
+		return TRUE;
+	}
+
+	rss_before = get_resident_kb ();
+
+	hosted = g_slice_new0 (HostedFactory);
+	hosted->module = g_module_open (location, G_MODULE_BIND_LAZY);
+	if (!hosted->module) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "Failed to load applet factory %s: %s",
+			     factory_id, g_module_error ());
+		g_slice_free (HostedFactory, hosted);
+		return FALSE;
+	}
+
+	if (!g_module_symbol (hosted->module, "_mate_panel_applet_shlib_factory",
+			      (gpointer *) &hosted->activate_applet) ||
+	    hosted->activate_applet () != 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "Failed to activate applet factory %s from %s",
+			     factory_id, location);
+		g_module_close (hosted->module);
+		g_slice_free (HostedFactory, hosted);
+		return FALSE;
+	}
+
+	/* Applet types are registered static */
+	g_module_make_resident (hosted->module);
+
+	rss_after = get_resident_kb ();
+	hosted->rss_kb = rss_after > rss_before ? rss_after - rss_before : 0;
+	g_hash_table_insert (hosted_factories, g_strdup (factory_id), hosted);
+
+	g_debug ("Loaded applet factory %s from %s: +%u kB resident",
+		 factory_id, location, hosted->rss_kb);
+
+	*rss_kb = hosted->rss_kb;
+	return TRUE;
+}
+
+static void
+method_call_cb (GDBusConnection       *connection,
+		const gchar           *sender,
+		const gchar           *object_path,
+		const gchar           *interface_name,
+		const gchar           *method_name,
+		GVariant              *parameters,
+		GDBusMethodInvocation *invocation,
+		gpointer               user_data)
+{
+	if (g_strcmp0 (method_name, "LoadFactory") == 0) {
+		const gchar *factory_id;
+		const gchar *location;
+		guint        rss_kb = 0;
+		GError      *error = NULL;
+
+		g_variant_get (parameters, "(&s&s)", &factory_id, &location);
+
+		if (host_load_factory (factory_id, location, &rss_kb, &error)) {
+			g_dbus_method_invocation_return_value (invocation,
+							       g_variant_new ("(u)", rss_kb));
+		} else {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			g_error_free (error);
+		}
+	} else if (g_strcmp0 (method_name, "GetFactories") == 0) {
+		GVariantBuilder builder;
+		GHashTableIter  iter;
+		gpointer        key, value;
+
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(su)"));
+		g_hash_table_iter_init (&iter, hosted_factories);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			HostedFactory *hosted = value;
+
+			g_variant_builder_add (&builder, "(su)",
+					       (const gchar *) key, hosted->rss_kb);
+		}
+
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(a(su)u)",
+								      &builder,
+								      get_resident_kb ()));
+	}
+}
+
+static const gchar introspection_xml[] =
+	"<node>"
+	  "<interface name='org.mate.panel.applet.SharedHost'>"
+	    "<method name='LoadFactory'>"
+	      "<arg name='factory_id' type='s' direction='in'/>"
+	      "<arg name='location' type='s' direction='in'/>"
+	      "<arg name='resident_kb' type='u' direction='out'/>"
+	    "</method>"
+	    "<method name='GetFactories'>"
+	      "<arg name='factories' type='a(su)' direction='out'/>"
+	      "<arg name='resident_kb' type='u' direction='out'/>"
+	    "</method>"
+	  "</interface>"
+	"</node>";
+
+static const GDBusInterfaceVTable interface_vtable = {
+	method_call_cb,
+	NULL,
+	NULL
+};
+
+static GDBusNodeInfo *introspection_data = NULL;
+
+static void
+on_bus_acquired (GDBusConnection *connection,
+		 const gchar     *name,
+		 gpointer         user_data)
+{
+	GError *error = NULL;
+
+	introspection_data = g_dbus_node_info_new_for_xml (introspection_xml, NULL);
+	g_dbus_connection_register_object (connection,
+					   MATE_PANEL_APPLET_HOST_OBJECT_PATH,
+					   introspection_data->interfaces[0],
+					   &interface_vtable,
+					   NULL, NULL,
+					   &error);
+	if (error) {
+		g_printerr ("Failed to register object %s: %s\n",
+			    MATE_PANEL_APPLET_HOST_OBJECT_PATH, error->message);
+		g_error_free (error);
+	}
+}
+
+static void
+on_name_lost (GDBusConnection *connection,
+	      const gchar     *name,
+	      gpointer         user_data)
+{
+	/* Another host is running, or the bus went away */
+	gtk_main_quit ();
+}
+
+static gboolean
+host_check_idle (gpointer user_data)
+{
+	if (mate_panel_applet_factory_count () > 0)
+		return TRUE;
+
+	gtk_main_quit ();
+
+	return FALSE;
+}
+
+static void
+hosted_factory_free (HostedFactory *hosted)
+{
+	g_slice_free (HostedFactory, hosted);
+}
+
+int
+main (int argc, char *argv[])
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	guint           owner_id;
+	gint            i;
+
+	_MATE_PANEL_APPLET_SETUP_GETTEXT (TRUE);
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+	g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("Cannot parse arguments: %s.\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	gtk_init (&argc, &argv);
+
+	_mate_panel_applet_factory_set_shared_host ();
+
+	hosted_factories = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free,
+						  (GDestroyNotify) hosted_factory_free);
+
+	for (i = 0; opt_modules && opt_modules[i]; i++) {
+		gchar **parts;
+		guint   rss_kb;
+
+		parts = g_strsplit (opt_modules[i], "=", 2);
+		if (!parts[0] || !parts[1]) {
+			g_printerr ("Invalid module '%s', expected ID=LOCATION\n", opt_modules[i]);
+		} else if (!host_load_factory (parts[0], parts[1], &rss_kb, &error)) {
+			g_printerr ("%s\n", error->message);
+			g_clear_error (&error);
+		}
+		g_strfreev (parts);
+	}
+
+	owner_id = g_bus_own_name (G_BUS_TYPE_SESSION,
+				   MATE_PANEL_APPLET_HOST_SERVICE_NAME,
+				   G_BUS_NAME_OWNER_FLAGS_NONE,
+				   on_bus_acquired,
+				   NULL,
+				   on_name_lost,
+				   NULL, NULL);
+
+	g_timeout_add_seconds (MATE_PANEL_APPLET_HOST_IDLE_TIMEOUT,
+			       host_check_idle, NULL);
+
+	gtk_main ();
+
+	g_bus_unown_name (owner_id);
+	g_hash_table_destroy (hosted_factories);
+	g_strfreev (opt_modules);
+	if (introspection_data)
+		g_dbus_node_info_unref (introspection_data);
+
+	return 0;
+}
@@ -75,6 +75,14 @@ struct _MatePanelAppletPrivate {
 	guint              size;
 	char              *background;
 
+	/* Background as last received from the panel, parsed once */
+	MatePanelAppletBackgroundType background_type;
+	GdkRGBA            background_color;
+	guint32            background_xid;
+	int                background_x;
+	int                background_y;
+	guint              background_generation;
+
 	int                previous_width;
 	int                previous_height;
 
@@ -1326,70 +1334,51 @@ mate_panel_applet_get_pattern_from_pixmap (MatePanelApplet *applet,
 #endif
 
 static MatePanelAppletBackgroundType
-mate_panel_applet_handle_background_string (MatePanelApplet  *applet,
-					    GdkRGBA          *color,
-					    cairo_pattern_t **pattern)
+mate_panel_applet_handle_background_data (MatePanelApplet  *applet,
+					  GdkRGBA          *color,
+					  cairo_pattern_t **pattern)
 {
-	MatePanelAppletBackgroundType   retval;
-	char                          **elements;
-
-	retval = PANEL_NO_BACKGROUND;
-
-	if (!gtk_widget_get_realized (GTK_WIDGET (applet)) || !applet->priv->background)
-		return retval;
+	MatePanelAppletPrivate *priv = applet->priv;
 
-	elements = g_strsplit (applet->priv->background, ":", -1);
-
-	if (elements [0] && !strcmp (elements [0], "none" )) {
-		retval = PANEL_NO_BACKGROUND;
+	if (!gtk_widget_get_realized (GTK_WIDGET (applet)))
+		return PANEL_NO_BACKGROUND;
 
-	} else if (elements [0] && !strcmp (elements [0], "color")) {
+	switch (priv->background_type) {
+	case PANEL_NO_BACKGROUND:
+		break;
+	case PANEL_COLOR_BACKGROUND:
 		g_return_val_if_fail (color != NULL, PANEL_NO_BACKGROUND);
 
-		if (!elements [1] || !mate_panel_applet_parse_color (elements [1], color)) {
-
-			g_warning ("Incomplete '%s' background type received", elements [0]);
-			g_strfreev (elements);
-			return PANEL_NO_BACKGROUND;
-		}
-
-		retval = PANEL_COLOR_BACKGROUND;
-
-	} else if (elements [0] && !strcmp (elements [0], "pixmap")) {
+		*color = priv->background_color;
+		return PANEL_COLOR_BACKGROUND;
+	case PANEL_PIXMAP_BACKGROUND:
 #ifdef HAVE_X11
 		if (GDK_IS_X11_DISPLAY (gdk_display_get_default ())) {
-			Window pixmap_id;
-			int             x, y;
-
 			g_return_val_if_fail (pattern != NULL, PANEL_NO_BACKGROUND);
 
-			if (!mate_panel_applet_parse_pixmap_str (elements [1], &pixmap_id, &x, &y)) {
-				g_warning ("Incomplete '%s' background type received: %s",
-					elements [0], elements [1]);
-
-				g_strfreev (elements);
-				return PANEL_NO_BACKGROUND;
-			}
-
-			*pattern = mate_panel_applet_get_pattern_from_pixmap (applet, pixmap_id, x, y);
+			*pattern = mate_panel_applet_get_pattern_from_pixmap (applet,
+									      priv->background_xid,
+									      priv->background_x,
+									      priv->background_y);
 			if (!*pattern) {
-				g_warning ("Failed to get pattern %s", elements [1]);
-				g_strfreev (elements);
+				g_warning ("Failed to get pattern %u,%d,%d",
+					   priv->background_xid,
+					   priv->background_x,
+					   priv->background_y);
 				return PANEL_NO_BACKGROUND;
 			}
 
-			retval = PANEL_PIXMAP_BACKGROUND;
-		} else
-#endif
-		{ // not using X11
-			g_warning("Received pixmap background type, which is only supported on X11");
+			return PANEL_PIXMAP_BACKGROUND;
 		}
-	} else
-		g_warning ("Unknown background type received");
-
-	g_strfreev (elements);
+#endif
+		g_warning("Received pixmap background type, which is only supported on X11");
+		break;
+	default:
+		g_assert_not_reached ();
+		break;
+	}
 
-	return retval;
+	return PANEL_NO_BACKGROUND;
 }
 
 MatePanelAppletBackgroundType
@@ -1405,25 +1394,183 @@ mate_panel_applet_get_background (MatePanelApplet  *applet,
 	if (color != NULL)
 		memset (color, 0, sizeof (GdkRGBA));
 
-	return mate_panel_applet_handle_background_string (applet, color, pattern);
+	return mate_panel_applet_handle_background_data (applet, color, pattern);
+}
+
+/**
+ * mate_panel_applet_get_background_generation:
+ * @applet: A #MatePanelApplet.
+ *
+ * Returns a counter that is increased every time the background of
+ * @applet actually changes. Applets doing expensive work in their
+ * #MatePanelApplet::change-background handler can compare it with the
+ * value they saw last time and skip redundant updates.
+ *
+ * Returns: the background generation of @applet, or 0 if no background
+ * has been received yet.
+ */
+guint
+mate_panel_applet_get_background_generation (MatePanelApplet *applet)
+{
+	g_return_val_if_fail (PANEL_IS_APPLET (applet), 0);
+
+	return applet->priv->background_generation;
+}
+
+static gboolean
+mate_panel_applet_parse_background_string (const gchar                   *str,
+					   MatePanelAppletBackgroundType *type,
+					   GdkRGBA                       *color,
+					   guint32                       *xid,
+					   int                           *x,
+					   int                           *y)
+{
+	char     **elements;
+	gboolean   retval = TRUE;
+
+	*type = PANEL_NO_BACKGROUND;
+
+	if (!str)
+		return TRUE;
+
+	elements = g_strsplit (str, ":", -1);
+
+	if (elements [0] && !strcmp (elements [0], "none" )) {
+		*type = PANEL_NO_BACKGROUND;
+
+	} else if (elements [0] && !strcmp (elements [0], "color")) {
+		if (!elements [1] || !mate_panel_applet_parse_color (elements [1], color)) {
+			g_warning ("Incomplete '%s' background type received", elements [0]);
+			retval = FALSE;
+		} else
+			*type = PANEL_COLOR_BACKGROUND;
+
+	} else if (elements [0] && !strcmp (elements [0], "pixmap")) {
+#ifdef HAVE_X11
+		Window pixmap_id;
+
+		if (!elements [1] || !mate_panel_applet_parse_pixmap_str (elements [1], &pixmap_id, x, y)) {
+			g_warning ("Incomplete '%s' background type received: %s",
+				   elements [0], elements [1] ? elements [1] : "");
+			retval = FALSE;
+		} else {
+			*xid = (guint32) pixmap_id;
+			*type = PANEL_PIXMAP_BACKGROUND;
+		}
+#else
+		g_warning("Received pixmap background type, which is only supported on X11");
+		retval = FALSE;
+#endif
+	} else {
+		g_warning ("Unknown background type received");
+		retval = FALSE;
+	}
+
+	g_strfreev (elements);
+
+	return retval;
+}
+
+static char *
+mate_panel_applet_make_background_string (MatePanelApplet *applet)
+{
+	MatePanelAppletPrivate *priv = applet->priv;
+	char                   *rgba;
+	char                   *retval;
+
+	switch (priv->background_type) {
+	case PANEL_COLOR_BACKGROUND:
+		rgba = gdk_rgba_to_string (&priv->background_color);
+		retval = g_strdup_printf ("color:%s", rgba);
+		g_free (rgba);
+		return retval;
+	case PANEL_PIXMAP_BACKGROUND:
+		return g_strdup_printf ("pixmap:%u,%d,%d",
+					priv->background_xid,
+					priv->background_x,
+					priv->background_y);
+	default:
+		return g_strdup ("none:");
+	}
+}
+
+/* Returns TRUE if the background really changed. The string form is only
+ * regenerated when @background is NULL, i.e. when the structured
+ * BackgroundData property was used. */
+static gboolean
+mate_panel_applet_set_background_data (MatePanelApplet               *applet,
+				       MatePanelAppletBackgroundType  type,
+				       const GdkRGBA                 *color,
+				       guint32                        xid,
+				       int                            x,
+				       int                            y,
+				       const gchar                   *background)
+{
+	MatePanelAppletPrivate *priv = applet->priv;
+
+	/* The first background always goes through, so that applets get
+	 * told about it even if it is "none". */
+	if (priv->background_generation > 0 && priv->background_type == type) {
+		switch (type) {
+		case PANEL_NO_BACKGROUND:
+			return FALSE;
+		case PANEL_COLOR_BACKGROUND:
+			if (gdk_rgba_equal (&priv->background_color, color))
+				return FALSE;
+			break;
+		case PANEL_PIXMAP_BACKGROUND:
+			if (priv->background_xid == xid &&
+			    priv->background_x == x &&
+			    priv->background_y == y)
+				return FALSE;
+			break;
+		default:
+			break;
+		}
+	}
+
+	priv->background_type = type;
+	if (type == PANEL_COLOR_BACKGROUND)
+		priv->background_color = *color;
+	else
+		memset (&priv->background_color, 0, sizeof (GdkRGBA));
+	priv->background_xid = xid;
+	priv->background_x = x;
+	priv->background_y = y;
+	priv->background_generation++;
+
+	g_free (priv->background);
+	if (background)
+		priv->background = g_strdup (background);
+	else
+		priv->background = mate_panel_applet_make_background_string (applet);
+
+	mate_panel_applet_handle_background (applet);
+
+	g_object_notify (G_OBJECT (applet), "background");
+
+	return TRUE;
 }
 
 static void
 mate_panel_applet_set_background_string (MatePanelApplet *applet,
 				    const gchar *background)
 {
+	MatePanelAppletBackgroundType type;
+	GdkRGBA                       color = { 0, };
+	guint32                       xid = 0;
+	int                           x = 0, y = 0;
+
 	if (applet->priv->background == background)
 		return;
 
 	if (g_strcmp0 (applet->priv->background, background) == 0)
 		return;
 
-	if (applet->priv->background)
-		g_free (applet->priv->background);
-	applet->priv->background = background ? g_strdup (background) : NULL;
-	mate_panel_applet_handle_background (applet);
+	if (!mate_panel_applet_parse_background_string (background, &type, &color, &xid, &x, &y))
+		type = PANEL_NO_BACKGROUND;
 
-	g_object_notify (G_OBJECT (applet), "background");
+	mate_panel_applet_set_background_data (applet, type, &color, xid, x, y, background);
 }
 
 static void
@@ -2107,6 +2254,15 @@ get_property_cb (GDBusConnection *connection,
 	} else if (g_strcmp0 (property_name, "Background") == 0) {
 		retval = g_variant_new_string (applet->priv->background ?
 					       applet->priv->background : "");
+	} else if (g_strcmp0 (property_name, "BackgroundData") == 0) {
+		GdkRGBA *color = &applet->priv->background_color;
+
+		retval = g_variant_new ("(u(dddd)uii)",
+					applet->priv->background_type,
+					color->red, color->green, color->blue, color->alpha,
+					applet->priv->background_xid,
+					applet->priv->background_x,
+					applet->priv->background_y);
 	} else if (g_strcmp0 (property_name, "Flags") == 0) {
 		retval = g_variant_new_uint32 (applet->priv->flags);
 	} else if (g_strcmp0 (property_name, "SizeHints") == 0) {
@@ -2148,6 +2304,23 @@ set_property_cb (GDBusConnection *connection,
 		mate_panel_applet_set_size (applet, g_variant_get_uint32 (value));
 	} else if (g_strcmp0 (property_name, "Background") == 0) {
 		mate_panel_applet_set_background_string (applet, g_variant_get_string (value, NULL));
+	} else if (g_strcmp0 (property_name, "BackgroundData") == 0) {
+		guint32 type;
+		GdkRGBA color;
+		guint32 xid;
+		gint32  x, y;
+
+		g_variant_get (value, "(u(dddd)uii)", &type,
+			       &color.red, &color.green, &color.blue, &color.alpha,
+			       &xid, &x, &y);
+
+		if (type > PANEL_PIXMAP_BACKGROUND) {
+			g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+				     "Unknown background type %u", type);
+			return FALSE;
+		}
+
+		mate_panel_applet_set_background_data (applet, type, &color, xid, x, y, NULL);
 	} else if (g_strcmp0 (property_name, "Flags") == 0) {
 		mate_panel_applet_set_flags (applet, g_variant_get_uint32 (value));
 	} else if (g_strcmp0 (property_name, "SizeHints") == 0) {
@@ -2176,6 +2349,7 @@ static const gchar introspection_xml[] =
 	    "<property name='Orient' type='u' access='readwrite' />"
 	    "<property name='Size' type='u' access='readwrite'/>"
 	    "<property name='Background' type='s' access='readwrite'/>"
+	    "<property name='BackgroundData' type='(u(dddd)uii)' access='readwrite'/>"
 	    "<property name='Flags' type='u' access='readwrite'/>"
 	    "<property name='SizeHints' type='ai' access='readwrite'/>"
 	    "<property name='Locked' type='b' access='readwrite'/>"
@@ -2280,6 +2454,16 @@ _mate_panel_applet_setup_x_error_handler (void)
 }
 #endif
 
+/* Set by mate-panel-applet-host: in-process factories loaded there still
+ * serve out-of-process applets, and the host owns the main loop. */
+static gboolean shared_host = FALSE;
+
+void
+_mate_panel_applet_factory_set_shared_host (void)
+{
+	shared_host = TRUE;
+}
+
 static int
 _mate_panel_applet_factory_main_internal (const gchar               *factory_id,
 				     gboolean                   out_process,
@@ -2317,7 +2501,7 @@ _mate_panel_applet_factory_main_internal (const gchar               *factory_id,
 
 	if (mate_panel_applet_factory_register_service(factory))
 	{
-		if (out_process)
+		if (out_process && !shared_host)
 		{
 			g_object_weak_ref(G_OBJECT(factory), mate_panel_applet_factory_main_finalized, NULL);
 			gtk_main();
@@ -2367,7 +2551,7 @@ mate_panel_applet_factory_setup_in_process (const gchar               *factory_i
 				       MatePanelAppletFactoryCallback callback,
 				       gpointer                   user_data)
 {
-	return _mate_panel_applet_factory_main_internal (factory_id, FALSE, applet_type,
+	return _mate_panel_applet_factory_main_internal (factory_id, shared_host, applet_type,
 						    callback, user_data);
 }
 
@@ -96,6 +96,7 @@ GtkWidget* mate_panel_applet_new(void);
 MatePanelAppletOrient mate_panel_applet_get_orient(MatePanelApplet* applet);
 guint mate_panel_applet_get_size(MatePanelApplet* applet);
 MatePanelAppletBackgroundType mate_panel_applet_get_background (MatePanelApplet *applet, /* return values */ GdkRGBA* color, cairo_pattern_t** pattern);
+guint mate_panel_applet_get_background_generation (MatePanelApplet *applet);
 void mate_panel_applet_set_background_widget(MatePanelApplet* applet, GtkWidget* widget);
 
 gchar* mate_panel_applet_get_preferences_path(MatePanelApplet* applet);
@@ -33,6 +33,8 @@ const gchar *mate_panel_applet_get_object_path   (MatePanelApplet *applet);
 GtkWidget   *mate_panel_applet_get_applet_widget (const gchar *factory_id,
                                               guint        uid);       
 
+void         _mate_panel_applet_factory_set_shared_host (void);
+
 G_END_DECLS
 
 #endif
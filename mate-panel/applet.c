@@ -39,6 +39,8 @@
 #define SMALL_ICON_SIZE 20
 
 static GSList *registered_applets = NULL;
+/* id -> AppletInfo, for the registered applets */
+static GHashTable *registered_applets_by_id = NULL;
 static GSList *queued_position_saves = NULL;
 static guint   queued_position_source = 0;
 
@@ -265,12 +267,14 @@ applet_callback_callback (GtkWidget      *widget,
 		if (strcmp (menu->name, "add") == 0) {
 			Drawer *drawer = menu->info->data;
 
-			panel_addto_present (GTK_MENU_ITEM (widget),
-					     panel_toplevel_get_panel_widget (drawer->toplevel));
+			if (panel_drawer_ensure_toplevel (drawer))
+				panel_addto_present (GTK_MENU_ITEM (widget),
+						     panel_toplevel_get_panel_widget (drawer->toplevel));
 		} else if (strcmp (menu->name, "properties") == 0) {
 			Drawer *drawer = menu->info->data;
 
-			panel_properties_dialog_present (drawer->toplevel);
+			if (panel_drawer_ensure_toplevel (drawer))
+				panel_properties_dialog_present (drawer->toplevel);
 		} else if (strcmp (menu->name, "help") == 0) {
 			panel_show_help (screen,
 					 "mate-user-guide", "gospanel-18", NULL);
@@ -729,6 +733,8 @@ mate_panel_applet_destroy (GtkWidget  *widget,
 	}
 
 	registered_applets = g_slist_remove (registered_applets, info);
+	if (g_hash_table_lookup (registered_applets_by_id, info->id) == info)
+		g_hash_table_remove (registered_applets_by_id, info->id);
 
 	queued_position_saves =
 		g_slist_remove (queued_position_saves, info);
@@ -784,6 +790,8 @@ typedef struct {
  * mate_panel_applet_queue_initial_unhide_toplevels() should be called */
 static GSList  *mate_panel_applets_to_load = NULL;
 static GSList  *mate_panel_applets_loading = NULL;
+/* id -> number of entries in the two lists above */
+static GHashTable *mate_panel_applets_queued_ids = NULL;
 /* We have a timeout to always unhide toplevels after a delay, in case of some
  * blocking applet */
 #define         UNHIDE_TOPLEVELS_TIMEOUT_SECONDS 5
@@ -794,6 +802,16 @@ static gboolean mate_panel_applet_have_load_idle = FALSE;
 static void
 free_applet_to_load (MatePanelAppletToLoad *applet)
 {
+	guint count;
+
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (mate_panel_applets_queued_ids,
+						       applet->id));
+	if (count > 1)
+		g_hash_table_insert (mate_panel_applets_queued_ids,
+				     g_strdup (applet->id), GUINT_TO_POINTER (count - 1));
+	else
+		g_hash_table_remove (mate_panel_applets_queued_ids, applet->id);
+
 	g_free (applet->id);
 	applet->id = NULL;
 
@@ -806,18 +824,10 @@ free_applet_to_load (MatePanelAppletToLoad *applet)
 gboolean
 mate_panel_applet_on_load_queue (const char *id)
 {
-	GSList *li;
-	for (li = mate_panel_applets_to_load; li != NULL; li = li->next) {
-		MatePanelAppletToLoad *applet = li->data;
-		if (strcmp (applet->id, id) == 0)
-			return TRUE;
-	}
-	for (li = mate_panel_applets_loading; li != NULL; li = li->next) {
-		MatePanelAppletToLoad *applet = li->data;
-		if (strcmp (applet->id, id) == 0)
-			return TRUE;
-	}
-	return FALSE;
+	if (!mate_panel_applets_queued_ids)
+		return FALSE;
+
+	return g_hash_table_contains (mate_panel_applets_queued_ids, id);
 }
 
 /* This doesn't do anything if the initial unhide already happened */
@@ -989,6 +999,7 @@ mate_panel_applet_queue_applet_to_load (const char      *id,
 				   gboolean         locked)
 {
 	MatePanelAppletToLoad *applet;
+	guint                  count;
 
 	if (!toplevel_id) {
 		g_warning ("No toplevel on which to load object '%s'\n", id);
@@ -1004,6 +1015,13 @@ mate_panel_applet_queue_applet_to_load (const char      *id,
 	applet->right_stick = right_stick != FALSE;
 	applet->locked      = locked != FALSE;
 
+	if (!mate_panel_applets_queued_ids)
+		mate_panel_applets_queued_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+								       g_free, NULL);
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (mate_panel_applets_queued_ids, id));
+	g_hash_table_insert (mate_panel_applets_queued_ids, g_strdup (id),
+			     GUINT_TO_POINTER (count + 1));
+
 	mate_panel_applets_to_load = g_slist_prepend (mate_panel_applets_to_load, applet);
 }
 
@@ -1193,16 +1211,10 @@ mate_panel_applet_get_id_by_widget (GtkWidget *applet_widget)
 AppletInfo *
 mate_panel_applet_get_by_id (const char *id)
 {
-	GSList *l;
-
-	for (l = registered_applets; l; l = l->next) {
-		AppletInfo *info = l->data;
-
-		if (!strcmp (info->id, id))
-			return info;
-	}
+	if (!registered_applets_by_id)
+		return NULL;
 
-	return NULL;
+	return g_hash_table_lookup (registered_applets_by_id, id);
 }
 
 GSList *
@@ -1281,7 +1293,8 @@ mate_panel_applet_register (GtkWidget       *applet,
 					  G_OBJECT (applet));
 	g_free (locked_changed);
 
-	if (type == PANEL_OBJECT_DRAWER) {
+	/* drawers get their toplevel when they're first opened */
+	if (type == PANEL_OBJECT_DRAWER && ((Drawer *) data)->toplevel) {
 		Drawer *drawer = data;
 		PanelWidget *assoc_panel;
 
@@ -1299,6 +1312,10 @@ mate_panel_applet_register (GtkWidget       *applet,
 
 	registered_applets = g_slist_append (registered_applets, info);
 
+	if (!registered_applets_by_id)
+		registered_applets_by_id = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_replace (registered_applets_by_id, info->id, info);
+
 	if (panel_widget_add (panel, applet, locked, pos, exactpos) == -1 &&
 	    panel_widget_add (panel, applet, locked, 0, TRUE) == -1) {
 		GSList *l;
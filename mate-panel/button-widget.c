@@ -20,8 +20,21 @@
 
 #define BUTTON_WIDGET_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), BUTTON_TYPE_WIDGET, ButtonWidgetPrivate))
 
+/* A decoded icon, shared by all the buttons showing the same icon at the
+ * same size; it goes away with the last button using it */
+typedef struct {
+	char             *key;
+	GtkIconTheme     *icon_theme;
+	cairo_surface_t  *surface;
+	cairo_surface_t  *surface_hc;
+	int               ref_count;
+	gboolean          cached;
+} ButtonIcon;
+
 struct _ButtonWidgetPrivate {
 	GtkIconTheme     *icon_theme;
+	ButtonIcon       *icon;
+	/* owned by icon */
 	cairo_surface_t  *surface;
 	cairo_surface_t  *surface_hc;
 
@@ -113,10 +126,147 @@ make_hc_surface (cairo_surface_t *surface)
 	cr = cairo_create (new);
 	cairo_set_operator (cr, CAIRO_OPERATOR_DEST_IN);
 	cairo_mask_surface (cr, surface, 0, 0);
+	cairo_destroy (cr);
 
 	return new;
 }
 
+static GHashTable *button_icon_cache = NULL;
+static guint       button_icon_decodes = 0;
+static gint64      button_icon_decode_time = 0;
+static guint       button_icon_report_id = 0;
+
+/* Icons are decoded in bursts, e.g. when a panel is resized; report each
+ * burst once rather than every icon */
+static gboolean
+button_icon_report_decodes (gpointer user_data)
+{
+	g_debug ("Decoded %u button icons in %.1f ms",
+		 button_icon_decodes, button_icon_decode_time / 1000.0);
+
+	button_icon_decodes = 0;
+	button_icon_decode_time = 0;
+	button_icon_report_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+button_icon_unref (ButtonIcon *icon)
+{
+	if (icon == NULL || --icon->ref_count > 0)
+		return;
+
+	if (icon->cached)
+		g_hash_table_remove (button_icon_cache, icon->key);
+
+	if (icon->surface)
+		cairo_surface_destroy (icon->surface);
+	if (icon->surface_hc)
+		cairo_surface_destroy (icon->surface_hc);
+
+	g_free (icon->key);
+	g_free (icon);
+}
+
+static void
+button_icon_cache_invalidate (GtkIconTheme *icon_theme)
+{
+	GHashTableIter  iter;
+	ButtonIcon     *icon;
+
+	if (button_icon_cache == NULL)
+		return;
+
+	/* Buttons keep their icon until they reload it */
+	g_hash_table_iter_init (&iter, button_icon_cache);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &icon)) {
+		if (icon->icon_theme == icon_theme) {
+			icon->cached = FALSE;
+			g_hash_table_iter_remove (&iter);
+		}
+	}
+}
+
+static void
+button_icon_cache_watch_theme (GtkIconTheme *icon_theme)
+{
+	if (g_object_get_data (G_OBJECT (icon_theme), "panel-button-icon-cache"))
+		return;
+
+	g_object_set_data (G_OBJECT (icon_theme), "panel-button-icon-cache",
+			   GINT_TO_POINTER (TRUE));
+
+	/* Connected before the handler of any button, so that the buttons
+	 * don't get the old icons back when they reload */
+	g_signal_connect (icon_theme, "changed",
+			  G_CALLBACK (button_icon_cache_invalidate), NULL);
+}
+
+static ButtonIcon *
+button_icon_lookup (GtkIconTheme *icon_theme,
+		    const char   *filename,
+		    int           size,
+		    int           desired_width,
+		    int           desired_height,
+		    int           scale)
+{
+	ButtonIcon *icon;
+	char       *key;
+	char       *error = NULL;
+	gint64      start;
+
+	if (button_icon_cache == NULL)
+		button_icon_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+	key = g_strdup_printf ("%p:%d:%d:%d:%d:%s", (gpointer) icon_theme,
+			       size, desired_width, desired_height, scale,
+			       filename);
+
+	icon = g_hash_table_lookup (button_icon_cache, key);
+	if (icon != NULL) {
+		g_free (key);
+		icon->ref_count++;
+		return icon;
+	}
+
+	start = g_get_monotonic_time ();
+
+	icon = g_new0 (ButtonIcon, 1);
+	icon->key = key;
+	icon->icon_theme = icon_theme;
+	icon->ref_count = 1;
+
+	icon->surface = panel_load_icon (icon_theme, filename, size,
+					 desired_width, desired_height,
+					 &error);
+	if (error) {
+		//FIXME: this is not rendered at button->priv->size
+		icon->surface = gtk_icon_theme_load_surface (gtk_icon_theme_get_default (),
+							     "image-missing",
+							     GTK_ICON_SIZE_BUTTON,
+							     scale,
+							     NULL,
+							     GTK_ICON_LOOKUP_FORCE_SVG | GTK_ICON_LOOKUP_USE_BUILTIN,
+							     NULL);
+		g_free (error);
+	}
+
+	icon->surface_hc = make_hc_surface (icon->surface);
+
+	icon->cached = TRUE;
+	g_hash_table_insert (button_icon_cache, icon->key, icon);
+
+	button_icon_decodes++;
+	button_icon_decode_time += g_get_monotonic_time () - start;
+
+	if (button_icon_report_id == 0)
+		button_icon_report_id = g_idle_add (button_icon_report_decodes,
+						    NULL);
+
+	return icon;
+}
+
 static void
 button_widget_realize(GtkWidget *widget)
 {
@@ -127,6 +277,7 @@ button_widget_realize(GtkWidget *widget)
 	GTK_WIDGET_CLASS (button_widget_parent_class)->realize (widget);
 
 	BUTTON_WIDGET (widget)->priv->icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (widget));
+	button_icon_cache_watch_theme (BUTTON_WIDGET (widget)->priv->icon_theme);
 	g_signal_connect_object (BUTTON_WIDGET (widget)->priv->icon_theme,
 				 "changed",
 				 G_CALLBACK (button_widget_icon_theme_changed),
@@ -149,52 +300,48 @@ button_widget_unrealize (GtkWidget *widget)
 static void
 button_widget_unset_surfaces (ButtonWidget *button)
 {
-	if (button->priv->surface)
-		cairo_surface_destroy (button->priv->surface);
-	button->priv->surface = NULL;
+	button_icon_unref (button->priv->icon);
+	button->priv->icon = NULL;
 
-	if (button->priv->surface_hc)
-		cairo_surface_destroy (button->priv->surface_hc);
+	button->priv->surface = NULL;
 	button->priv->surface_hc = NULL;
 }
 
 static void
 button_widget_reload_surface (ButtonWidget *button)
 {
-	button_widget_unset_surfaces (button);
+	ButtonIcon *old_icon;
+
+	/* look the new icon up before releasing the old one, which may be
+	 * the same */
+	old_icon = button->priv->icon;
+	button->priv->icon = NULL;
+	button->priv->surface = NULL;
+	button->priv->surface_hc = NULL;
 
-	if (button->priv->size <= 1 || button->priv->icon_theme == NULL)
+	if (button->priv->size <= 1 || button->priv->icon_theme == NULL) {
+		button_icon_unref (old_icon);
 		return;
+	}
 
 	if (button->priv->filename != NULL &&
 	    button->priv->filename [0] != '\0') {
 		gint scale;
-		char *error = NULL;
 
 		scale = gtk_widget_get_scale_factor (GTK_WIDGET (button));
 
-		button->priv->surface =
-			panel_load_icon (button->priv->icon_theme,
-					 button->priv->filename,
-					 button->priv->size * scale,
-					 button->priv->orientation & PANEL_VERTICAL_MASK   ? button->priv->size * scale : -1,
-					 button->priv->orientation & PANEL_HORIZONTAL_MASK ? button->priv->size * scale: -1,
-					 &error);
-		if (error) {
-			//FIXME: this is not rendered at button->priv->size
-			GtkIconTheme *icon_theme = gtk_icon_theme_get_default();
-			button->priv->surface = gtk_icon_theme_load_surface (icon_theme,
-							       "image-missing",
-							       GTK_ICON_SIZE_BUTTON,
-							       scale,
-							       NULL,
-							       GTK_ICON_LOOKUP_FORCE_SVG | GTK_ICON_LOOKUP_USE_BUILTIN,
-							       NULL);
-			g_free (error);
-		}
+		button->priv->icon =
+			button_icon_lookup (button->priv->icon_theme,
+					    button->priv->filename,
+					    button->priv->size * scale,
+					    button->priv->orientation & PANEL_VERTICAL_MASK   ? button->priv->size * scale : -1,
+					    button->priv->orientation & PANEL_HORIZONTAL_MASK ? button->priv->size * scale: -1,
+					    scale);
+		button->priv->surface = button->priv->icon->surface;
+		button->priv->surface_hc = button->priv->icon->surface_hc;
 	}
 
-	button->priv->surface_hc = make_hc_surface (button->priv->surface);
+	button_icon_unref (old_icon);
 
 	gtk_widget_queue_resize (GTK_WIDGET (button));
 }
@@ -605,6 +752,7 @@ button_widget_init (ButtonWidget *button)
 	button->priv = BUTTON_WIDGET_GET_PRIVATE (button);
 
 	button->priv->icon_theme = NULL;
+	button->priv->icon       = NULL;
 	button->priv->surface    = NULL;
 	button->priv->surface_hc = NULL;
 
@@ -19,6 +19,8 @@ extern "C" {
 /* Internal functions */
 /* event handlers */
 
+static gboolean  drawer_is_open                 (Drawer           *drawer);
+
 static void  drawer_click                       (GtkWidget        *widget,
                                                  Drawer           *drawer);
 
@@ -100,6 +102,8 @@ static void  toplevel_destroyed                 (GtkWidget        *widget,
 static void  destroy_drawer                     (GtkWidget        *widget,
                                                  Drawer           *drawer);
 
+static void  free_drawer                        (Drawer           *drawer);
+
 static void  drawer_deletion_response           (GtkWidget        *dialog,
                                                  int               response,
                                                  Drawer           *drawer);
@@ -112,8 +116,7 @@ static PanelToplevel *create_drawer_toplevel    (const char       *drawer_id,
 static void  set_tooltip_and_name               (Drawer           *drawer,
                                                  const char       *tooltip);
 
-static Drawer *create_drawer_applet             (PanelToplevel    *toplevel,
-                                                 PanelToplevel    *parent_toplevel,
+static Drawer *create_drawer_applet             (const char       *toplevel_id,
                                                  const char       *tooltip,
                                                  const char       *custom_icon,
                                                  gboolean          use_custom_icon,
@@ -122,7 +125,6 @@ static Drawer *create_drawer_applet             (PanelToplevel    *toplevel,
 static void  panel_drawer_connect_to_gsettings  (Drawer           *drawer);
 
 static void  load_drawer_applet                 (char             *toplevel_id,
-                                                 GSettings        *settings,
                                                  const char       *custom_icon,
                                                  gboolean          use_custom_icon,
                                                  const char       *tooltip,
@@ -40,10 +40,20 @@
 /* event handlers */
 
 
+static gboolean
+drawer_is_open (Drawer *drawer)
+{
+    return drawer->toplevel != NULL &&
+           !panel_toplevel_get_is_hidden (drawer->toplevel);
+}
+
 static void
 drawer_click (GtkWidget *widget,
               Drawer    *drawer)
 {
+    if (!panel_drawer_ensure_toplevel (drawer))
+        return;
+
     if (!panel_toplevel_get_is_hidden (drawer->toplevel))
         panel_toplevel_hide (drawer->toplevel, FALSE, -1);
     else
@@ -80,7 +90,7 @@ key_press_drawer (GtkWidget   *widget,
     case GDK_KEY_Up:
     case GDK_KEY_KP_Up:
         if (orient == GTK_ORIENTATION_HORIZONTAL) {
-            if (!panel_toplevel_get_is_hidden (drawer->toplevel))
+            if (drawer_is_open (drawer))
                 drawer_focus_panel_widget (drawer, GTK_DIR_TAB_BACKWARD);
         } else {
             /* let default focus movement happen */
@@ -90,7 +100,7 @@ key_press_drawer (GtkWidget   *widget,
     case GDK_KEY_Left:
     case GDK_KEY_KP_Left:
         if (orient == GTK_ORIENTATION_VERTICAL) {
-            if (!panel_toplevel_get_is_hidden (drawer->toplevel))
+            if (drawer_is_open (drawer))
                 drawer_focus_panel_widget (drawer, GTK_DIR_TAB_BACKWARD);
         } else {
             /* let default focus movement happen */
@@ -100,7 +110,7 @@ key_press_drawer (GtkWidget   *widget,
     case GDK_KEY_Down:
     case GDK_KEY_KP_Down:
         if (orient == GTK_ORIENTATION_HORIZONTAL) {
-            if (!panel_toplevel_get_is_hidden (drawer->toplevel))
+            if (drawer_is_open (drawer))
                 drawer_focus_panel_widget (drawer, GTK_DIR_TAB_FORWARD);
         } else {
             /* let default focus movement happen */
@@ -110,7 +120,7 @@ key_press_drawer (GtkWidget   *widget,
     case GDK_KEY_Right:
     case GDK_KEY_KP_Right:
         if (orient == GTK_ORIENTATION_VERTICAL) {
-            if (!panel_toplevel_get_is_hidden (drawer->toplevel))
+            if (drawer_is_open (drawer))
                 drawer_focus_panel_widget (drawer, GTK_DIR_TAB_FORWARD);
         } else {
             /* let default focus movement happen */
@@ -118,7 +128,8 @@ key_press_drawer (GtkWidget   *widget,
         }
         break;
     case GDK_KEY_Escape:
-        panel_toplevel_hide (drawer->toplevel, FALSE, -1);
+        if (drawer->toplevel)
+            panel_toplevel_hide (drawer->toplevel, FALSE, -1);
         break;
     default:
         retval = FALSE;
@@ -189,6 +200,9 @@ drag_motion_cb (GtkWidget          *widget,
     if (!panel_check_dnd_target_data (widget, context, &info, NULL))
         return FALSE;
 
+    if (!panel_drawer_ensure_toplevel (drawer))
+        return FALSE;
+
     panel_widget = panel_toplevel_get_panel_widget (drawer->toplevel);
 
     if (!panel_check_drop_forbidden (panel_widget, context, info, time_))
@@ -244,6 +258,11 @@ drag_data_received_cb (GtkWidget          *widget,
         return;
     }
 
+    if (!panel_drawer_ensure_toplevel (drawer)) {
+        gtk_drag_finish (context, FALSE, FALSE, time_);
+        return;
+    }
+
     panel_widget = panel_toplevel_get_panel_widget (drawer->toplevel);
 
     panel_receive_dnd_data (panel_widget, info, -1, selection_data, context, time_);
@@ -289,7 +308,7 @@ drawer_button_size_allocated (GtkWidget     *widget,
                               GtkAllocation *alloc,
                               Drawer        *drawer)
 {
-    if (!gtk_widget_get_realized (widget))
+    if (!gtk_widget_get_realized (widget) || !drawer->toplevel)
         return;
 
     gtk_widget_queue_resize (GTK_WIDGET (drawer->toplevel));
@@ -364,6 +383,14 @@ destroy_drawer (GtkWidget *widget,
     }
 }
 
+static void
+free_drawer (Drawer *drawer)
+{
+    g_free (drawer->tooltip);
+    g_free (drawer->toplevel_id);
+    g_free (drawer);
+}
+
 static void
 drawer_deletion_response (GtkWidget   *dialog,
                           int          response,
@@ -406,17 +433,20 @@ set_tooltip_and_name (Drawer     *drawer,
                       const char *tooltip)
 {
     g_return_if_fail (drawer != NULL);
-    g_return_if_fail (drawer->toplevel != NULL);
 
     if (tooltip != NULL && tooltip [0] != '\0') {
-        panel_toplevel_set_name (drawer->toplevel, tooltip);
+        g_free (drawer->tooltip);
+        drawer->tooltip = g_strdup (tooltip);
+
+        /* the name is set when the toplevel gets built otherwise */
+        if (drawer->toplevel)
+            panel_toplevel_set_name (drawer->toplevel, tooltip);
         panel_util_set_tooltip_text (drawer->button, tooltip);
     }
 }
 
 static Drawer *
-create_drawer_applet (PanelToplevel    *toplevel,
-                      PanelToplevel    *parent_toplevel,
+create_drawer_applet (const char       *toplevel_id,
                       const char       *tooltip,
                       const char       *custom_icon,
                       gboolean          use_custom_icon,
@@ -427,7 +457,7 @@ create_drawer_applet (PanelToplevel    *toplevel,
 
     drawer = g_new0 (Drawer, 1);
 
-    drawer->toplevel = toplevel;
+    drawer->toplevel_id = g_strdup (toplevel_id);
 
     if (!use_custom_icon || !custom_icon || !custom_icon [0]) {
         drawer->button = button_widget_new (PANEL_ICON_DRAWER, TRUE, orientation);
@@ -436,7 +466,7 @@ create_drawer_applet (PanelToplevel    *toplevel,
     }
 
     if (!drawer->button) {
-        g_free (drawer);
+        free_drawer (drawer);
         return NULL;
     }
 
@@ -447,7 +477,6 @@ create_drawer_applet (PanelToplevel    *toplevel,
 
     g_signal_connect (drawer->button, "clicked", G_CALLBACK (drawer_click), drawer);
     g_signal_connect (drawer->button, "key_press_event", G_CALLBACK (key_press_drawer), drawer);
-    g_signal_connect (drawer->toplevel, "key_press_event", G_CALLBACK (key_press_drawer_widget), drawer);
 
 
     gtk_drag_dest_set (drawer->button, 0, NULL, 0, 0);
@@ -460,12 +489,9 @@ create_drawer_applet (PanelToplevel    *toplevel,
 
 
     g_signal_connect (drawer->button, "destroy", G_CALLBACK (destroy_drawer), drawer);
-    g_signal_connect (drawer->toplevel, "destroy", G_CALLBACK (toplevel_destroyed), drawer);
 
     gtk_widget_show (drawer->button);
 
-    panel_toplevel_attach_to_widget (drawer->toplevel, parent_toplevel, GTK_WIDGET (drawer->button));
-
     return drawer;
 }
 
@@ -490,7 +516,6 @@ panel_drawer_connect_to_gsettings (Drawer *drawer)
 
 static void
 load_drawer_applet (char          *toplevel_id,
-                    GSettings     *settings,
                     const char    *custom_icon,
                     gboolean       use_custom_icon,
                     const char    *tooltip,
@@ -501,27 +526,19 @@ load_drawer_applet (char          *toplevel_id,
                     const char    *id)
 {
     PanelOrientation  orientation;
-    PanelToplevel    *toplevel = NULL;
-    Drawer           *drawer = NULL;
+    Drawer           *drawer;
     PanelWidget      *panel_widget;
 
     orientation = panel_toplevel_get_orientation (parent_toplevel);
 
-    if (toplevel_id)
-        toplevel = panel_profile_get_toplevel_by_id (toplevel_id);
-
-    if (!toplevel)
-        toplevel = create_drawer_toplevel (id, settings);
-
-    if (toplevel) {
-        panel_toplevel_hide (toplevel, FALSE, -1);
-        drawer = create_drawer_applet (toplevel,
-                                       parent_toplevel,
-                                       tooltip,
-                                       custom_icon,
-                                       use_custom_icon,
-                                       orientation);
-    }
+    /* The toplevel of the drawer and the objects it contains are only
+     * loaded when the drawer is opened: see
+     * panel_drawer_ensure_toplevel() */
+    drawer = create_drawer_applet (toplevel_id,
+                                   tooltip,
+                                   custom_icon,
+                                   use_custom_icon,
+                                   orientation);
 
     if (!drawer)
         return;
@@ -529,19 +546,18 @@ load_drawer_applet (char          *toplevel_id,
     panel_widget = panel_toplevel_get_panel_widget (parent_toplevel);
 
     drawer->info = mate_panel_applet_register (drawer->button, drawer,
-                                          (GDestroyNotify) g_free,
+                                          (GDestroyNotify) free_drawer,
                                           panel_widget,
                                           locked, pos, exactpos,
                                           PANEL_OBJECT_DRAWER, id);
 
     if (!drawer->info) {
-        gtk_widget_destroy (GTK_WIDGET (toplevel));
+        gtk_widget_destroy (drawer->button);
         return;
     }
 
     g_signal_connect_after (drawer->button, "size_allocate", G_CALLBACK (drawer_button_size_allocated), drawer);
 
-    panel_widget_add_forbidden (panel_toplevel_get_panel_widget (drawer->toplevel));
     panel_widget_set_applet_expandable (panel_widget, GTK_WIDGET (drawer->button), FALSE, TRUE);
     panel_widget_set_applet_size_constrained (panel_widget, GTK_WIDGET (drawer->button), TRUE);
 
@@ -679,15 +695,12 @@ drawer_load_from_gsettings (PanelWidget *panel_widget,
 
     toplevel_id = g_settings_get_string (settings, PANEL_OBJECT_ATTACHED_TOPLEVEL_ID_KEY);
 
-    panel_profile_load_toplevel (toplevel_id);
-
     use_custom_icon = g_settings_get_boolean (settings, PANEL_OBJECT_USE_CUSTOM_ICON_KEY);
     custom_icon = g_settings_get_string (settings, PANEL_OBJECT_CUSTOM_ICON_KEY);
 
     tooltip = g_settings_get_string (settings, PANEL_OBJECT_TOOLTIP_KEY);
 
     load_drawer_applet (toplevel_id,
-                        settings,
                         custom_icon,
                         use_custom_icon,
                         tooltip,
@@ -700,6 +713,7 @@ drawer_load_from_gsettings (PanelWidget *panel_widget,
     g_free (toplevel_id);
     g_free (custom_icon);
     g_free (tooltip);
+    g_object_unref (settings);
 }
 
 void
@@ -725,28 +739,102 @@ panel_drawer_set_dnd_enabled (Drawer   *drawer,
         gtk_drag_source_unset (drawer->button);
 }
 
+PanelToplevel *
+panel_drawer_ensure_toplevel (Drawer *drawer)
+{
+    PanelToplevel *toplevel = NULL;
+    PanelWidget   *parent_panel;
+    PanelWidget   *panel_widget;
+    gint64         start;
+
+    g_return_val_if_fail (drawer != NULL, NULL);
+
+    if (drawer->toplevel)
+        return drawer->toplevel;
+
+    g_return_val_if_fail (drawer->info != NULL, NULL);
+
+    start = g_get_monotonic_time ();
+
+    if (drawer->toplevel_id && drawer->toplevel_id [0]) {
+        toplevel = panel_profile_get_toplevel_by_id (drawer->toplevel_id);
+        if (!toplevel)
+            toplevel = panel_profile_load_toplevel (drawer->toplevel_id);
+    }
+
+    if (!toplevel) {
+        toplevel = create_drawer_toplevel (mate_panel_applet_get_id (drawer->info),
+                                           drawer->info->settings);
+        if (!toplevel)
+            return NULL;
+
+        g_free (drawer->toplevel_id);
+        drawer->toplevel_id = g_strdup (panel_profile_get_toplevel_id (toplevel));
+    }
+
+    drawer->toplevel = toplevel;
+
+    panel_toplevel_hide (toplevel, FALSE, -1);
+
+    if (drawer->tooltip)
+        panel_toplevel_set_name (toplevel, drawer->tooltip);
+
+    g_signal_connect (toplevel, "key_press_event", G_CALLBACK (key_press_drawer_widget), drawer);
+    g_signal_connect (toplevel, "destroy", G_CALLBACK (toplevel_destroyed), drawer);
+
+    /* what mate_panel_applet_register() and panel_widget_add() do for
+     * drawers that already have a toplevel */
+    panel_widget = panel_toplevel_get_panel_widget (toplevel);
+
+    g_object_set_data (G_OBJECT (drawer->button),
+                       MATE_PANEL_APPLET_ASSOC_PANEL_KEY, panel_widget);
+    panel_widget->master_widget = drawer->button;
+    g_object_add_weak_pointer (G_OBJECT (drawer->button),
+                               (gpointer *) &panel_widget->master_widget);
+
+    parent_panel = PANEL_WIDGET (gtk_widget_get_parent (drawer->button));
+    panel_toplevel_attach_to_widget (toplevel, parent_panel->toplevel, drawer->button);
+
+    panel_widget_add_forbidden (panel_widget);
+
+    /* now load what's inside */
+    panel_profile_load_toplevel_objects ();
+
+    g_debug ("Built toplevel %s for drawer %s in %.1f ms",
+             drawer->toplevel_id, mate_panel_applet_get_id (drawer->info),
+             (g_get_monotonic_time () - start) / 1000.0);
+
+    return toplevel;
+}
+
 void
 drawer_query_deletion (Drawer *drawer)
 {
     GtkWidget *dialog;
+    gboolean   has_objects;
 
-     if (drawer->toplevel) {
+    if (drawer->toplevel) {
         PanelWidget *panel_widget;
 
         panel_widget = panel_toplevel_get_panel_widget (drawer->toplevel);
+        has_objects = panel_widget->applet_list != NULL;
+    } else
+        /* never opened: check in the profile instead */
+        has_objects = panel_profile_toplevel_has_objects (drawer->toplevel_id);
 
-        if (!panel_global_config_get_confirm_panel_remove () ||
-            !g_list_length (panel_widget->applet_list)) {
-                panel_profile_delete_object (drawer->info);
-                return;
-        }
+    if (!panel_global_config_get_confirm_panel_remove () || !has_objects) {
+        panel_profile_delete_object (drawer->info);
+        return;
+    }
 
-        dialog = panel_deletion_dialog (drawer->toplevel);
+    if (!panel_drawer_ensure_toplevel (drawer))
+        return;
 
-        g_signal_connect (dialog, "response", G_CALLBACK (drawer_deletion_response), drawer);
+    dialog = panel_deletion_dialog (drawer->toplevel);
 
-        g_signal_connect_object (drawer->toplevel, "destroy", G_CALLBACK (gtk_widget_destroy), dialog, G_CONNECT_SWAPPED);
+    g_signal_connect (dialog, "response", G_CALLBACK (drawer_deletion_response), drawer);
 
-        gtk_widget_show_all (dialog);
-    }
+    g_signal_connect_object (drawer->toplevel, "destroy", G_CALLBACK (gtk_widget_destroy), dialog, G_CONNECT_SWAPPED);
+
+    gtk_widget_show_all (dialog);
 }
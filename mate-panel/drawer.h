@@ -11,7 +11,9 @@ extern "C" {
 typedef struct {
     char          *tooltip;
 
+    /* the toplevel is only built when the drawer is first opened */
     PanelToplevel *toplevel;
+    char          *toplevel_id;
     GtkWidget     *button;
 
     gboolean       opened_for_drag;
@@ -43,6 +45,8 @@ void  drawer_load_from_gsettings                (PanelWidget      *panel_widget,
 void  panel_drawer_set_dnd_enabled              (Drawer           *drawer,
                                                  gboolean          dnd_enabled);
 
+PanelToplevel *panel_drawer_ensure_toplevel     (Drawer           *drawer);
+
 void  drawer_query_deletion                     (Drawer           *drawer);
 
 
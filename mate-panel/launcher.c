@@ -98,6 +98,42 @@ launcher_register_error_dialog (Launcher *launcher,
 			  launcher);
 }
 
+/* Every phase of a launch is timed through here; the timings show up
+ * with G_MESSAGES_DEBUG=all */
+static void
+launcher_log_phase (Launcher   *launcher,
+		    const char *phase,
+		    gint64      start)
+{
+	g_debug ("Launcher %s: %s took %.1f ms", launcher->location, phase,
+		 (g_get_monotonic_time () - start) / 1000.0);
+}
+
+static GDesktopAppInfo *
+launcher_get_app_info (Launcher *launcher)
+{
+	gint64 start;
+
+	if (launcher->app_info != NULL)
+		return launcher->app_info;
+
+	start = g_get_monotonic_time ();
+
+	launcher->app_info = g_desktop_app_info_new_from_keyfile (launcher->key_file);
+
+	launcher_log_phase (launcher, "building the app info", start);
+
+	return launcher->app_info;
+}
+
+static void
+launcher_invalidate_app_info (Launcher *launcher)
+{
+	if (launcher->app_info != NULL)
+		g_object_unref (launcher->app_info);
+	launcher->app_info = NULL;
+}
+
 static void
 launch_url (Launcher *launcher)
 {
@@ -133,24 +169,33 @@ void
 launcher_launch (Launcher  *launcher,
 		 const gchar *action)
 {
-	char *type;
+	char   *type;
+	gint64  start;
 
 	g_return_if_fail (launcher != NULL);
 	g_return_if_fail (launcher->key_file != NULL);
 
+	start = g_get_monotonic_time ();
+
 	if (action == NULL) {
 		type = panel_key_file_get_string (launcher->key_file, "Type");
 	} else {
 		type = NULL;
 	}
 
+	launcher_log_phase (launcher, "reading the key file", start);
+
 	if (type && !strcmp (type, "Link"))
 		launch_url (launcher);
-	else {
+	else if (launcher_get_app_info (launcher) != NULL) {
 		GError *error = NULL;
 
-		panel_launch_key_file (launcher->key_file, NULL,
-				       launcher_get_screen (launcher), action, &error);
+		start = g_get_monotonic_time ();
+		panel_app_info_launch_uris (launcher->app_info, NULL,
+					    launcher_get_screen (launcher), action,
+					    gtk_get_current_event_time (),
+					    &error);
+		launcher_log_phase (launcher, "spawning", start);
 		if (error) {
 			GtkWidget *error_dialog;
 
@@ -183,6 +228,11 @@ drag_data_received_cb (GtkWidget        *widget,
 	int      i;
 	GList   *file_list;
 
+	if (!launcher->key_file) {
+		gtk_drag_finish (context, FALSE, FALSE, time);
+		return;
+	}
+
 	if (panel_global_config_get_enable_animations ()) {
 		cairo_surface_t *surface;
 		surface = button_widget_get_surface (BUTTON_WIDGET (widget));
@@ -199,8 +249,11 @@ drag_data_received_cb (GtkWidget        *widget,
 		file_list = g_list_prepend (file_list, uris[i]);
 	file_list = g_list_reverse (file_list);
 
-	panel_launch_key_file (launcher->key_file, file_list,
-			       launcher_get_screen (launcher), NULL, &error);
+	if (launcher_get_app_info (launcher) != NULL)
+		panel_app_info_launch_uris (launcher->app_info, file_list,
+					    launcher_get_screen (launcher), NULL,
+					    gtk_get_current_event_time (),
+					    &error);
 
 	g_list_free (file_list);
 	g_strfreev (uris);
@@ -245,6 +298,14 @@ free_launcher (gpointer data)
 {
 	Launcher *launcher = data;
 
+	if (launcher->cancellable) {
+		g_cancellable_cancel (launcher->cancellable);
+		g_object_unref (launcher->cancellable);
+		launcher->cancellable = NULL;
+	}
+
+	launcher_invalidate_app_info (launcher);
+
 	if (launcher->key_file)
 		g_key_file_free (launcher->key_file);
 	launcher->key_file = NULL;
@@ -401,6 +462,9 @@ static void
 clicked_cb (Launcher  *launcher,
 		  GtkWidget        *widget)
 {
+	if (!launcher->key_file)
+		return;
+
 	if (panel_global_config_get_enable_animations ()) {
 		cairo_surface_t *surface;
 		surface = button_widget_get_surface (BUTTON_WIDGET (widget));
@@ -432,81 +496,192 @@ clicked_cb (Launcher  *launcher,
 	}
 }
 
-static Launcher *
-create_launcher (const char *location)
+/* Launchers loaded since the last time none was loading, for timing */
+static guint  launchers_loading = 0;
+static guint  launchers_loaded = 0;
+static gint64 launchers_loading_start = 0;
+
+static void
+launcher_loading_started (void)
+{
+	if (launchers_loading == 0) {
+		launchers_loaded = 0;
+		launchers_loading_start = g_get_monotonic_time ();
+	}
+
+	launchers_loading++;
+	launchers_loaded++;
+}
+
+static void
+launcher_loading_done (void)
+{
+	if (--launchers_loading > 0)
+		return;
+
+	g_debug ("Loaded %u launchers in %.1f ms", launchers_loaded,
+		 (g_get_monotonic_time () - launchers_loading_start) / 1000.0);
+}
+
+static void setup_button (Launcher *launcher);
+
+static void
+launcher_load_failed (Launcher *launcher,
+		      GError   *error)
 {
+	g_printerr (_("Unable to open desktop file %s for panel launcher%s%s\n"),
+		    launcher->location,
+		    error ? ": " : "",
+		    error ? error->message : "");
+	if (error)
+		g_error_free (error);
+
+	g_clear_object (&launcher->cancellable);
+	launcher_loading_done ();
+
+	/* this frees the launcher */
+	gtk_widget_destroy (launcher->button);
+}
+
+static void
+launcher_loaded_cb (GObject      *source,
+		    GAsyncResult *result,
+		    gpointer      user_data)
+{
+	Launcher *launcher = user_data;
 	GKeyFile *key_file;
-	gboolean  loaded = FALSE;
-	Launcher *launcher;
 	GError   *error = NULL;
-	char     *new_location;
+	char     *contents;
+	gsize     length;
 
-	if (!location) {
-		g_printerr (_("No URI provided for panel launcher desktop file\n"));
-		return NULL;
-	}
+	if (!g_file_load_contents_finish (G_FILE (source), result,
+					  &contents, &length, NULL, &error)) {
+		char *path = NULL;
 
-	new_location = NULL;
-	key_file = g_key_file_new ();
+		/* the launcher is gone */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_error_free (error);
+			launcher_loading_done ();
+			return;
+		}
 
-	if (!strchr (location, G_DIR_SEPARATOR)) {
-		/* try to first load a file in our config directory, and if it
-		 * doesn't exist there, try to find it in the xdg data dirs */
-		char *path;
+		/* a basename not found in our config directory: try to find
+		 * it in the xdg data dirs */
+		if (!strchr (launcher->location, G_DIR_SEPARATOR) &&
+		    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			path = panel_g_lookup_in_applications_dirs (launcher->location);
 
-		path = panel_make_full_path (NULL, location);
+		if (path) {
+			GFile *file;
+
+			g_error_free (error);
 
-		if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
-			g_free (path);
-			path = panel_g_lookup_in_applications_dirs (location);
 			/* it's important to keep the full path if the desktop
 			 * file comes from a data dir: when the user will edit
 			 * it, we'll want to save it in PANEL_LAUNCHERS_PATH
 			 * with a random name (and not evolution.desktop, eg)
 			 * and having only a basename as location will make
 			 * this impossible */
-			if (path)
-				new_location = g_strdup (path);
-		}
+			g_free (launcher->location);
+			launcher->location = path;
 
-		if (path) {
-			loaded = g_key_file_load_from_file (key_file, path,
-							    G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS,
-							    &error);
-			g_free (path);
+			file = g_file_new_for_path (path);
+			g_file_load_contents_async (file, launcher->cancellable,
+						    launcher_loaded_cb, launcher);
+			g_object_unref (file);
+			return;
 		}
-	} else
-		loaded = panel_key_file_load_from_uri (key_file, location,
-						       G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS,
-						       &error);
-
-	if (!loaded) {
-		g_printerr (_("Unable to open desktop file %s for panel launcher%s%s\n"),
-			    location,
-			    error ? ": " : "",
-			    error ? error->message : "");
-		if (error)
-			g_error_free (error);
 
+		launcher_load_failed (launcher, error);
+		return;
+	}
+
+	key_file = g_key_file_new ();
+	if (!g_key_file_load_from_data (key_file, contents, length,
+					G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS,
+					&error)) {
+		g_free (contents);
 		g_key_file_free (key_file);
-		g_free (new_location);
-		return NULL; /*button is null*/
+		launcher_load_failed (launcher, error);
+		return;
 	}
+	g_free (contents);
 
-	if (!new_location)
-		new_location = g_strdup (location);
+	g_clear_object (&launcher->cancellable);
+	launcher->key_file = key_file;
+
+	/* setup button according to ditem */
+	setup_button (launcher);
+
+	if (launcher->properties_locked) {
+		AppletUserMenu *menu;
+
+		menu = mate_panel_applet_get_callback (launcher->info->user_menu,
+						       "properties");
+		if (menu != NULL)
+			menu->sensitive = FALSE;
+	}
+
+	launcher_loading_done ();
+}
+
+/* Loads the desktop file in the background; the button shows a generic
+ * icon and does nothing until then */
+static void
+launcher_start_loading (Launcher *launcher)
+{
+	GFile *file;
+	char  *scheme;
+
+	scheme = g_uri_parse_scheme (launcher->location);
+
+	if (scheme != NULL)
+		file = g_file_new_for_uri (launcher->location);
+	else if (!strchr (launcher->location, G_DIR_SEPARATOR)) {
+		/* try to first load a file in our config directory, and if it
+		 * doesn't exist there, try to find it in the xdg data dirs */
+		char *dir;
+		char *path;
+
+		dir = panel_launcher_get_personal_path ();
+		path = g_build_filename (dir, launcher->location, NULL);
+		file = g_file_new_for_path (path);
+		g_free (path);
+		g_free (dir);
+	} else
+		file = g_file_new_for_path (launcher->location);
+
+	g_free (scheme);
+
+	launcher_loading_started ();
+
+	launcher->cancellable = g_cancellable_new ();
+	g_file_load_contents_async (file, launcher->cancellable,
+				    launcher_loaded_cb, launcher);
+	g_object_unref (file);
+}
+
+static Launcher *
+create_launcher (const char *location)
+{
+	Launcher *launcher;
+
+	if (!location) {
+		g_printerr (_("No URI provided for panel launcher desktop file\n"));
+		return NULL;
+	}
 
 	launcher = g_new0 (Launcher, 1);
 
 	launcher->info = NULL;
 	launcher->button = NULL;
-	launcher->location = new_location;
-	launcher->key_file = key_file;
+	launcher->location = g_strdup (location);
+	launcher->key_file = NULL;
 	launcher->prop_dialog = NULL;
 	launcher->destroy_handler = 0;
 
-	/* Icon will be setup later */
-	launcher->button = button_widget_new (NULL /* icon */,
+	/* Real icon will be setup once the file is loaded */
+	launcher->button = button_widget_new (PANEL_ICON_LAUNCHER,
 					      FALSE,
 					      PANEL_ORIENTATION_TOP);
 
@@ -547,7 +722,7 @@ setup_actions (Launcher *launcher)
 	const gchar * const *actions;
 	const gchar * const *ptr;
 
-	app_info = g_desktop_app_info_new_from_keyfile (launcher->key_file);
+	app_info = launcher_get_app_info (launcher);
 	if (app_info == NULL)
 		return;
 
@@ -565,8 +740,6 @@ setup_actions (Launcher *launcher)
 		g_free (callback);
 		g_free (action_name);
 	}
-
-	g_object_unref (app_info);
 }
 
 static void
@@ -580,6 +753,9 @@ setup_button (Launcher *launcher)
 
 	g_return_if_fail (launcher != NULL);
 
+	/* the key file may have changed since the app info was parsed */
+	launcher_invalidate_app_info (launcher);
+
 	mate_panel_applet_clear_user_menu (launcher->info);
 
 	mate_panel_applet_add_callback (launcher->info,
@@ -711,6 +887,7 @@ launcher_command_changed (PanelDItemEditor *dialog,
 		if (!old_exec || !exec || strcmp (old_exec, exec))
 			panel_key_file_remove_key (launcher->key_file,
 						   "StartupNotify");
+		launcher_invalidate_app_info (launcher);
 
 		g_free (exec);
 		g_free (old_exec);
@@ -874,8 +1051,7 @@ load_launcher_applet (const char       *location,
 	panel_widget_set_applet_expandable (panel, GTK_WIDGET (launcher->button), FALSE, TRUE);
 	panel_widget_set_applet_size_constrained (panel, GTK_WIDGET (launcher->button), TRUE);
 
-	/* setup button according to ditem */
-	setup_button (launcher);
+	launcher_start_loading (launcher);
 
 	return launcher;
 }
@@ -913,16 +1089,10 @@ launcher_load_from_gsettings (PanelWidget *panel_widget,
 					 TRUE,
 					 id);
 
-	if (launcher) {
-		if (!g_settings_is_writable (settings, PANEL_OBJECT_LAUNCHER_LOCATION_KEY)) {
-			AppletUserMenu *menu;
-
-			menu = mate_panel_applet_get_callback (launcher->info->user_menu,
-							  "properties");
-			if (menu != NULL)
-				menu->sensitive = FALSE;
-		}
-	}
+	/* applied once the launcher is loaded */
+	if (launcher)
+		launcher->properties_locked =
+			!g_settings_is_writable (settings, PANEL_OBJECT_LAUNCHER_LOCATION_KEY);
 
 	g_free (launcher_location);
 	g_object_unref (settings);
@@ -1142,9 +1312,8 @@ find_launcher (const char *path)
 
 		launcher = info->data;
 
-		if (launcher->key_file == NULL)
-			continue;
-
+		/* the key file may still be loading; the location is
+		 * known from the start */
 		if (launcher->location != NULL &&
 		    strcmp (launcher->location, path) == 0)
 			return launcher;
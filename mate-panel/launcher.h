@@ -11,6 +11,8 @@
 #ifndef LAUNCHER_H
 #define LAUNCHER_H
 
+#include <gio/gdesktopappinfo.h>
+
 #include "applet.h"
 #include "panel-widget.h"
 
@@ -23,7 +25,10 @@ typedef struct {
 	GtkWidget         *button;
 
 	char              *location;
-	GKeyFile          *key_file;
+	GKeyFile          *key_file;   /* NULL until the file is loaded */
+	GDesktopAppInfo   *app_info;   /* parsed from key_file on first use */
+	GCancellable      *cancellable;
+	gboolean           properties_locked;
 
 	GtkWidget         *prop_dialog;
 	GSList            *error_dialogs;
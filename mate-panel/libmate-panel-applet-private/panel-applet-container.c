@@ -64,6 +64,7 @@ static const AppletPropertyInfo applet_properties [] = {
 	{ "size",        "Size" },
 	{ "size-hints",  "SizeHints" },
 	{ "background",  "Background" },
+	{ "background-data", "BackgroundData" },
 	{ "flags",       "Flags" },
 	{ "locked",      "Locked" },
 	{ "locked-down", "LockedDown" }
@@ -43,6 +43,7 @@ struct _MatePanelAppletFrameDBusPrivate
 {
 	MatePanelAppletContainer *container;
 	gconstpointer             bg_operation;
+	gboolean                  bg_data_unsupported;
 };
 
 /* Keep in sync with mate-panel-applet.h. Uggh. */
@@ -53,6 +54,13 @@ typedef enum {
 	APPLET_HAS_HANDLE   = 1 << 2
 } MatePanelAppletFlags;
 
+/* Keep in sync with mate-panel-applet.h too. */
+typedef enum {
+	APPLET_NO_BACKGROUND,
+	APPLET_COLOR_BACKGROUND,
+	APPLET_PIXMAP_BACKGROUND
+} MatePanelAppletBackgroundType;
+
 
 static guint
 get_mate_panel_applet_orient (PanelOrientation orientation)
@@ -225,6 +233,9 @@ mate_panel_applet_frame_dbus_change_size (MatePanelAppletFrame *frame,
 					  NULL, NULL, NULL);
 }
 
+static void mate_panel_applet_frame_dbus_change_background (MatePanelAppletFrame    *frame,
+							    PanelBackgroundType  type);
+
 static void
 container_child_background_set (GObject      *source_object,
 				GAsyncResult *res,
@@ -232,10 +243,64 @@ container_child_background_set (GObject      *source_object,
 {
 	MatePanelAppletContainer *container = MATE_PANEL_APPLET_CONTAINER (source_object);
 	MatePanelAppletFrameDBus *frame = MATE_PANEL_APPLET_FRAME_DBUS (user_data);
+	GError                   *error = NULL;
+	GtkWidget                *parent;
 
-	mate_panel_applet_container_child_set_finish (container, res, NULL);
+	mate_panel_applet_container_child_set_finish (container, res, &error);
 
 	frame->priv->bg_operation = NULL;
+
+	if (!error)
+		return;
+
+	/* Applets built against an older libmate-panel-applet only know
+	 * about the string property: remember that and resend. */
+	if (!frame->priv->bg_data_unsupported &&
+	    (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS) ||
+	     g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY))) {
+		frame->priv->bg_data_unsupported = TRUE;
+
+		parent = gtk_widget_get_parent (GTK_WIDGET (frame));
+		if (PANEL_IS_WIDGET (parent))
+			mate_panel_applet_frame_dbus_change_background (
+				MATE_PANEL_APPLET_FRAME (frame),
+				PANEL_WIDGET (parent)->toplevel->background.type);
+	}
+
+	g_error_free (error);
+}
+
+static GVariant *
+mate_panel_applet_frame_dbus_get_background_data (MatePanelAppletFrame *frame)
+{
+	PanelBackgroundType           type;
+	MatePanelAppletBackgroundType applet_type;
+	GdkRGBA                       color;
+	guint32                       xid;
+	int                           x;
+	int                           y;
+
+	if (!_mate_panel_applet_frame_get_background_data (
+			frame, PANEL_WIDGET (gtk_widget_get_parent (GTK_WIDGET (frame))),
+			&type, &color, &xid, &x, &y))
+		return NULL;
+
+	switch (type) {
+	case PANEL_BACK_COLOR:
+		applet_type = APPLET_COLOR_BACKGROUND;
+		break;
+	case PANEL_BACK_IMAGE:
+		applet_type = APPLET_PIXMAP_BACKGROUND;
+		break;
+	default:
+		applet_type = APPLET_NO_BACKGROUND;
+		break;
+	}
+
+	return g_variant_new ("(u(dddd)uii)",
+			      applet_type,
+			      color.red, color.green, color.blue, color.alpha,
+			      xid, x, y);
 }
 
 static void
@@ -244,24 +309,36 @@ mate_panel_applet_frame_dbus_change_background (MatePanelAppletFrame    *frame,
 {
 	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
 	MatePanelAppletFrameDBusPrivate *priv = dbus_frame->priv;
-	char *bg_str;
-
-	bg_str = _mate_panel_applet_frame_get_background_string (
-			frame, PANEL_WIDGET (gtk_widget_get_parent (GTK_WIDGET (frame))), type);
+	const gchar *prop_name;
+	GVariant    *value;
 
-	if (bg_str != NULL) {
-		if (priv->bg_operation)
-			mate_panel_applet_container_cancel_operation (priv->container, priv->bg_operation);
+	if (priv->bg_data_unsupported) {
+		char *bg_str;
 
-		priv->bg_operation = mate_panel_applet_container_child_set (priv->container,
-						  "background",
-						  g_variant_new_string (bg_str),
-						  NULL,
-						  container_child_background_set,
-						  dbus_frame);
+		bg_str = _mate_panel_applet_frame_get_background_string (
+				frame, PANEL_WIDGET (gtk_widget_get_parent (GTK_WIDGET (frame))), type);
+		if (bg_str == NULL)
+			return;
 
+		prop_name = "background";
+		value = g_variant_new_string (bg_str);
 		g_free (bg_str);
+	} else {
+		prop_name = "background-data";
+		value = mate_panel_applet_frame_dbus_get_background_data (frame);
+		if (value == NULL)
+			return;
 	}
+
+	if (priv->bg_operation)
+		mate_panel_applet_container_cancel_operation (priv->container, priv->bg_operation);
+
+	priv->bg_operation = mate_panel_applet_container_child_set (priv->container,
+					  prop_name,
+					  value,
+					  NULL,
+					  container_child_background_set,
+					  dbus_frame);
 }
 
 static void
@@ -23,6 +23,7 @@
 #include <config.h>
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
 #include <string.h>
 
@@ -43,6 +44,22 @@ struct _MatePanelAppletsManagerDBusPrivate
 {
 	GHashTable *applet_factories;
 	GList      *monitors;
+
+	guint       cache_save_id;
+	gboolean    cache_stale;
+
+	/* Supervised host process for SharedHost factories */
+	GPid             host_pid;
+	guint            host_child_watch_id;
+	guint            host_name_watch_id;
+	GDBusConnection *host_connection;
+	GSList          *host_pending;
+	/* factory id -> resident kB it added to the host, for every factory
+	 * asked to load in the running host */
+	GHashTable      *host_factories;
+	/* Restarts after crashes, limited to avoid a crash loop */
+	guint            host_restarts;
+	gint64           host_restarts_start;
 };
 
 typedef gint (* ActivateAppletFunc) (void);
@@ -53,6 +70,7 @@ typedef struct _MatePanelAppletFactoryInfo {
 	gchar              *id;
 	gchar              *location;
 	gboolean            in_process;
+	gboolean            shared_host;
 	GModule            *module;
 	ActivateAppletFunc  activate_applet;
 	GetAppletWidgetFunc get_applet_widget;
@@ -67,6 +85,22 @@ typedef struct _MatePanelAppletFactoryInfo {
 #define MATE_PANEL_APPLET_FACTORY_GROUP "Applet Factory"
 #define MATE_PANEL_APPLETS_EXTENSION    ".mate-panel-applet"
 
+/* The catalogue of factories is cached, so that startup doesn't have to
+ * parse every .mate-panel-applet file. The cache records the mtime of the
+ * applets directories and files it was built from, and the locale used
+ * for the translated names. */
+#define MATE_PANEL_APPLETS_CACHE_VERSION 1
+#define MATE_PANEL_APPLETS_CACHE_TYPE    "(usa(sx)a(sx)a(ssbbsa(ssssas)))"
+
+#define MATE_PANEL_APPLET_HOST_SERVICE_NAME "org.mate.panel.applet.SharedHost"
+#define MATE_PANEL_APPLET_HOST_OBJECT_PATH  "/org/mate/panel/applet/SharedHost"
+#define MATE_PANEL_APPLET_HOST_INTERFACE    "org.mate.panel.applet.SharedHost"
+
+/* A host crashing more often than this is left alone; reloading one of its
+ * applets starts it again */
+#define MATE_PANEL_APPLET_HOST_MAX_RESTARTS   3
+#define MATE_PANEL_APPLET_HOST_RESTART_PERIOD 60
+
 static void
 mate_panel_applet_factory_info_free (MatePanelAppletFactoryInfo *info)
 {
@@ -151,12 +185,15 @@ mate_panel_applets_manager_get_applet_factory_info_from_file (const gchar *filen
 
 	info->in_process = g_key_file_get_boolean (applet_file, MATE_PANEL_APPLET_FACTORY_GROUP,
 						   "InProcess", NULL);
-	if (info->in_process) {
+	if (!info->in_process)
+		info->shared_host = g_key_file_get_boolean (applet_file, MATE_PANEL_APPLET_FACTORY_GROUP,
+							    "SharedHost", NULL);
+	if (info->in_process || info->shared_host) {
 		info->location = g_key_file_get_string (applet_file, MATE_PANEL_APPLET_FACTORY_GROUP,
 							"Location", NULL);
 		if (!info->location) {
-			g_warning ("Bad panel applet file %s: In-process applet without 'Location'",
-				   filename);
+			g_warning ("Bad panel applet file %s: %s applet without 'Location'",
+				   filename, info->in_process ? "In-process" : "Shared host");
 			mate_panel_applet_factory_info_free (info);
 			g_key_file_free (applet_file);
 
@@ -218,6 +255,318 @@ mate_panel_applets_manager_get_applets_dirs (void)
 	return g_slist_reverse (retval);
 }
 
+static gchar *
+applets_cache_get_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "mate-panel",
+				 "applets.cache", NULL);
+}
+
+static gint64
+applets_cache_get_mtime (const gchar *path)
+{
+	GStatBuf buf;
+
+	if (g_stat (path, &buf) != 0)
+		return -1;
+
+	return (gint64) buf.st_mtime;
+}
+
+static const gchar *
+applets_cache_get_locale (void)
+{
+	return g_get_language_names ()[0];
+}
+
+static const gchar *
+nullify_empty (const gchar *str)
+{
+	return str && *str ? str : NULL;
+}
+
+static const gchar *
+empty_if_null (const gchar *str)
+{
+	return str ? str : "";
+}
+
+static GVariant *
+mate_panel_applets_manager_dbus_build_cache (MatePanelAppletsManagerDBus *manager,
+					     GSList                      *dirs)
+{
+	static const gchar *no_ids[] = { NULL };
+	GVariantBuilder     dirs_builder;
+	GVariantBuilder     files_builder;
+	GVariantBuilder     factories_builder;
+	GHashTableIter      iter;
+	gpointer            value;
+	GSList             *d;
+
+	g_variant_builder_init (&dirs_builder, G_VARIANT_TYPE ("a(sx)"));
+	g_variant_builder_init (&files_builder, G_VARIANT_TYPE ("a(sx)"));
+	g_variant_builder_init (&factories_builder, G_VARIANT_TYPE ("a(ssbbsa(ssssas))"));
+
+	for (d = dirs; d; d = g_slist_next (d)) {
+		const gchar *path = (const gchar *) d->data;
+		const gchar *dirent;
+		GDir        *dir;
+
+		g_variant_builder_add (&dirs_builder, "(sx)",
+				       path, applets_cache_get_mtime (path));
+
+		dir = g_dir_open (path, 0, NULL);
+		if (!dir)
+			continue;
+
+		while ((dirent = g_dir_read_name (dir))) {
+			gchar *file;
+
+			if (!g_str_has_suffix (dirent, MATE_PANEL_APPLETS_EXTENSION))
+				continue;
+
+			file = g_build_filename (path, dirent, NULL);
+			g_variant_builder_add (&files_builder, "(sx)",
+					       file, applets_cache_get_mtime (file));
+			g_free (file);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_hash_table_iter_init (&iter, manager->priv->applet_factories);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		MatePanelAppletFactoryInfo *info = (MatePanelAppletFactoryInfo *) value;
+		GVariantBuilder             applets_builder;
+		GList                      *l;
+
+		g_variant_builder_init (&applets_builder, G_VARIANT_TYPE ("a(ssssas)"));
+		for (l = info->applet_list; l; l = g_list_next (l)) {
+			MatePanelAppletInfo *ainfo = (MatePanelAppletInfo *) l->data;
+			const gchar * const *old_ids;
+
+			old_ids = mate_panel_applet_info_get_old_ids (ainfo);
+			g_variant_builder_add (&applets_builder, "(ssss^as)",
+					       mate_panel_applet_info_get_iid (ainfo),
+					       empty_if_null (mate_panel_applet_info_get_name (ainfo)),
+					       empty_if_null (mate_panel_applet_info_get_description (ainfo)),
+					       empty_if_null (mate_panel_applet_info_get_icon (ainfo)),
+					       old_ids ? old_ids : no_ids);
+		}
+
+		g_variant_builder_add (&factories_builder, "(ssbbsa(ssssas))",
+				       info->id,
+				       info->location ? info->location : "",
+				       info->in_process,
+				       info->shared_host,
+				       info->srcdir,
+				       &applets_builder);
+	}
+
+	return g_variant_new ("(usa(sx)a(sx)a(ssbbsa(ssssas)))",
+			      MATE_PANEL_APPLETS_CACHE_VERSION,
+			      applets_cache_get_locale (),
+			      &dirs_builder,
+			      &files_builder,
+			      &factories_builder);
+}
+
+static gboolean
+mate_panel_applets_manager_dbus_save_cache (gpointer user_data)
+{
+	MatePanelAppletsManagerDBus *manager = MATE_PANEL_APPLETS_MANAGER_DBUS (user_data);
+	GVariant *cache;
+	GSList   *dirs;
+	gchar    *filename;
+	gchar    *dirname;
+	GError   *error = NULL;
+
+	manager->priv->cache_save_id = 0;
+
+	if (manager->priv->cache_stale)
+		return FALSE;
+
+	dirs = mate_panel_applets_manager_get_applets_dirs ();
+	cache = g_variant_ref_sink (mate_panel_applets_manager_dbus_build_cache (manager, dirs));
+	g_slist_free_full (dirs, g_free);
+
+	filename = applets_cache_get_filename ();
+	dirname = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dirname, 0700);
+
+	if (!g_file_set_contents (filename,
+				  g_variant_get_data (cache),
+				  g_variant_get_size (cache),
+				  &error)) {
+		g_warning ("Failed to write the applets cache %s: %s",
+			   filename, error->message);
+		g_error_free (error);
+	}
+
+	g_free (dirname);
+	g_free (filename);
+	g_variant_unref (cache);
+
+	return FALSE;
+}
+
+static void
+mate_panel_applets_manager_dbus_queue_save_cache (MatePanelAppletsManagerDBus *manager)
+{
+	if (manager->priv->cache_save_id || manager->priv->cache_stale)
+		return;
+
+	manager->priv->cache_save_id =
+		g_idle_add_full (G_PRIORITY_LOW,
+				 mate_panel_applets_manager_dbus_save_cache,
+				 manager, NULL);
+}
+
+/* We don't drop factories whose file goes away while running, so the
+ * cache can't describe the directories anymore: remove it and let the
+ * next startup rescan. */
+static void
+mate_panel_applets_manager_dbus_invalidate_cache (MatePanelAppletsManagerDBus *manager)
+{
+	gchar *filename;
+
+	manager->priv->cache_stale = TRUE;
+
+	if (manager->priv->cache_save_id) {
+		g_source_remove (manager->priv->cache_save_id);
+		manager->priv->cache_save_id = 0;
+	}
+
+	filename = applets_cache_get_filename ();
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static gboolean
+mate_panel_applets_manager_dbus_load_cache (MatePanelAppletsManagerDBus *manager,
+					    GSList                      *dirs)
+{
+	GMappedFile  *mapped;
+	GBytes       *bytes;
+	GVariant     *cache;
+	GVariant     *child;
+	GVariantIter  iter;
+	GVariant     *applets;
+	gchar        *filename;
+	const gchar  *path;
+	const gchar  *id;
+	const gchar  *location;
+	const gchar  *srcdir;
+	gboolean      in_process;
+	gboolean      shared_host;
+	gint64        mtime;
+	guint32       version;
+	GSList       *d;
+	gboolean      retval = FALSE;
+
+	filename = applets_cache_get_filename ();
+	mapped = g_mapped_file_new (filename, FALSE, NULL);
+	g_free (filename);
+
+	if (!mapped)
+		return FALSE;
+
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+
+	cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (MATE_PANEL_APPLETS_CACHE_TYPE),
+							      bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	g_variant_get_child (cache, 0, "u", &version);
+	if (version != MATE_PANEL_APPLETS_CACHE_VERSION)
+		goto out;
+
+	child = g_variant_get_child_value (cache, 1);
+	if (g_strcmp0 (g_variant_get_string (child, NULL), applets_cache_get_locale ()) != 0) {
+		g_variant_unref (child);
+		goto out;
+	}
+	g_variant_unref (child);
+
+	/* Same directories, in the same order, none of them changed */
+	child = g_variant_get_child_value (cache, 2);
+	if (g_variant_n_children (child) != g_slist_length (dirs)) {
+		g_variant_unref (child);
+		goto out;
+	}
+
+	d = dirs;
+	g_variant_iter_init (&iter, child);
+	while (g_variant_iter_next (&iter, "(&sx)", &path, &mtime)) {
+		if (g_strcmp0 (path, d->data) != 0 ||
+		    mtime != applets_cache_get_mtime (path)) {
+			g_variant_unref (child);
+			goto out;
+		}
+		d = g_slist_next (d);
+	}
+	g_variant_unref (child);
+
+	/* Files rewritten in place don't touch their directory */
+	child = g_variant_get_child_value (cache, 3);
+	g_variant_iter_init (&iter, child);
+	while (g_variant_iter_next (&iter, "(&sx)", &path, &mtime)) {
+		if (mtime != applets_cache_get_mtime (path)) {
+			g_variant_unref (child);
+			goto out;
+		}
+	}
+	g_variant_unref (child);
+
+	child = g_variant_get_child_value (cache, 4);
+	g_variant_iter_init (&iter, child);
+	while (g_variant_iter_next (&iter, "(&s&sbb&s@a(ssssas))",
+				    &id, &location, &in_process, &shared_host,
+				    &srcdir, &applets)) {
+		MatePanelAppletFactoryInfo *info;
+		GVariantIter                applets_iter;
+		const gchar                *iid, *name, *comment, *icon;
+		const gchar               **old_ids;
+
+		info = g_slice_new0 (MatePanelAppletFactoryInfo);
+		info->id = g_strdup (id);
+		info->location = g_strdup (nullify_empty (location));
+		info->in_process = in_process;
+		info->shared_host = shared_host;
+		info->srcdir = g_strdup (srcdir);
+
+		g_variant_iter_init (&applets_iter, applets);
+		while (g_variant_iter_next (&applets_iter, "(&s&s&s&s^a&s)",
+					    &iid, &name, &comment, &icon, &old_ids)) {
+			MatePanelAppletInfo *ainfo;
+
+			ainfo = mate_panel_applet_info_new (iid,
+							    nullify_empty (name),
+							    nullify_empty (comment),
+							    nullify_empty (icon),
+							    old_ids);
+			if (mate_panel_applet_info_get_old_ids (ainfo) != NULL)
+				info->has_old_ids = TRUE;
+
+			info->applet_list = g_list_prepend (info->applet_list, ainfo);
+			g_free (old_ids);
+		}
+		info->applet_list = g_list_reverse (info->applet_list);
+		g_variant_unref (applets);
+
+		g_hash_table_insert (manager->priv->applet_factories, g_strdup (info->id), info);
+	}
+	g_variant_unref (child);
+
+	retval = TRUE;
+
+out:
+	g_variant_unref (cache);
+
+	return retval;
+}
+
 static void
 applets_directory_changed (GFileMonitor     *monitor,
 			   GFile            *file,
@@ -247,6 +596,8 @@ applets_directory_changed (GFileMonitor     *monitor,
 		if (!info)
 			return;
 
+		mate_panel_applets_manager_dbus_queue_save_cache (manager);
+
 		old_info = g_hash_table_lookup (manager->priv->applet_factories, info->id);
 		if (!old_info) {
 			/* New applet, just insert it */
@@ -280,25 +631,64 @@ applets_directory_changed (GFileMonitor     *monitor,
 		g_slist_free (dirs);
 	}
 		break;
+	case G_FILE_MONITOR_EVENT_DELETED: {
+		gchar *filename;
+
+		filename = g_file_get_path (file);
+		if (g_str_has_suffix (filename, MATE_PANEL_APPLETS_EXTENSION))
+			mate_panel_applets_manager_dbus_invalidate_cache (manager);
+		g_free (filename);
+	}
+		break;
 	default:
 		/* Ignore any other change */
 		break;
 	}
 }
 
+static void
+mate_panel_applets_manager_dbus_monitor_dir (MatePanelAppletsManagerDBus *manager,
+					     const gchar                 *path)
+{
+	GFileMonitor *monitor;
+	GFile        *dir_file;
+
+	dir_file = g_file_new_for_path (path);
+	monitor = g_file_monitor_directory (dir_file,
+					    G_FILE_MONITOR_NONE,
+					    NULL, NULL);
+	if (monitor) {
+		g_signal_connect (monitor, "changed",
+				  G_CALLBACK (applets_directory_changed),
+				  manager);
+		manager->priv->monitors = g_list_prepend (manager->priv->monitors, monitor);
+	}
+	g_object_unref (dir_file);
+}
+
 static void
 mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *manager)
 {
 	GSList      *dirs, *d;
 	GDir        *dir;
 	const gchar *dirent;
+	gboolean     cached;
 	GError      *error = NULL;
 
 	dirs = mate_panel_applets_manager_get_applets_dirs ();
+
+	cached = mate_panel_applets_manager_dbus_load_cache (manager, dirs);
+
 	for (d = dirs; d; d = g_slist_next (d)) {
-		GFileMonitor *monitor;
-		GFile        *dir_file;
-		gchar        *path = (gchar *) d->data;
+		gchar *path = (gchar *) d->data;
+
+		if (cached) {
+			if (g_file_test (path, G_FILE_TEST_IS_DIR))
+				mate_panel_applets_manager_dbus_monitor_dir (manager, path);
+			g_free (path);
+
+			continue;
+		}
 
 		dir = g_dir_open (path, 0, &error);
 		if (!dir) {
@@ -310,17 +700,7 @@ mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *
 		}
 
 		/* Monitor dir */
-		dir_file = g_file_new_for_path (path);
-		monitor = g_file_monitor_directory (dir_file,
-						    G_FILE_MONITOR_NONE,
-						    NULL, NULL);
-		if (monitor) {
-			g_signal_connect (monitor, "changed",
-					  G_CALLBACK (applets_directory_changed),
-					  manager);
-			manager->priv->monitors = g_list_prepend (manager->priv->monitors, monitor);
-		}
-		g_object_unref (dir_file);
+		mate_panel_applets_manager_dbus_monitor_dir (manager, path);
 
 		while ((dirent = g_dir_read_name (dir))) {
 			MatePanelAppletFactoryInfo *info;
@@ -349,6 +729,9 @@ mate_panel_applets_manager_dbus_load_applet_infos (MatePanelAppletsManagerDBus *
 	}
 
 	g_slist_free (dirs);
+
+	if (!cached)
+		mate_panel_applets_manager_dbus_queue_save_cache (manager);
 }
 
 static GList *
@@ -392,6 +775,239 @@ get_applet_factory_info (MatePanelAppletsManager *manager,
 	return info;
 }
 
+typedef struct {
+	MatePanelAppletsManagerDBus *manager;
+	gchar                       *factory_id;
+} SharedHostLoad;
+
+static void
+shared_host_load_factory_cb (GObject      *source_object,
+			     GAsyncResult *res,
+			     gpointer      user_data)
+{
+	SharedHostLoad *load = user_data;
+	GHashTable     *host_factories = load->manager->priv->host_factories;
+	GVariant       *retvals;
+	GError         *error = NULL;
+	guint           rss_kb;
+
+	retvals = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+	if (!retvals) {
+		g_warning ("Failed to load %s in the shared applet host: %s",
+			   load->factory_id, error->message);
+		g_error_free (error);
+
+		g_hash_table_remove (host_factories, load->factory_id);
+	} else {
+		g_variant_get (retvals, "(u)", &rss_kb);
+		g_debug ("Factory %s runs in the shared applet host, using %u kB there",
+			 load->factory_id, rss_kb);
+		g_variant_unref (retvals);
+
+		/* unless the host went away in the meantime */
+		if (g_hash_table_contains (host_factories, load->factory_id))
+			g_hash_table_insert (host_factories, g_strdup (load->factory_id),
+					     GUINT_TO_POINTER (rss_kb));
+	}
+
+	g_object_unref (load->manager);
+	g_free (load->factory_id);
+	g_free (load);
+}
+
+static void
+shared_host_load_factory (MatePanelAppletsManagerDBus *manager,
+			  MatePanelAppletFactoryInfo  *info)
+{
+	SharedHostLoad *load;
+
+	if (!g_hash_table_contains (manager->priv->host_factories, info->id))
+		g_hash_table_insert (manager->priv->host_factories,
+				     g_strdup (info->id), GUINT_TO_POINTER (0));
+
+	load = g_new (SharedHostLoad, 1);
+	load->manager = g_object_ref (manager);
+	load->factory_id = g_strdup (info->id);
+
+	g_dbus_connection_call (manager->priv->host_connection,
+				MATE_PANEL_APPLET_HOST_SERVICE_NAME,
+				MATE_PANEL_APPLET_HOST_OBJECT_PATH,
+				MATE_PANEL_APPLET_HOST_INTERFACE,
+				"LoadFactory",
+				g_variant_new ("(ss)", info->id, info->location),
+				G_VARIANT_TYPE ("(u)"),
+				G_DBUS_CALL_FLAGS_NO_AUTO_START,
+				-1, NULL,
+				shared_host_load_factory_cb,
+				load);
+}
+
+static void
+shared_host_appeared (GDBusConnection *connection,
+		      const gchar     *name,
+		      const gchar     *name_owner,
+		      gpointer         user_data)
+{
+	MatePanelAppletsManagerDBus *manager = MATE_PANEL_APPLETS_MANAGER_DBUS (user_data);
+	GSList *l;
+
+	if (manager->priv->host_connection)
+		g_object_unref (manager->priv->host_connection);
+	manager->priv->host_connection = g_object_ref (connection);
+
+	manager->priv->host_pending = g_slist_reverse (manager->priv->host_pending);
+	for (l = manager->priv->host_pending; l; l = l->next) {
+		MatePanelAppletFactoryInfo *info;
+
+		info = g_hash_table_lookup (manager->priv->applet_factories, l->data);
+		if (info)
+			shared_host_load_factory (manager, info);
+	}
+
+	g_slist_free_full (manager->priv->host_pending, g_free);
+	manager->priv->host_pending = NULL;
+}
+
+static void
+shared_host_vanished (GDBusConnection *connection,
+		      const gchar     *name,
+		      gpointer         user_data)
+{
+	MatePanelAppletsManagerDBus *manager = MATE_PANEL_APPLETS_MANAGER_DBUS (user_data);
+
+	g_clear_object (&manager->priv->host_connection);
+}
+
+static gboolean shared_host_spawn (MatePanelAppletsManagerDBus *manager);
+
+static gboolean
+shared_host_may_restart (MatePanelAppletsManagerDBus *manager)
+{
+	MatePanelAppletsManagerDBusPrivate *priv = manager->priv;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+	if (now - priv->host_restarts_start > MATE_PANEL_APPLET_HOST_RESTART_PERIOD * G_USEC_PER_SEC) {
+		priv->host_restarts_start = now;
+		priv->host_restarts = 0;
+	}
+
+	return priv->host_restarts++ < MATE_PANEL_APPLET_HOST_MAX_RESTARTS;
+}
+
+static void
+shared_host_exited (GPid     pid,
+		    gint     status,
+		    gpointer user_data)
+{
+	MatePanelAppletsManagerDBus *manager = MATE_PANEL_APPLETS_MANAGER_DBUS (user_data);
+	MatePanelAppletsManagerDBusPrivate *priv = manager->priv;
+	GHashTableIter iter;
+	gpointer       factory_id;
+	GError *error = NULL;
+
+	g_spawn_close_pid (pid);
+	priv->host_pid = 0;
+	priv->host_child_watch_id = 0;
+
+	/* The host exits by itself once it has no factory left */
+	if (g_spawn_check_exit_status (status, NULL)) {
+		g_hash_table_remove_all (priv->host_factories);
+		return;
+	}
+
+	g_spawn_check_exit_status (status, &error);
+	g_warning ("Shared applet host exited abnormally: %s", error->message);
+	g_error_free (error);
+
+	/* Load the same factories into a new host, so that the applets it
+	 * hosted can be reloaded right away. The applets themselves report
+	 * that they quit through their sockets. */
+	g_hash_table_iter_init (&iter, priv->host_factories);
+	while (g_hash_table_iter_next (&iter, &factory_id, NULL)) {
+		if (!g_slist_find_custom (priv->host_pending, factory_id, (GCompareFunc) g_strcmp0))
+			priv->host_pending = g_slist_prepend (priv->host_pending,
+							      g_strdup (factory_id));
+	}
+	g_hash_table_remove_all (priv->host_factories);
+
+	if (priv->host_pending == NULL)
+		return;
+
+	if (!shared_host_may_restart (manager)) {
+		g_warning ("Shared applet host crashed %d times in %d seconds, not restarting it",
+			   MATE_PANEL_APPLET_HOST_MAX_RESTARTS + 1,
+			   MATE_PANEL_APPLET_HOST_RESTART_PERIOD);
+		g_slist_free_full (priv->host_pending, g_free);
+		priv->host_pending = NULL;
+		return;
+	}
+
+	shared_host_spawn (manager);
+}
+
+static gboolean
+shared_host_spawn (MatePanelAppletsManagerDBus *manager)
+{
+	MatePanelAppletsManagerDBusPrivate *priv = manager->priv;
+	gchar  *argv[2];
+	GError *error = NULL;
+
+	argv[0] = g_build_filename (LIBEXECDIR, "mate-panel-applet-host", NULL);
+	argv[1] = NULL;
+
+	if (!g_spawn_async (NULL, argv, NULL,
+			    G_SPAWN_DO_NOT_REAP_CHILD,
+			    NULL, NULL, &priv->host_pid, &error)) {
+		g_warning ("Failed to start the shared applet host: %s", error->message);
+		g_error_free (error);
+		g_free (argv[0]);
+
+		g_slist_free_full (priv->host_pending, g_free);
+		priv->host_pending = NULL;
+		priv->host_pid = 0;
+
+		return FALSE;
+	}
+	g_free (argv[0]);
+
+	priv->host_child_watch_id = g_child_watch_add (priv->host_pid,
+						       shared_host_exited,
+						       manager);
+
+	if (!priv->host_name_watch_id)
+		priv->host_name_watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION,
+							     MATE_PANEL_APPLET_HOST_SERVICE_NAME,
+							     G_BUS_NAME_WATCHER_FLAGS_NONE,
+							     shared_host_appeared,
+							     shared_host_vanished,
+							     manager, NULL);
+
+	return TRUE;
+}
+
+static gboolean
+shared_host_activate (MatePanelAppletsManagerDBus *manager,
+		      MatePanelAppletFactoryInfo  *info)
+{
+	MatePanelAppletsManagerDBusPrivate *priv = manager->priv;
+
+	if (priv->host_pid != 0 && priv->host_connection) {
+		/* Loading an already loaded factory is a no-op in the host */
+		shared_host_load_factory (manager, info);
+		return TRUE;
+	}
+
+	/* Loaded as soon as the host shows up on the bus */
+	if (!g_slist_find_custom (priv->host_pending, info->id, (GCompareFunc) g_strcmp0))
+		priv->host_pending = g_slist_prepend (priv->host_pending, g_strdup (info->id));
+
+	if (priv->host_pid == 0)
+		return shared_host_spawn (manager);
+
+	return TRUE;
+}
+
 static gboolean
 mate_panel_applets_manager_dbus_factory_activate (MatePanelAppletsManager *manager,
 					     const gchar         *iid)
@@ -404,6 +1020,9 @@ mate_panel_applets_manager_dbus_factory_activate (MatePanelAppletsManager *manag
 	if (!info)
 		return FALSE;
 
+	if (info->shared_host)
+		return shared_host_activate (MATE_PANEL_APPLETS_MANAGER_DBUS (manager), info);
+
 	/* Out-of-process applets are activated by the session bus */
 	if (!info->in_process)
 		return TRUE;
@@ -474,7 +1093,8 @@ mate_panel_applets_manager_dbus_factory_deactivate (MatePanelAppletsManager *man
 	if (!info)
 		return FALSE;
 
-	/* Out-of-process applets are deactivated by the session bus */
+	/* Out-of-process applets are deactivated by the session bus, and
+	 * the shared host exits on its own once it has no applets left */
 	if (!info->in_process)
 		return TRUE;
 
@@ -594,6 +1214,26 @@ mate_panel_applets_manager_dbus_finalize (GObject *object)
 		manager->priv->applet_factories = NULL;
 	}
 
+	if (manager->priv->cache_save_id) {
+		g_source_remove (manager->priv->cache_save_id);
+		manager->priv->cache_save_id = 0;
+	}
+
+	if (manager->priv->host_child_watch_id) {
+		g_source_remove (manager->priv->host_child_watch_id);
+		manager->priv->host_child_watch_id = 0;
+	}
+
+	if (manager->priv->host_name_watch_id) {
+		g_bus_unwatch_name (manager->priv->host_name_watch_id);
+		manager->priv->host_name_watch_id = 0;
+	}
+
+	g_clear_object (&manager->priv->host_connection);
+	g_slist_free_full (manager->priv->host_pending, g_free);
+	manager->priv->host_pending = NULL;
+	g_clear_pointer (&manager->priv->host_factories, g_hash_table_destroy);
+
 	G_OBJECT_CLASS (mate_panel_applets_manager_dbus_parent_class)->finalize (object);
 }
 
@@ -608,6 +1248,8 @@ mate_panel_applets_manager_dbus_init (MatePanelAppletsManagerDBus *manager)
 								 g_str_equal,
 								 (GDestroyNotify) g_free,
 								 (GDestroyNotify) mate_panel_applet_factory_info_free);
+	manager->priv->host_factories = g_hash_table_new_full (g_str_hash, g_str_equal,
+							       g_free, NULL);
 
 	mate_panel_applets_manager_dbus_load_applet_infos (manager);
 }
@@ -30,6 +30,7 @@
 #include <string.h>
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include "panel-glib.h"
 
@@ -50,21 +51,6 @@ _lookup_in_dir (const char *basename,
 	return path;
 }
 
-static char *
-_lookup_in_applications_subdir (const char *basename,
-				const char *dir)
-{
-	char *path;
-
-	path = g_build_filename (dir, "applications", basename, NULL);
-	if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
-		g_free (path);
-		return NULL;
-	}
-
-	return path;
-}
-
 static char *
 _panel_g_lookup_in_data_dirs_internal (const char *basename,
 				       LookupInDir lookup)
@@ -94,11 +80,126 @@ panel_g_lookup_in_data_dirs (const char *basename)
 						      _lookup_in_dir);
 }
 
+static char *
+_lookup_in_applications_subdir (const char *basename,
+				const char *dir)
+{
+	char *path;
+
+	path = g_build_filename (dir, "applications", basename, NULL);
+	if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+		g_free (path);
+		return NULL;
+	}
+
+	return path;
+}
+
+/* Basename -> path of the entries of the applications directories, with
+ * the same precedence as _panel_g_lookup_in_data_dirs_internal(). It is
+ * dropped when one of the directories changes and rebuilt on next use. */
+static GHashTable *applications_index = NULL;
+static GSList     *applications_monitors = NULL;
+
+static void
+_applications_dir_changed (GFileMonitor      *monitor,
+			   GFile             *file,
+			   GFile             *other_file,
+			   GFileMonitorEvent  event_type,
+			   gpointer           user_data)
+{
+	if (event_type == G_FILE_MONITOR_EVENT_CREATED ||
+	    event_type == G_FILE_MONITOR_EVENT_DELETED ||
+	    event_type == G_FILE_MONITOR_EVENT_MOVED_IN ||
+	    event_type == G_FILE_MONITOR_EVENT_MOVED_OUT ||
+	    event_type == G_FILE_MONITOR_EVENT_RENAMED)
+		g_clear_pointer (&applications_index, g_hash_table_destroy);
+}
+
+static void
+_applications_index_add_dir (const char *data_dir,
+			     gboolean    monitor)
+{
+	char       *dir;
+	GDir       *gdir;
+	const char *name;
+
+	dir = g_build_filename (data_dir, "applications", NULL);
+
+	if (monitor) {
+		GFile        *file;
+		GFileMonitor *dir_monitor;
+
+		/* this also works for directories that don't exist yet */
+		file = g_file_new_for_path (dir);
+		dir_monitor = g_file_monitor_directory (file,
+							G_FILE_MONITOR_WATCH_MOVES,
+							NULL, NULL);
+		g_object_unref (file);
+
+		if (dir_monitor) {
+			g_signal_connect (dir_monitor, "changed",
+					  G_CALLBACK (_applications_dir_changed),
+					  NULL);
+			applications_monitors = g_slist_prepend (applications_monitors,
+								 dir_monitor);
+		}
+	}
+
+	gdir = g_dir_open (dir, 0, NULL);
+	if (gdir) {
+		while ((name = g_dir_read_name (gdir)) != NULL) {
+			if (g_hash_table_contains (applications_index, name))
+				continue;
+
+			g_hash_table_insert (applications_index,
+					     g_strdup (name),
+					     g_build_filename (dir, name, NULL));
+		}
+		g_dir_close (gdir);
+	}
+
+	g_free (dir);
+}
+
+static void
+_applications_index_ensure (void)
+{
+	const char * const *system_data_dirs;
+	gboolean            monitor;
+	int                 i;
+
+	if (applications_index != NULL)
+		return;
+
+	applications_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, g_free);
+
+	/* the monitors outlive the index */
+	monitor = applications_monitors == NULL;
+
+	_applications_index_add_dir (g_get_user_data_dir (), monitor);
+
+	system_data_dirs = g_get_system_data_dirs ();
+	for (i = 0; system_data_dirs[i]; i++)
+		_applications_index_add_dir (system_data_dirs[i], monitor);
+}
+
 char *
 panel_g_lookup_in_applications_dirs (const char *basename)
 {
-	return _panel_g_lookup_in_data_dirs_internal (basename,
-						      _lookup_in_applications_subdir);
+	const char *path;
+
+	/* only the top level of the directories is indexed */
+	if (strchr (basename, G_DIR_SEPARATOR) != NULL)
+		return _panel_g_lookup_in_data_dirs_internal (basename,
+							      _lookup_in_applications_subdir);
+
+	_applications_index_ensure ();
+
+	path = g_hash_table_lookup (applications_index, basename);
+
+	return g_strdup (path);
 }
 
 /* Copied from evolution-data-server/libedataserver/e-util.c:
@@ -87,20 +87,18 @@ _panel_key_file_make_executable (const gchar *path)
 	g_object_unref (file);
 }
 
-//FIXME: kill this when bug #309224 is fixed
-gboolean
-panel_key_file_to_file (GKeyFile     *keyfile,
-			const gchar  *file,
-			GError      **error)
+static gboolean
+_panel_key_file_serialize (GKeyFile     *keyfile,
+			   const gchar  *file,
+			   gchar       **filename_out,
+			   gchar       **data_out,
+			   gsize        *length_out,
+			   GError      **error)
 {
 	gchar   *filename;
 	GError  *write_error;
 	gchar   *data;
 	gsize    length;
-	gboolean res;
-
-	g_return_val_if_fail (keyfile != NULL, FALSE);
-	g_return_val_if_fail (file != NULL, FALSE);
 
 	write_error = NULL;
 	data = g_key_file_to_data (keyfile, &length, &write_error);
@@ -137,23 +135,230 @@ panel_key_file_to_file (GKeyFile     *keyfile,
 		length = new_length;
 	}
 
-	res = g_file_set_contents (filename, data, length, &write_error);
+	*filename_out = filename;
+	*data_out = data;
+	*length_out = length;
 
-	if (write_error) {
-		g_propagate_error (error, write_error);
-		g_free (data);
-		g_free (filename);
-		return FALSE;
-	}
+	return TRUE;
+}
 
-	g_free (data);
+/* Only does blocking I/O, so it can be used from a thread */
+static gboolean
+_panel_key_file_write (const gchar  *filename,
+		       const gchar  *data,
+		       gsize         length,
+		       GError      **error)
+{
+	if (!g_file_set_contents (filename, data, length, error))
+		return FALSE;
 
 	_panel_key_file_make_executable (filename);
+
+	return TRUE;
+}
+
+//FIXME: kill this when bug #309224 is fixed
+gboolean
+panel_key_file_to_file (GKeyFile     *keyfile,
+			const gchar  *file,
+			GError      **error)
+{
+	gchar   *filename;
+	gchar   *data;
+	gsize    length;
+	gboolean res;
+
+	g_return_val_if_fail (keyfile != NULL, FALSE);
+	g_return_val_if_fail (file != NULL, FALSE);
+
+	if (!_panel_key_file_serialize (keyfile, file,
+					&filename, &data, &length, error))
+		return FALSE;
+
+	res = _panel_key_file_write (filename, data, length, error);
+
+	g_free (data);
 	g_free (filename);
 
 	return res;
 }
 
+/* There is at most one write per file running at any time. Requests
+ * coming while it runs only keep their data for the next write, so that
+ * the latest one wins; their tasks complete with that next write. */
+typedef struct {
+	gchar  *filename;
+
+	gchar  *data;
+	gsize   length;
+	GSList *tasks;
+
+	gchar  *next_data;
+	gsize   next_length;
+	GSList *next_tasks;
+} PanelKeyFileWriter;
+
+static GHashTable *key_file_writers = NULL;
+
+static void _panel_key_file_writer_start (PanelKeyFileWriter *writer);
+
+static void
+_panel_key_file_writer_free (PanelKeyFileWriter *writer)
+{
+	g_free (writer->filename);
+	g_free (writer->data);
+	g_free (writer->next_data);
+	g_slist_free_full (writer->tasks, g_object_unref);
+	g_slist_free_full (writer->next_tasks, g_object_unref);
+	g_free (writer);
+}
+
+static void
+_panel_key_file_writer_thread (GTask        *task,
+			       gpointer      source_object,
+			       gpointer      task_data,
+			       GCancellable *cancellable)
+{
+	PanelKeyFileWriter *writer = task_data;
+	GError             *error = NULL;
+
+	if (_panel_key_file_write (writer->filename,
+				   writer->data, writer->length, &error))
+		g_task_return_boolean (task, TRUE);
+	else
+		g_task_return_error (task, error);
+}
+
+static void
+_panel_key_file_writer_done (GObject      *source,
+			     GAsyncResult *result,
+			     gpointer      user_data)
+{
+	PanelKeyFileWriter *writer = user_data;
+	GSList             *tasks, *l;
+	GError             *error = NULL;
+
+	g_task_propagate_boolean (G_TASK (result), &error);
+
+	/* detach the tasks first: their callbacks might queue a new write */
+	tasks = writer->tasks;
+	writer->tasks = NULL;
+	g_free (writer->data);
+	writer->data = NULL;
+
+	if (writer->next_tasks) {
+		writer->data = writer->next_data;
+		writer->length = writer->next_length;
+		writer->tasks = writer->next_tasks;
+		writer->next_data = NULL;
+		writer->next_tasks = NULL;
+
+		_panel_key_file_writer_start (writer);
+	} else
+		g_hash_table_remove (key_file_writers, writer->filename);
+
+	for (l = tasks; l; l = l->next) {
+		GTask *task = l->data;
+
+		if (error)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_boolean (task, TRUE);
+
+		g_object_unref (task);
+	}
+	g_slist_free (tasks);
+
+	if (error)
+		g_error_free (error);
+}
+
+static void
+_panel_key_file_writer_start (PanelKeyFileWriter *writer)
+{
+	GTask *task;
+
+	task = g_task_new (NULL, NULL, _panel_key_file_writer_done, writer);
+	g_task_set_task_data (task, writer, NULL);
+	g_task_run_in_thread (task, _panel_key_file_writer_thread);
+	g_object_unref (task);
+}
+
+/* Like panel_key_file_to_file(), but the file is written in a thread.
+ * The key file is serialized right away, so it can be changed or freed
+ * as soon as this returns. */
+void
+panel_key_file_to_file_async (GKeyFile            *keyfile,
+			      const gchar         *file,
+			      GAsyncReadyCallback  callback,
+			      gpointer             user_data)
+{
+	PanelKeyFileWriter *writer;
+	GTask              *task;
+	gchar              *filename;
+	gchar              *data;
+	gsize               length;
+	GError             *error = NULL;
+
+	g_return_if_fail (keyfile != NULL);
+	g_return_if_fail (file != NULL);
+
+	task = g_task_new (NULL, NULL, callback, user_data);
+	g_task_set_source_tag (task, panel_key_file_to_file_async);
+
+	if (!_panel_key_file_serialize (keyfile, file,
+					&filename, &data, &length, &error)) {
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+
+	if (!key_file_writers)
+		key_file_writers = g_hash_table_new_full (g_str_hash, g_str_equal,
+							  NULL,
+							  (GDestroyNotify) _panel_key_file_writer_free);
+
+	writer = g_hash_table_lookup (key_file_writers, filename);
+
+	if (writer) {
+		g_free (writer->next_data);
+		writer->next_data = data;
+		writer->next_length = length;
+		writer->next_tasks = g_slist_append (writer->next_tasks, task);
+
+		g_free (filename);
+		return;
+	}
+
+	writer = g_new0 (PanelKeyFileWriter, 1);
+	writer->filename = filename;
+	writer->data = data;
+	writer->length = length;
+	writer->tasks = g_slist_append (NULL, task);
+
+	g_hash_table_insert (key_file_writers, writer->filename, writer);
+
+	_panel_key_file_writer_start (writer);
+}
+
+gboolean
+panel_key_file_to_file_finish (GAsyncResult  *result,
+			       GError       **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* For programs about to exit: runs the main loop until all the writes
+ * started with panel_key_file_to_file_async() are done */
+void
+panel_key_file_flush_writes (void)
+{
+	while (key_file_writers && g_hash_table_size (key_file_writers) > 0)
+		g_main_context_iteration (NULL, TRUE);
+}
+
 gboolean
 panel_key_file_load_from_uri (GKeyFile       *keyfile,
 			      const gchar    *uri,
@@ -28,6 +28,7 @@
 #define PANEL_KEYFILE_H
 
 #include "glib.h"
+#include <gio/gio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +39,13 @@ GKeyFile *panel_key_file_new_desktop  (void);
 gboolean  panel_key_file_to_file      (GKeyFile       *keyfile,
 				       const gchar    *file,
 				       GError        **error);
+void      panel_key_file_to_file_async  (GKeyFile            *keyfile,
+					 const gchar         *file,
+					 GAsyncReadyCallback  callback,
+					 gpointer             user_data);
+gboolean  panel_key_file_to_file_finish (GAsyncResult        *result,
+					 GError             **error);
+void      panel_key_file_flush_writes   (void);
 gboolean panel_key_file_load_from_uri (GKeyFile       *keyfile,
 				       const gchar    *uri,
 				       GKeyFileFlags   flags,
@@ -105,16 +105,22 @@ panel_app_info_launch_uris (GDesktopAppInfo   *appinfo,
 	GdkAppLaunchContext *context;
 	GError              *local_error;
 	gboolean             retval;
+	gint64               start;
+	gint64               context_time;
 
 	g_return_val_if_fail (G_IS_DESKTOP_APP_INFO (appinfo), FALSE);
 	g_return_val_if_fail (GDK_IS_SCREEN (screen), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	start = g_get_monotonic_time ();
+
 	GdkDisplay *display = gdk_display_get_default ();
 	context = gdk_display_get_app_launch_context (display);
 	gdk_app_launch_context_set_screen (context, screen);
 	gdk_app_launch_context_set_timestamp (context, timestamp);
 
+	context_time = g_get_monotonic_time ();
+
 	local_error = NULL;
 	if (action == NULL) {
 		retval = g_desktop_app_info_launch_uris_as_manager (appinfo, uris,
@@ -129,6 +135,13 @@ panel_app_info_launch_uris (GDesktopAppInfo   *appinfo,
 
 	g_object_unref (context);
 
+	g_debug ("Launched '%s': context setup %.1f ms, spawn %.1f ms",
+		 g_app_info_get_id (G_APP_INFO (appinfo)) ?
+		 g_app_info_get_id (G_APP_INFO (appinfo)) :
+		 g_app_info_get_name (G_APP_INFO (appinfo)),
+		 (context_time - start) / 1000.0,
+		 (g_get_monotonic_time () - context_time) / 1000.0);
+
 	if ((local_error == NULL) && (retval == TRUE))
 		return TRUE;
 
@@ -171,15 +184,21 @@ panel_launch_key_file (GKeyFile   *keyfile,
 {
 	GDesktopAppInfo *appinfo;
 	gboolean         retval;
+	gint64           start;
 
 	g_return_val_if_fail (keyfile != NULL, FALSE);
 	g_return_val_if_fail (GDK_IS_SCREEN (screen), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	start = g_get_monotonic_time ();
+
 	appinfo = g_desktop_app_info_new_from_keyfile (keyfile);
 	if (appinfo == NULL)
 		return FALSE;
 
+	g_debug ("Built app info from key file in %.1f ms",
+		 (g_get_monotonic_time () - start) / 1000.0);
+
 	retval = panel_app_info_launch_uris (appinfo,
 					     uri_list, screen, action,
 					     gtk_get_current_event_time (),
@@ -196,11 +215,13 @@ panel_launch_desktop_file (const char  *desktop_file,
 {
 	GDesktopAppInfo *appinfo;
 	gboolean         retval;
+	gint64           start;
 
 	g_return_val_if_fail (desktop_file != NULL, FALSE);
 	g_return_val_if_fail (GDK_IS_SCREEN (screen), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	start = g_get_monotonic_time ();
 	appinfo = NULL;
 
 	if (g_path_is_absolute (desktop_file))
@@ -218,6 +239,9 @@ panel_launch_desktop_file (const char  *desktop_file,
 	if (appinfo == NULL)
 		return FALSE;
 
+	g_debug ("Read and parsed '%s' in %.1f ms", desktop_file,
+		 (g_get_monotonic_time () - start) / 1000.0);
+
 	retval = panel_app_info_launch_uris (appinfo, NULL, screen, NULL,
 					     gtk_get_current_event_time (),
 					     error);
@@ -0,0 +1,81 @@
+/*
+ * slow-fs.c: LD_PRELOAD module making file writes slow, for tests
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* g_file_set_contents() fsyncs the temporary file only when the target
+ * already has contents, but always renames it into place: both are
+ * delayed by SLOW_FS_DELAY milliseconds (500 by default), like a
+ * network-mounted home directory would. */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Lets a test check that it runs with this module preloaded */
+int slow_fs_preloaded = 1;
+
+static void
+slow_fs_delay (void)
+{
+	const char *delay;
+
+	delay = getenv ("SLOW_FS_DELAY");
+	usleep ((delay ? atoi (delay) : 500) * 1000);
+}
+
+int
+fsync (int fd)
+{
+	static int (*real_fsync) (int);
+
+	if (!real_fsync)
+		real_fsync = dlsym (RTLD_NEXT, "fsync");
+
+	slow_fs_delay ();
+
+	return real_fsync (fd);
+}
+
+int
+fdatasync (int fd)
+{
+	static int (*real_fdatasync) (int);
+
+	if (!real_fdatasync)
+		real_fdatasync = dlsym (RTLD_NEXT, "fdatasync");
+
+	slow_fs_delay ();
+
+	return real_fdatasync (fd);
+}
+
+int
+rename (const char *oldpath,
+	const char *newpath)
+{
+	static int (*real_rename) (const char *, const char *);
+
+	if (!real_rename)
+		real_rename = dlsym (RTLD_NEXT, "rename");
+
+	slow_fs_delay ();
+
+	return real_rename (oldpath, newpath);
+}
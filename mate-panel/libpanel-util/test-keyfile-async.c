@@ -0,0 +1,188 @@
+/*
+ * test-keyfile-async.c: checks that panel_key_file_to_file_async()
+ * doesn't block the main loop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* Meant to run with slow-fs preloaded, so that every write takes a while.
+ * A timeout ticks on the main loop while the file is written; it must
+ * keep firing, and the writes must still complete with the latest data. */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "panel-keyfile.h"
+
+/* The exit status automake uses for skipped tests */
+#define EXIT_SKIP 77
+
+#define TICK_INTERVAL 20
+
+#define N_WRITES 3
+
+static guint    n_ticks = 0;
+static guint    n_ticks_at_first_write = 0;
+static guint    n_writes_done = 0;
+static gboolean failed = FALSE;
+
+static gboolean
+tick_cb (gpointer user_data)
+{
+	n_ticks++;
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+write_done_cb (GObject      *source,
+	       GAsyncResult *result,
+	       gpointer      user_data)
+{
+	GError *error = NULL;
+
+	if (!panel_key_file_to_file_finish (result, &error)) {
+		g_printerr ("Write %d failed: %s\n",
+			    GPOINTER_TO_INT (user_data), error->message);
+		g_error_free (error);
+		failed = TRUE;
+	}
+
+	if (n_writes_done++ == 0)
+		n_ticks_at_first_write = n_ticks;
+}
+
+static GKeyFile *
+make_key_file (int n)
+{
+	GKeyFile *keyfile;
+	char     *name;
+
+	keyfile = panel_key_file_new_desktop ();
+
+	name = g_strdup_printf ("Launcher %d", n);
+	g_key_file_set_string (keyfile, "Desktop Entry", "Name", name);
+	g_key_file_set_string (keyfile, "Desktop Entry", "Exec", "true");
+	g_free (name);
+
+	return keyfile;
+}
+
+int
+main (int argc, char **argv)
+{
+	GKeyFile *keyfile;
+	GError   *error = NULL;
+	char     *dir;
+	char     *file;
+	char     *name;
+	guint     tick_id;
+	gint64    start;
+	gint64    elapsed;
+	int       delay;
+	int       i;
+
+	if (dlsym (RTLD_DEFAULT, "slow_fs_preloaded") == NULL) {
+		g_print ("slow-fs is not preloaded, skipping\n");
+		return EXIT_SKIP;
+	}
+
+	delay = g_getenv ("SLOW_FS_DELAY") ? atoi (g_getenv ("SLOW_FS_DELAY")) : 500;
+
+	dir = g_dir_make_tmp ("mate-panel-test-XXXXXX", &error);
+	if (!dir) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+	file = g_build_filename (dir, "test.desktop", NULL);
+
+	tick_id = g_timeout_add (TICK_INTERVAL, tick_cb, NULL);
+
+	/* The first write runs right away; the next ones are queued while
+	 * it runs and must be written together, once, afterwards */
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < N_WRITES; i++) {
+		keyfile = make_key_file (i);
+		panel_key_file_to_file_async (keyfile, file,
+					      write_done_cb, GINT_TO_POINTER (i));
+		g_key_file_free (keyfile);
+	}
+
+	while (n_writes_done < N_WRITES)
+		g_main_context_iteration (NULL, TRUE);
+
+	elapsed = (g_get_monotonic_time () - start) / 1000;
+
+	g_source_remove (tick_id);
+
+	g_print ("%d writes done in %" G_GINT64_FORMAT " ms, "
+		 "the main loop ticked %u times (%u during the first write)\n",
+		 N_WRITES, elapsed, n_ticks, n_ticks_at_first_write);
+
+	if (failed)
+		goto out;
+
+	if (elapsed < delay) {
+		g_printerr ("The writes took %" G_GINT64_FORMAT " ms, less than "
+			    "the %d ms delay of slow-fs\n", elapsed, delay);
+		failed = TRUE;
+	}
+
+	/* Allow for a loaded machine: half of the expected ticks is plenty
+	 * to tell a running main loop from a blocked one */
+	if (n_ticks_at_first_write < (guint) delay / TICK_INTERVAL / 2) {
+		g_printerr ("The main loop was blocked during the write\n");
+		failed = TRUE;
+	}
+
+	keyfile = g_key_file_new ();
+	if (!g_key_file_load_from_file (keyfile, file, G_KEY_FILE_NONE, &error)) {
+		g_printerr ("Cannot read back %s: %s\n", file, error->message);
+		g_error_free (error);
+		failed = TRUE;
+	} else {
+		name = g_key_file_get_string (keyfile, "Desktop Entry", "Name", NULL);
+		if (g_strcmp0 (name, "Launcher 2") != 0) {
+			g_printerr ("Expected the last write to win, got '%s'\n",
+				    name);
+			failed = TRUE;
+		}
+		g_free (name);
+	}
+	g_key_file_free (keyfile);
+
+	if (!g_file_test (file, G_FILE_TEST_IS_EXECUTABLE)) {
+		g_printerr ("%s is not executable\n", file);
+		failed = TRUE;
+	}
+
+out:
+	g_unlink (file);
+	g_rmdir (dir);
+	g_free (file);
+	g_free (dir);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -219,5 +219,8 @@ main (int argc, char * argv[])
 	if (dialogs > 0)
 		gtk_main ();
 
+	/* the last changes might still be being written */
+	panel_key_file_flush_writes ();
+
         return 0;
 }
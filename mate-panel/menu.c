@@ -34,6 +34,7 @@
 #include <matemenu-tree.h>
 
 #include <libpanel-util/panel-keyfile.h>
+#include <libpanel-util/panel-launch.h>
 #include <libpanel-util/panel-xdg.h>
 
 #include "launcher.h"
@@ -89,8 +90,20 @@ static void
 activate_app_def (GtkWidget      *menuitem,
 		  MateMenuTreeEntry *entry)
 {
+	GDesktopAppInfo  *appinfo;
 	const char       *path;
 
+	/* the menu tree already parsed the entry, launch that rather than
+	 * reading the desktop file again */
+	appinfo = matemenu_tree_entry_get_app_info (entry);
+	if (appinfo != NULL) {
+		panel_app_info_launch_uris (appinfo, NULL,
+					    menuitem_to_screen (menuitem), NULL,
+					    gtk_get_current_event_time (),
+					    NULL);
+		return;
+	}
+
 	path = matemenu_tree_entry_get_desktop_file_path (entry);
 	panel_menu_item_activate_desktop_file (menuitem, path);
 }
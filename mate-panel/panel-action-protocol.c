@@ -52,6 +52,97 @@ static Atom atom_gnome_panel_action_main_menu  = None;
 static Atom atom_gnome_panel_action_run_dialog = None;
 static Atom atom_mate_panel_action_kill_dialog = None;
 
+/* Main menu used when there is neither a menu bar nor a menu button. It is
+ * kept around between requests (it reloads itself when the menu tree
+ * changes) and is destroyed along with the panel it belongs to. */
+static GtkWidget *main_menu = NULL;
+static gint64     main_menu_request_time = 0;
+
+static void
+panel_action_protocol_main_menu_mapped (GtkWidget *menu)
+{
+	if (main_menu_request_time == 0)
+		return;
+
+	g_debug ("Main menu mapped %.1f ms after the action request",
+		 (g_get_monotonic_time () - main_menu_request_time) / 1000.0);
+	main_menu_request_time = 0;
+}
+
+static void
+panel_action_protocol_main_menu_deactivated (GtkWidget   *menu,
+					     PanelWidget *panel_widget)
+{
+	panel_toplevel_pop_autohide_disabler (panel_widget->toplevel);
+}
+
+static GtkWidget *
+panel_action_protocol_ensure_main_menu (PanelWidget *panel_widget)
+{
+	GtkWidget       *toplevel;
+	GtkStyleContext *context;
+
+	if (main_menu != NULL &&
+	    g_object_get_data (G_OBJECT (main_menu), "menu_panel") == panel_widget)
+		return main_menu;
+
+	if (main_menu != NULL)
+		gtk_widget_destroy (main_menu);
+
+	main_menu = create_main_menu (panel_widget);
+
+	g_signal_connect (main_menu, "destroy",
+			  G_CALLBACK (gtk_widget_destroyed), &main_menu);
+	g_signal_connect_object (panel_widget, "destroy",
+				 G_CALLBACK (gtk_widget_destroy), main_menu,
+				 G_CONNECT_SWAPPED);
+
+	g_signal_connect (main_menu, "deactivate",
+			  G_CALLBACK (panel_action_protocol_main_menu_deactivated),
+			  panel_widget);
+	g_signal_connect (main_menu, "map",
+			  G_CALLBACK (panel_action_protocol_main_menu_mapped),
+			  NULL);
+
+/* Set menu and it's toplevel window to follow panel theme */
+	toplevel = gtk_widget_get_toplevel (main_menu);
+	context = gtk_widget_get_style_context (GTK_WIDGET(toplevel));
+	gtk_style_context_add_class(context,"gnome-panel-menu-bar");
+	gtk_style_context_add_class(context,"mate-panel-menu-bar");
+
+	return main_menu;
+}
+
+static gboolean
+panel_action_protocol_has_menu (GdkScreen *screen)
+{
+	AppletInfo *info;
+
+	if (mate_panel_applet_get_by_type (PANEL_OBJECT_MENU_BAR, screen))
+		return TRUE;
+
+	info = mate_panel_applet_get_by_type (PANEL_OBJECT_MENU, screen);
+	if (info && !panel_menu_button_get_use_menu_path (PANEL_MENU_BUTTON (info->widget)))
+		return TRUE;
+
+	return FALSE;
+}
+
+/* Runs once the in-process objects are loaded: if none of them can show
+ * the main menu, build ours now so that the first request does not have
+ * to wait for the menu tree. */
+static gboolean
+panel_action_protocol_prewarm_main_menu (gpointer data)
+{
+	if (panels == NULL)
+		return G_SOURCE_REMOVE;
+
+	if (!panel_action_protocol_has_menu (gdk_screen_get_default ()))
+		panel_action_protocol_ensure_main_menu (panels->data);
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 panel_action_protocol_main_menu (GdkScreen *screen,
 				 guint32    activate_time, GdkEvent  *event)
@@ -61,12 +152,14 @@ panel_action_protocol_main_menu (GdkScreen *screen,
 	AppletInfo  *info;
 	GdkVisual *visual;
 	GtkWidget *toplevel;
-	GtkStyleContext *context;
 	GdkSeat *seat;
 	GdkDevice *device;
 
+	main_menu_request_time = g_get_monotonic_time ();
+
 	info = mate_panel_applet_get_by_type (PANEL_OBJECT_MENU_BAR, screen);
 	if (info) {
+		main_menu_request_time = 0;
 		panel_menu_bar_popup_menu (PANEL_MENU_BAR (info->widget),
 					   activate_time);
 		return;
@@ -74,13 +167,20 @@ panel_action_protocol_main_menu (GdkScreen *screen,
 
 	info = mate_panel_applet_get_by_type (PANEL_OBJECT_MENU, screen);
 	if (info && !panel_menu_button_get_use_menu_path (PANEL_MENU_BUTTON (info->widget))) {
+		main_menu_request_time = 0;
 		panel_menu_button_popup_menu (PANEL_MENU_BUTTON (info->widget),
 					      1, activate_time);
 		return;
 	}
 
 	panel_widget = panels->data;
-	menu = create_main_menu (panel_widget);
+	menu = panel_action_protocol_ensure_main_menu (panel_widget);
+
+	/* already up, e.g. the key was pressed twice */
+	if (gtk_widget_get_visible (menu)) {
+		main_menu_request_time = 0;
+		return;
+	}
 
 	panel_toplevel_push_autohide_disabler (panel_widget->toplevel);
 
@@ -90,10 +190,6 @@ panel_action_protocol_main_menu (GdkScreen *screen,
 /* Fix any failures of compiz/other wm's to communicate with gtk for transparency */
 	visual = gdk_screen_get_rgba_visual(screen);
 	gtk_widget_set_visual(GTK_WIDGET(toplevel), visual);
-/* Set menu and it's toplevel window to follow panel theme */
-	context = gtk_widget_get_style_context (GTK_WIDGET(toplevel));
-	gtk_style_context_add_class(context,"gnome-panel-menu-bar");
-	gtk_style_context_add_class(context,"mate-panel-menu-bar");
 
 	seat = gdk_display_get_default_seat (gdk_display_get_default());
 	device = gdk_seat_get_pointer (seat);
@@ -199,4 +295,10 @@ panel_action_protocol_init (void)
 
 	/* We'll filter event sent on non-root windows later */
 	gdk_window_add_filter (NULL, panel_action_protocol_filter, NULL);
+
+	/* lower priority than the initial loading of the panel objects, so
+	 * that we know whether a menu bar or menu button is there */
+	g_idle_add_full (G_PRIORITY_LOW,
+			 panel_action_protocol_prewarm_main_menu,
+			 NULL, NULL);
 }
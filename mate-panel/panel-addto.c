@@ -75,11 +75,24 @@ typedef struct {
 	GSList       *settings_list;
 
 	gchar        *search_text;
+	gchar        *search_key;
+	guint         search_serial;
+	gboolean      search_narrowed;
+	/* PanelAddtoItemInfo -> PanelAddtoSearchResult, for this dialog's
+	 * searches only: the static items are shared by all the dialogs */
+	GHashTable   *search_results;
 	gchar        *applet_search_text;
 
+	GSList       *pending_levels;
+	guint         populate_id;
+	gint64        populate_start;
+
 	int           insertion_position;
 } PanelAddtoDialog;
 
+/* Rows added to the application model per idle iteration */
+#define PANEL_ADDTO_POPULATE_BATCH 100
+
 static GQuark panel_addto_dialog_quark = 0;
 
 typedef enum {
@@ -105,13 +118,29 @@ typedef struct {
 	char                  *menu_path;
 	char                  *iid;
 	gboolean               static_data;
+
+	/* Casefolded name and description, built on first search */
+	char                  *search_key;
 } PanelAddtoItemInfo;
 
+typedef struct {
+	guint    serial;
+	gboolean match;
+} PanelAddtoSearchResult;
+
 typedef struct {
 	GSList             *children;
 	PanelAddtoItemInfo  item_info;
 } PanelAddtoAppList;
 
+/* A level of the application tree that is not fully in the model yet */
+typedef struct {
+	GtkTreeIter  parent;
+	gboolean     has_parent;
+	gboolean     separator_before;
+	GSList      *items;
+} PanelAddtoPendingLevel;
+
 static PanelAddtoItemInfo special_addto_items [] = {
 
 	{ PANEL_ADDTO_LAUNCHER_NEW,
@@ -633,19 +662,64 @@ panel_addto_make_application_list (GSList             **parent_list,
 	*parent_list = g_slist_reverse (*parent_list);
 }
 
-static void
-panel_addto_populate_application_model (GtkTreeStore *store,
-					GtkTreeIter  *parent,
-					GSList       *app_list)
+static PanelAddtoPendingLevel *
+panel_addto_pending_level_new (GtkTreeIter *parent,
+			       GSList      *items)
 {
-	PanelAddtoAppList *data;
-	GtkTreeIter        iter;
-	char              *text;
-	GSList            *app;
+	PanelAddtoPendingLevel *level;
 
-	for (app = app_list; app != NULL; app = app->next) {
-		data = app->data;
-		gtk_tree_store_append (store, &iter, parent);
+	level = g_new0 (PanelAddtoPendingLevel, 1);
+	if (parent) {
+		level->parent = *parent;
+		level->has_parent = TRUE;
+	}
+	level->items = items;
+
+	return level;
+}
+
+/* Rows are appended depth-first, a batch at a time, so that the dialog
+ * shows up before the whole menu is in the model. The tree store has
+ * persistent iters, so the parent of a pending level stays valid. */
+static gboolean
+panel_addto_populate_application_model (gpointer user_data)
+{
+	PanelAddtoDialog *dialog = user_data;
+	GtkTreeStore     *store;
+	int               count;
+
+	store = GTK_TREE_STORE (dialog->application_model);
+
+	for (count = 0; count < PANEL_ADDTO_POPULATE_BATCH && dialog->pending_levels; ) {
+		PanelAddtoPendingLevel *level = dialog->pending_levels->data;
+		PanelAddtoAppList      *data;
+		GtkTreeIter             iter;
+		char                   *text;
+
+		if (level->separator_before) {
+			gtk_tree_store_append (store, &iter, NULL);
+			gtk_tree_store_set (store, &iter,
+					    COLUMN_ICON_NAME, NULL,
+					    COLUMN_TEXT, NULL,
+					    COLUMN_DATA, NULL,
+					    COLUMN_SEARCH, NULL,
+					    -1);
+			level->separator_before = FALSE;
+			count++;
+		}
+
+		if (!level->items) {
+			dialog->pending_levels = g_slist_delete_link (dialog->pending_levels,
+								      dialog->pending_levels);
+			g_free (level);
+			continue;
+		}
+
+		data = level->items->data;
+		level->items = level->items->next;
+
+		gtk_tree_store_append (store, &iter,
+				       level->has_parent ? &level->parent : NULL);
 
 		text = panel_addto_make_text (data->item_info.name,
 					      data->item_info.description);
@@ -655,14 +729,42 @@ panel_addto_populate_application_model (GtkTreeStore *store,
 				    COLUMN_DATA, &(data->item_info),
 				    COLUMN_SEARCH, data->item_info.name,
 				    -1);
-
 		g_free (text);
+		count++;
 
 		if (data->children != NULL)
-			panel_addto_populate_application_model (store,
-								&iter,
-								data->children);
+			dialog->pending_levels = g_slist_prepend (dialog->pending_levels,
+								  panel_addto_pending_level_new (&iter, data->children));
 	}
+
+	if (dialog->pending_levels)
+		return TRUE;
+
+	g_debug ("Application model populated in %" G_GINT64_FORMAT " ms",
+		 (g_get_monotonic_time () - dialog->populate_start) / 1000);
+
+	dialog->populate_id = 0;
+
+	return FALSE;
+}
+
+static void
+panel_addto_queue_application_list (PanelAddtoDialog *dialog,
+				    GSList           *app_list,
+				    gboolean          separator_before)
+{
+	PanelAddtoPendingLevel *level;
+
+	level = panel_addto_pending_level_new (NULL, app_list);
+	level->separator_before = separator_before;
+
+	/* Top-level lists are populated in the order they were queued */
+	dialog->pending_levels = g_slist_append (dialog->pending_levels, level);
+
+	if (!dialog->populate_id)
+		dialog->populate_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+						       panel_addto_populate_application_model,
+						       dialog, NULL);
 }
 
 static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
@@ -675,6 +777,8 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 	if (dialog->filter_application_model != NULL)
 		return;
 
+	dialog->populate_start = g_get_monotonic_time ();
+
 	store = gtk_tree_store_new(NUMBER_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_POINTER, G_TYPE_STRING);
 
 	tree = matemenu_tree_new ("mate-applications.menu", MATEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
@@ -687,7 +791,7 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 	if ((root = matemenu_tree_get_root_directory (tree)) != NULL )
 	{
 		panel_addto_make_application_list(&dialog->application_list, root, "mate-applications.menu");
-		panel_addto_populate_application_model(store, NULL, dialog->application_list);
+		panel_addto_queue_application_list(dialog, dialog->application_list, FALSE);
 
 		matemenu_tree_item_unref(root);
 	}
@@ -703,13 +807,8 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 
 	if ((root = matemenu_tree_get_root_directory(tree)))
 	{
-		GtkTreeIter iter;
-
-		gtk_tree_store_append(store, &iter, NULL);
-		gtk_tree_store_set(store, &iter, COLUMN_ICON_NAME, NULL, COLUMN_TEXT, NULL, COLUMN_DATA, NULL, COLUMN_SEARCH, NULL, -1);
-
 		panel_addto_make_application_list(&dialog->settings_list, root, "mate-settings.menu");
-		panel_addto_populate_application_model(store, NULL, dialog->settings_list);
+		panel_addto_queue_application_list(dialog, dialog->settings_list, TRUE);
 
 		matemenu_tree_item_unref(root);
 	}
@@ -909,6 +1008,10 @@ panel_addto_dialog_free_item_info (PanelAddtoItemInfo *item_info)
 	if (item_info->menu_path != NULL)
 		g_free (item_info->menu_path);
 	item_info->menu_path = NULL;
+
+	if (item_info->search_key != NULL)
+		g_free (item_info->search_key);
+	item_info->search_key = NULL;
 }
 
 static void
@@ -945,10 +1048,25 @@ panel_addto_dialog_free (PanelAddtoDialog *dialog)
 					     G_CALLBACK (panel_addto_name_notify),
 					     dialog);
 
+	if (dialog->populate_id)
+		g_source_remove (dialog->populate_id);
+	dialog->populate_id = 0;
+
+	g_slist_free_full (dialog->pending_levels, g_free);
+	dialog->pending_levels = NULL;
+
 	if (dialog->search_text)
 		g_free (dialog->search_text);
 	dialog->search_text = NULL;
 
+	if (dialog->search_key)
+		g_free (dialog->search_key);
+	dialog->search_key = NULL;
+
+	if (dialog->search_results)
+		g_hash_table_destroy (dialog->search_results);
+	dialog->search_results = NULL;
+
 	if (dialog->applet_search_text)
 		g_free (dialog->applet_search_text);
 	dialog->applet_search_text = NULL;
@@ -1032,17 +1150,53 @@ panel_addto_name_notify (GSettings        *settings,
 	g_free (name);
 }
 
+static char *
+panel_addto_make_search_key (const char *text)
+{
+	char *normalized;
+	char *key;
+
+	normalized = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+	if (!normalized)
+		return g_strdup ("");
+
+	key = g_utf8_casefold (normalized, -1);
+	g_free (normalized);
+
+	return key;
+}
+
+/* The name and description are folded once per item; the search text
+ * is folded once per keystroke, so filtering a row is a plain strstr().
+ * Static items keep their key for the lifetime of the panel. */
+static const char *
+panel_addto_item_get_search_key (PanelAddtoItemInfo *data)
+{
+	if (!data->search_key) {
+		char *text;
+
+		text = g_strconcat (data->name ? data->name : "", "\n",
+				    data->description ? data->description : "",
+				    NULL);
+		data->search_key = panel_addto_make_search_key (text);
+		g_free (text);
+	}
+
+	return data->search_key;
+}
+
 static gboolean
 panel_addto_filter_func (GtkTreeModel *model,
 			 GtkTreeIter  *iter,
 			 gpointer      userdata)
 {
-	PanelAddtoDialog   *dialog;
-	PanelAddtoItemInfo *data;
+	PanelAddtoDialog       *dialog;
+	PanelAddtoItemInfo     *data;
+	PanelAddtoSearchResult *result;
 
 	dialog = (PanelAddtoDialog *) userdata;
 
-	if (!dialog->search_text || !dialog->search_text[0])
+	if (!dialog->search_key || !dialog->search_key[0])
 		return TRUE;
 
 	gtk_tree_model_get (model, iter, COLUMN_DATA, &data, -1);
@@ -1056,10 +1210,29 @@ panel_addto_filter_func (GtkTreeModel *model,
 	    gtk_tree_store_iter_depth (GTK_TREE_STORE (model), iter) == 0)
 		return TRUE;
 
-	return (panel_g_utf8_strstrcase (data->name,
-					 dialog->search_text) != NULL ||
-	        panel_g_utf8_strstrcase (data->description,
-					 dialog->search_text) != NULL);
+	result = g_hash_table_lookup (dialog->search_results, data);
+	if (result == NULL) {
+		result = g_new0 (PanelAddtoSearchResult, 1);
+		g_hash_table_insert (dialog->search_results, data, result);
+	}
+
+	if (result->serial == dialog->search_serial)
+		return result->match;
+
+	/* When the search text only grew, an item that didn't match the
+	 * previous text can't match the new one either */
+	if (dialog->search_narrowed && result->serial != 0 &&
+	    result->serial == dialog->search_serial - 1 &&
+	    !result->match) {
+		result->serial = dialog->search_serial;
+		return FALSE;
+	}
+
+	result->serial = dialog->search_serial;
+	result->match = strstr (panel_addto_item_get_search_key (data),
+				dialog->search_key) != NULL;
+
+	return result->match;
 }
 
 static void
@@ -1068,6 +1241,7 @@ panel_addto_search_entry_changed (GtkWidget        *entry,
 {
 	GtkTreeModel *model;
 	char         *new_text;
+	char         *key;
 	GtkTreeIter   iter;
 	GtkTreePath  *path;
 
@@ -1084,6 +1258,16 @@ panel_addto_search_entry_changed (GtkWidget        *entry,
 		g_free (dialog->search_text);
 	dialog->search_text = new_text;
 
+	key = panel_addto_make_search_key (new_text);
+	dialog->search_narrowed = dialog->search_key &&
+				  dialog->search_key[0] &&
+				  strstr (key, dialog->search_key) != NULL;
+	g_free (dialog->search_key);
+	dialog->search_key = key;
+	/* Serial 0 is never current, so fresh items are always matched */
+	if (++dialog->search_serial == 0)
+		dialog->search_serial = 1;
+
 	model = gtk_tree_view_get_model (GTK_TREE_VIEW (dialog->tree_view));
 	gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (model));
 
@@ -1220,8 +1404,11 @@ panel_addto_dialog_new (PanelWidget *panel_widget)
 	GtkCellRenderer *renderer;
 	GtkTreeSelection *selection;
 	GtkTreeViewColumn *column;
+	gint icon_width;
 
 	dialog = g_new0 (PanelAddtoDialog, 1);
+	dialog->search_results = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							NULL, g_free);
 
 	g_object_set_qdata_full (G_OBJECT (panel_widget->toplevel),
 				 panel_addto_dialog_quark,
@@ -1343,6 +1530,17 @@ panel_addto_dialog_new (PanelWidget *panel_widget)
 					   COLUMN_TEXT);
 	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
 
+	/* With every column fixed, the tree view only asks the renderers
+	 * about the rows it shows, so icons are only looked up in the theme
+	 * for those instead of for the whole menu. */
+	gtk_icon_size_lookup (panel_add_to_icon_get_size (), &icon_width, NULL);
+	column = gtk_tree_view_get_column (GTK_TREE_VIEW (dialog->tree_view),
+					   COLUMN_ICON_NAME);
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_fixed_width (column, icon_width + 2 * 4);
+	gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (dialog->tree_view),
+					     TRUE);
+
 	g_signal_connect (selection, "changed",
 			  G_CALLBACK (panel_addto_selection_changed),
 			  dialog);
@@ -1393,8 +1591,13 @@ panel_addto_present (GtkMenuItem *item,
 	height = MIN (MAX_ADDTOPANEL_HEIGHT, 3 * (screen_height / 4));
 
 	if (!dialog) {
+		gint64 start = g_get_monotonic_time ();
+
 		dialog = panel_addto_dialog_new (panel_widget);
 		panel_addto_present_applets (dialog);
+
+		g_debug ("Add to Panel dialog created in %" G_GINT64_FORMAT " ms",
+			 (g_get_monotonic_time () - start) / 1000);
 	}
 
 	dialog->insertion_position = pd ? pd->insertion_pos : -1;
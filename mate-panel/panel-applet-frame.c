@@ -649,19 +649,17 @@ _mate_panel_applet_frame_update_size_hints (MatePanelAppletFrame *frame,
 					    n_elements);
 }
 
-char *
-_mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
-					   PanelWidget         *panel,
-					   PanelBackgroundType  type)
+static void
+mate_panel_applet_frame_get_background_origin (MatePanelAppletFrame *frame,
+					       int                  *x,
+					       int                  *y)
 {
 	GtkAllocation allocation;
-	int x;
-	int y;
 
 	gtk_widget_get_allocation (GTK_WIDGET (frame), &allocation);
 
-	x = allocation.x;
-	y = allocation.y;
+	*x = allocation.x;
+	*y = allocation.y;
 
 	if (frame->priv->has_handle) {
 		switch (frame->priv->orientation) {
@@ -669,21 +667,47 @@ _mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
 		case PANEL_ORIENTATION_BOTTOM:
 			if (gtk_widget_get_direction (GTK_WIDGET (frame)) !=
 			    GTK_TEXT_DIR_RTL)
-				x += frame->priv->handle_rect.width;
+				*x += frame->priv->handle_rect.width;
 			break;
 		case PANEL_ORIENTATION_LEFT:
 		case PANEL_ORIENTATION_RIGHT:
-			y += frame->priv->handle_rect.height;
+			*y += frame->priv->handle_rect.height;
 			break;
 		default:
 			g_assert_not_reached ();
 			break;
 		}
 	}
+}
+
+char *
+_mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
+					   PanelWidget         *panel,
+					   PanelBackgroundType  type)
+{
+	int x;
+	int y;
+
+	mate_panel_applet_frame_get_background_origin (frame, &x, &y);
 
 	return panel_background_make_string (&panel->toplevel->background, x, y);
 }
 
+gboolean
+_mate_panel_applet_frame_get_background_data (MatePanelAppletFrame    *frame,
+					      PanelWidget             *panel,
+					      PanelBackgroundType     *type,
+					      GdkRGBA                 *color,
+					      guint32                 *xid,
+					      int                     *x,
+					      int                     *y)
+{
+	mate_panel_applet_frame_get_background_origin (frame, x, y);
+
+	return panel_background_make_data (&panel->toplevel->background,
+					   type, color, xid);
+}
+
 static void
 mate_panel_applet_frame_reload_response (GtkWidget        *dialog,
 				    int               response,
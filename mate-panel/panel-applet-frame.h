@@ -132,6 +132,13 @@ void  _mate_panel_applet_frame_update_size_hints     (MatePanelAppletFrame *fram
 char *_mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
 						 PanelWidget         *panel,
 						 PanelBackgroundType  type);
+gboolean _mate_panel_applet_frame_get_background_data (MatePanelAppletFrame    *frame,
+						 PanelWidget         *panel,
+						 PanelBackgroundType *type,
+						 GdkRGBA             *color,
+						 guint32             *xid,
+						 int                 *x,
+						 int                 *y);
 
 void  _mate_panel_applet_frame_applet_broken         (MatePanelAppletFrame *frame);
 
@@ -970,15 +970,22 @@ panel_background_free (PanelBackground *background)
 	background->default_pattern = NULL;
 }
 
-char *
-panel_background_make_string (PanelBackground *background,
-			      int              x,
-			      int              y)
+/* Structured counterpart of panel_background_make_string(), used to hand
+ * the background to applets without going through a string. On return
+ * @type is PANEL_BACK_NONE, PANEL_BACK_COLOR or PANEL_BACK_IMAGE; the
+ * latter means the composited pixmap @xid has to be used.
+ */
+gboolean
+panel_background_make_data (PanelBackground     *background,
+			    PanelBackgroundType *type,
+			    GdkRGBA             *color,
+			    guint32             *xid)
 {
 	PanelBackgroundType  effective_type;
-	char                *retval;
 
-	retval = NULL;
+	*type = PANEL_BACK_NONE;
+	*xid = 0;
+	memset (color, 0, sizeof (GdkRGBA));
 
 	effective_type = panel_background_effective_type (background);
 
@@ -988,17 +995,41 @@ panel_background_make_string (PanelBackground *background,
 		cairo_surface_t *surface;
 
 		if (!background->composited_pattern)
-			return NULL;
+			return FALSE;
 
 		if (cairo_pattern_get_surface (background->composited_pattern, &surface) != CAIRO_STATUS_SUCCESS)
-			return NULL;
+			return FALSE;
 
 		if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_XLIB)
-			return NULL;
+			return FALSE;
 
-		retval = g_strdup_printf ("pixmap:%d,%d,%d", (guint32)cairo_xlib_surface_get_drawable (surface), x, y);
+		*type = PANEL_BACK_IMAGE;
+		*xid = (guint32) cairo_xlib_surface_get_drawable (surface);
 	} else if (effective_type == PANEL_BACK_COLOR) {
-		gchar *rgba = gdk_rgba_to_string (&background->color);
+		*type = PANEL_BACK_COLOR;
+		*color = background->color;
+	}
+
+	return TRUE;
+}
+
+char *
+panel_background_make_string (PanelBackground *background,
+			      int              x,
+			      int              y)
+{
+	PanelBackgroundType  type;
+	GdkRGBA              color;
+	guint32              xid;
+	char                *retval;
+
+	if (!panel_background_make_data (background, &type, &color, &xid))
+		return NULL;
+
+	if (type == PANEL_BACK_IMAGE) {
+		retval = g_strdup_printf ("pixmap:%d,%d,%d", xid, x, y);
+	} else if (type == PANEL_BACK_COLOR) {
+		gchar *rgba = gdk_rgba_to_string (&color);
 		retval = g_strdup_printf (
 				"color:%s",
 				rgba);
@@ -113,6 +113,10 @@ void  panel_background_change_region     (PanelBackground     *background,
 char *panel_background_make_string       (PanelBackground     *background,
 					  int                  x,
 					  int                  y);
+gboolean panel_background_make_data      (PanelBackground     *background,
+					  PanelBackgroundType *type,
+					  GdkRGBA             *color,
+					  guint32             *xid);
 
 PanelBackgroundType  panel_background_get_type   (PanelBackground *background);
 const GdkRGBA       *panel_background_get_color  (PanelBackground *background);
@@ -54,6 +54,10 @@ struct _PanelDItemEditorPrivate
 	gboolean  reverting;
 	gboolean  dirty;
 	guint     save_timeout;
+	/* files are written in a thread */
+	guint     saves_in_progress;
+	gboolean  close_when_saved;
+	gboolean  disposing;
 
 	char     *uri; /* file location */
 	gboolean  type_directory;
@@ -183,7 +187,8 @@ static void setup_icon_chooser (PanelDItemEditor *dialog,
 			        const char       *icon_name);
 
 static gboolean panel_ditem_editor_save         (PanelDItemEditor *dialog,
-						 gboolean          report_errors);
+						 gboolean          report_errors,
+						 gboolean          close_when_saved);
 static gboolean panel_ditem_editor_save_timeout (gpointer data);
 static void panel_ditem_editor_revert (PanelDItemEditor *dialog);
 
@@ -350,9 +355,16 @@ panel_ditem_editor_dispose (GObject *object)
 	if (dialog->priv->save_timeout) {
 		g_source_remove (dialog->priv->save_timeout);
 		dialog->priv->save_timeout = 0;
-		panel_ditem_editor_save (dialog, FALSE);
+		panel_ditem_editor_save (dialog, FALSE, FALSE);
 	}
 
+	/* Wait for the writes, so that "saved" is only emitted once the file
+	 * is written, while the handlers are still connected */
+	dialog->priv->disposing = TRUE;
+	dialog->priv->close_when_saved = FALSE;
+	while (dialog->priv->saves_in_progress > 0)
+		g_main_context_iteration (NULL, TRUE);
+
 	/* remember, destroy can be run multiple times! */
 
 	if (dialog->priv->free_key_file && dialog->priv->key_file != NULL)
@@ -1130,6 +1142,8 @@ panel_ditem_editor_init (PanelDItemEditor *dialog)
 	priv->reverting = FALSE;
 	priv->dirty = FALSE;
 	priv->save_timeout = 0;
+	priv->saves_in_progress = 0;
+	priv->close_when_saved = FALSE;
 	priv->uri = NULL;
 	priv->type_directory = FALSE;
 	priv->new_file = TRUE;
@@ -1304,13 +1318,59 @@ panel_ditem_editor_sync_display (PanelDItemEditor *dialog)
 	}
 }
 
+typedef struct {
+	PanelDItemEditor *dialog;
+	gboolean          report_errors;
+} SaveData;
+
+static void
+panel_ditem_editor_saved (GObject      *source,
+			  GAsyncResult *result,
+			  gpointer      user_data)
+{
+	SaveData         *data = user_data;
+	PanelDItemEditor *dialog = data->dialog;
+	GError           *error = NULL;
+
+	dialog->priv->saves_in_progress--;
+
+	if (!panel_key_file_to_file_finish (result, &error)) {
+		/* try again with the next save */
+		dialog->priv->dirty = TRUE;
+		dialog->priv->close_when_saved = FALSE;
+
+		/* there is no window left to show the error on */
+		if (dialog->priv->disposing)
+			g_warning ("Could not save %s: %s",
+				   dialog->priv->uri, error->message);
+		else if (data->report_errors)
+			g_signal_emit (G_OBJECT (dialog),
+				       ditem_edit_signals[ERROR_REPORTED], 0,
+				       _("Could not save launcher"),
+				       error->message);
+		g_error_free (error);
+	} else {
+		g_signal_emit (G_OBJECT (dialog),
+			       ditem_edit_signals[SAVED], 0);
+
+		if (dialog->priv->close_when_saved &&
+		    dialog->priv->saves_in_progress == 0 &&
+		    !dialog->priv->dirty)
+			gtk_widget_destroy (GTK_WIDGET (dialog));
+	}
+
+	g_object_unref (data->dialog);
+	g_free (data);
+}
+
 static gboolean
 panel_ditem_editor_save (PanelDItemEditor *dialog,
-			 gboolean          report_errors)
+			 gboolean          report_errors,
+			 gboolean          close_when_saved)
 {
 	GKeyFile   *key_file;
 	const char *const_buf;
-	GError     *error;
+	SaveData   *data;
 
 	g_return_val_if_fail (dialog != NULL, FALSE);
 	g_return_val_if_fail (dialog->priv->save_uri != NULL ||
@@ -1320,8 +1380,15 @@ panel_ditem_editor_save (PanelDItemEditor *dialog,
 		g_source_remove (dialog->priv->save_timeout);
 	dialog->priv->save_timeout = 0;
 
-	if (!dialog->priv->dirty)
+	if (!dialog->priv->dirty) {
+		if (close_when_saved) {
+			if (dialog->priv->saves_in_progress > 0)
+				dialog->priv->close_when_saved = TRUE;
+			else
+				gtk_widget_destroy (GTK_WIDGET (dialog));
+		}
 		return TRUE;
+	}
 
 	/* Verify that the required informations are set */
 	const_buf = gtk_entry_get_text (GTK_ENTRY (dialog->priv->name_entry));
@@ -1386,23 +1453,20 @@ panel_ditem_editor_save (PanelDItemEditor *dialog,
 		}
 	}
 
-	/* And now, try to save */
-	error = NULL;
-	panel_key_file_to_file (dialog->priv->key_file,
-				dialog->priv->uri,
-				&error);
-	if (error != NULL) {
-		if (report_errors)
-			g_signal_emit (G_OBJECT (dialog),
-				       ditem_edit_signals[ERROR_REPORTED], 0,
-				       _("Could not save launcher"),
-				       error->message);
-		g_error_free (error);
-		return FALSE;
-	} else {
-		g_signal_emit (G_OBJECT (dialog),
-			       ditem_edit_signals[SAVED], 0);
-	}
+	/* And now, try to save: the result is handled in
+	 * panel_ditem_editor_saved() */
+	data = g_new0 (SaveData, 1);
+	data->dialog = g_object_ref (dialog);
+	data->report_errors = report_errors;
+
+	dialog->priv->saves_in_progress++;
+	if (close_when_saved)
+		dialog->priv->close_when_saved = TRUE;
+
+	panel_key_file_to_file_async (dialog->priv->key_file,
+				      dialog->priv->uri,
+				      panel_ditem_editor_saved,
+				      data);
 
 	dialog->priv->dirty = FALSE;
 
@@ -1415,7 +1479,7 @@ panel_ditem_editor_save_timeout (gpointer data)
 	PanelDItemEditor *dialog;
 
 	dialog = PANEL_DITEM_EDITOR (data);
-	panel_ditem_editor_save (dialog, FALSE);
+	panel_ditem_editor_save (dialog, FALSE, FALSE);
 
 	return FALSE;
 }
@@ -1445,8 +1509,8 @@ response_cb (GtkDialog *dialog,
 		break;
 	case GTK_RESPONSE_OK:
 	case GTK_RESPONSE_CLOSE:
-		if (panel_ditem_editor_save (PANEL_DITEM_EDITOR (dialog), TRUE))
-			gtk_widget_destroy (GTK_WIDGET (dialog));
+		/* the dialog is destroyed once the file is written */
+		panel_ditem_editor_save (PANEL_DITEM_EDITOR (dialog), TRUE, TRUE);
 		break;
 	case GTK_RESPONSE_DELETE_EVENT:
 		if (!PANEL_DITEM_EDITOR (dialog)->priv->new_file)
@@ -34,6 +34,7 @@
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
 #include <X11/Xlib.h>
+#include <X11/Xatom.h>
 #include <X11/keysym.h>
 
 #include <X11/extensions/XInput2.h>
@@ -48,6 +49,7 @@ static GdkFilterReturn popup_filter (GdkXEvent *gdk_xevent,
 				     GtkWidget *popup);
 
 static Atom wm_state_atom = None;
+static Atom net_client_list_atom = None;
 
 static GtkWidget *
 display_popup_window (GdkScreen *screen)
@@ -198,6 +200,121 @@ find_managed_window (Display *xdisplay,
 	return retval;
 }
 
+static GHashTable *
+get_client_list (Display *xdisplay,
+		 Window   xroot)
+{
+	GHashTable *clients;
+	gulong      nitems;
+	gulong      bytes_after;
+	gulong     *prop;
+	Atom        ret_type = None;
+	int         ret_format;
+	int         result;
+	gulong      i;
+
+	result = XGetWindowProperty (xdisplay, xroot, net_client_list_atom,
+				     0, G_MAXLONG, False, XA_WINDOW,
+				     &ret_type, &ret_format, &nitems,
+				     &bytes_after, (gpointer) &prop);
+
+	if (result != Success)
+		return NULL;
+
+	if (ret_type != XA_WINDOW || ret_format != 32) {
+		if (prop)
+			XFree (prop);
+		return NULL;
+	}
+
+	clients = g_hash_table_new (NULL, NULL);
+	for (i = 0; i < nitems; i++)
+		g_hash_table_add (clients, GSIZE_TO_POINTER (prop [i]));
+
+	XFree (prop);
+
+	return clients;
+}
+
+/* The clicked window is normally the frame the window manager reparented
+ * the client into, so the client is only a level or two below it: look
+ * for it breadth-first, which needs one XQueryTree per window visited and
+ * no property reads at all. */
+static Window
+find_client_window (Display    *xdisplay,
+		    Window      window,
+		    GHashTable *clients)
+{
+	GQueue  queue = G_QUEUE_INIT;
+	Window  retval = None;
+
+	g_queue_push_tail (&queue, GSIZE_TO_POINTER (window));
+
+	while (!g_queue_is_empty (&queue)) {
+		Window  current;
+		Window  root;
+		Window  parent;
+		Window *kids = NULL;
+		guint   nkids;
+		guint   i;
+
+		current = GPOINTER_TO_SIZE (g_queue_pop_head (&queue));
+
+		if (g_hash_table_contains (clients, GSIZE_TO_POINTER (current))) {
+			retval = current;
+			break;
+		}
+
+		if (!XQueryTree (xdisplay, current, &root, &parent, &kids, &nkids))
+			continue;
+
+		for (i = 0; i < nkids; i++)
+			g_queue_push_tail (&queue, GSIZE_TO_POINTER (kids [i]));
+
+		if (kids)
+			XFree (kids);
+	}
+
+	g_queue_clear (&queue);
+
+	return retval;
+}
+
+static Window
+resolve_managed_window (Display *xdisplay,
+			Window   window)
+{
+	GdkDisplay *display;
+	GHashTable *clients;
+	Window      retval = None;
+	gint64      start;
+
+	start = g_get_monotonic_time ();
+
+	display = gdk_x11_lookup_xdisplay (xdisplay);
+
+	/* all the requests below go through a single error trap, the
+	 * windows may be destroyed under us and failed requests are
+	 * simply treated as "not found" */
+	gdk_x11_display_error_trap_push (display);
+	clients = get_client_list (xdisplay, DefaultRootWindow (xdisplay));
+	if (clients != NULL) {
+		retval = find_client_window (xdisplay, window, clients);
+		g_hash_table_destroy (clients);
+	}
+	gdk_x11_display_error_trap_pop_ignored (display);
+
+	/* no EWMH window manager, or the window is not in its client
+	 * list (e.g. an override-redirect window): look for WM_STATE */
+	if (retval == None)
+		retval = find_managed_window (xdisplay, window);
+
+	g_debug ("Resolved managed window 0x%lx from 0x%lx in %.1f ms",
+		 retval, window, (g_get_monotonic_time () - start) / 1000.0);
+
+	return retval;
+}
+
 static void
 kill_window_response (GtkDialog *dialog,
 		      gint       response_id,
@@ -269,8 +386,10 @@ handle_button_press_event (GtkWidget *popup,
 
 	if (wm_state_atom == None)
 		wm_state_atom = XInternAtom (display, "WM_STATE", FALSE);
+	if (net_client_list_atom == None)
+		net_client_list_atom = XInternAtom (display, "_NET_CLIENT_LIST", FALSE);
 
-	window = find_managed_window (display, subwindow);
+	window = resolve_managed_window (display, subwindow);
 
 	if (window != None) {
 		if (!gdk_x11_window_lookup_for_display (gdk_x11_lookup_xdisplay (display), window))
@@ -30,6 +30,7 @@
 #include <gio/gio.h>
 #include <gdk/gdkx.h>
 
+#include <dconf.h>
 #include <libmate-desktop/mate-dconf.h>
 #include <libmate-desktop/mate-gsettings.h>
 
@@ -112,35 +113,182 @@ panel_layout_filename ()
     }
 }
 
+/* All the changes of a layout are collected here and written with a single
+ * dconf change, so that the profile only sees the final id lists */
+typedef struct {
+        const char *path;
+        const char *prefix;
+        const char *id_list_key;
+        GHashTable *used_ids;
+        GPtrArray  *new_ids;
+        int         next_n;
+} PanelLayoutIdList;
+
+typedef struct {
+        DConfChangeset    *changeset;
+        PanelLayoutIdList  toplevels;
+        PanelLayoutIdList  objects;
+} PanelLayoutTransaction;
+
+static void
+panel_layout_id_list_init (PanelLayoutIdList *list,
+                           const char        *path,
+                           const char        *prefix,
+                           const char        *id_list_key)
+{
+    gchar **existing_ids;
+    int     i;
+
+    list->path = path;
+    list->prefix = prefix;
+    list->id_list_key = id_list_key;
+    list->used_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    list->new_ids = g_ptr_array_new_with_free_func (g_free);
+    list->next_n = 0;
+
+    /* the only listing of the existing ids */
+    existing_ids = mate_dconf_list_subdirs (path, TRUE);
+    for (i = 0; existing_ids && existing_ids[i]; i++)
+        g_hash_table_add (list->used_ids, g_strdup (existing_ids[i]));
+    g_strfreev (existing_ids);
+}
+
+static void
+panel_layout_id_list_clear (PanelLayoutIdList *list)
+{
+    g_hash_table_destroy (list->used_ids);
+    g_ptr_array_free (list->new_ids, TRUE);
+}
+
+/* Same ids as panel_profile_find_new_id(), without listing dconf again */
+static char *
+panel_layout_id_list_find_new_id (PanelLayoutIdList *list)
+{
+    char *id;
+
+    for (;;) {
+        id = g_strdup_printf ("%s-%d", list->prefix, list->next_n++);
+        if (!g_hash_table_contains (list->used_ids, id))
+            return id;
+        g_free (id);
+    }
+}
+
+static void
+panel_layout_id_list_add (PanelLayoutIdList *list,
+                          const char        *id)
+{
+    g_hash_table_add (list->used_ids, g_strdup (id));
+    g_ptr_array_add (list->new_ids, g_strdup (id));
+}
+
+static void
+panel_layout_transaction_init (PanelLayoutTransaction *transaction)
+{
+    transaction->changeset = dconf_changeset_new ();
+
+    panel_layout_id_list_init (&transaction->toplevels,
+                               PANEL_TOPLEVEL_PATH,
+                               PANEL_TOPLEVEL_DEFAULT_PREFIX,
+                               PANEL_TOPLEVEL_ID_LIST_KEY);
+    panel_layout_id_list_init (&transaction->objects,
+                               PANEL_OBJECT_PATH,
+                               PANEL_OBJECT_DEFAULT_PREFIX,
+                               PANEL_OBJECT_ID_LIST_KEY);
+}
+
+static void
+panel_layout_transaction_clear (PanelLayoutTransaction *transaction)
+{
+    dconf_changeset_unref (transaction->changeset);
+
+    panel_layout_id_list_clear (&transaction->toplevels);
+    panel_layout_id_list_clear (&transaction->objects);
+}
+
+static void
+panel_layout_transaction_append_ids (PanelLayoutTransaction *transaction,
+                                     GSettings              *panel_settings,
+                                     PanelLayoutIdList      *list)
+{
+    GPtrArray  *ids;
+    gchar     **existing_ids;
+    char       *key;
+    guint       i;
+
+    if (list->new_ids->len == 0)
+        return;
+
+    existing_ids = g_settings_get_strv (panel_settings, list->id_list_key);
+
+    ids = g_ptr_array_new ();
+    for (i = 0; existing_ids[i]; i++)
+        g_ptr_array_add (ids, existing_ids[i]);
+    for (i = 0; i < list->new_ids->len; i++)
+        g_ptr_array_add (ids, g_ptr_array_index (list->new_ids, i));
+
+    key = g_strconcat (PANEL_GENERAL_PATH, list->id_list_key, NULL);
+    dconf_changeset_set (transaction->changeset, key,
+                         g_variant_new_strv ((const gchar * const *) ids->pdata,
+                                             ids->len));
+    g_free (key);
+
+    g_ptr_array_free (ids, TRUE);
+    g_strfreev (existing_ids);
+}
+
 static gboolean
-panel_layout_append_group_helper (GKeyFile                  *keyfile,
+panel_layout_transaction_commit (PanelLayoutTransaction *transaction)
+{
+    DConfClient *client;
+    GSettings   *panel_settings;
+    GError      *error = NULL;
+    gboolean     retval;
+
+    panel_settings = g_settings_new (PANEL_SCHEMA);
+    panel_layout_transaction_append_ids (transaction, panel_settings,
+                                         &transaction->toplevels);
+    panel_layout_transaction_append_ids (transaction, panel_settings,
+                                         &transaction->objects);
+    g_object_unref (panel_settings);
+
+    if (dconf_changeset_is_empty (transaction->changeset))
+        return TRUE;
+
+    client = dconf_client_new ();
+    retval = dconf_client_change_sync (client, transaction->changeset,
+                                       NULL, NULL, &error);
+    if (!retval) {
+        g_warning ("Could not apply the default layout: %s", error->message);
+        g_error_free (error);
+    }
+    g_object_unref (client);
+
+    return retval;
+}
+
+static gboolean
+panel_layout_append_group_helper (PanelLayoutTransaction    *transaction,
+                                  GKeyFile                  *keyfile,
                                   const char                *group,
                                   int                        set_screen_to,
                                   const char                *group_prefix,
-                                  char                      *id_list_key,
-                                  const char                *schema,
-                                  const char                *path_prefix,
-                                  const char                *default_prefix,
+                                  PanelLayoutIdList         *id_list,
+                                  gboolean                   is_toplevel,
                                   PanelLayoutKeyDefinition  *key_definitions,
                                   int                        key_definitions_len,
                                   const char                *type_for_error_message)
 {
-    gboolean    retval = FALSE;
     const char *id;
+    char       *screen_id = NULL;
     char       *unique_id = NULL;
     char       *path = NULL;
-    GSettings  *settings = NULL;
     char      **keyfile_keys = NULL;
+    int        *key_indexes;
     char       *value_str;
-    int         value_int;
-    gboolean    value_boolean;
+    GVariant   *value;
     int         i, j;
     GError     *error = NULL;
-    gchar     **existing_ids;
-    gboolean    existing_id = FALSE;
-    gchar      *dir = NULL;
-    gchar      *dconf_path = NULL;
-    PanelGSettingsKeyType type;
 
     /* Try to extract an id from the group, by stripping the prefix,
      * and create a unique id out of that */
@@ -157,208 +305,202 @@ panel_layout_append_group_helper (GKeyFile                  *keyfile,
         return FALSE;
     }
 
-    if (g_strcmp0 (id_list_key, PANEL_TOPLEVEL_ID_LIST_KEY) == 0) {
-        dir = "toplevels";
-        type = PANEL_GSETTINGS_TOPLEVELS;
-    }
-    if (g_strcmp0 (id_list_key, PANEL_OBJECT_ID_LIST_KEY) == 0) {
-        dir = "objects";
-        type = PANEL_GSETTINGS_OBJECTS;
-    }
+    keyfile_keys = g_key_file_get_keys (keyfile, group, NULL, NULL);
+
+    if (!keyfile_keys)
+        return FALSE;
 
-    dconf_path = g_strdup_printf (PANEL_RESOURCE_PATH "/%s", dir);
-    existing_ids = mate_dconf_list_subdirs (dconf_path, TRUE);
+    /* validate the keys from the keyfile, before writing anything */
+    key_indexes = g_new (int, g_strv_length (keyfile_keys));
 
-    if (id) {
-        if (set_screen_to > 0) {
-            id = g_strdup_printf ("%s-screen%d", id, set_screen_to);
+    for (i = 0; keyfile_keys[i] != NULL; i++) {
+        gboolean found = FALSE;
+
+        for (j = 0; j < key_definitions_len; j++) {
+            if (g_strcmp0 (keyfile_keys[i],
+                           key_definitions[j].name) == 0) {
+                found = TRUE;
+                break;
+            }
         }
-        for (i = 0; existing_ids[i]; i++) {
-                if (!strcmp (existing_ids[i], id)) {
-                    existing_id = TRUE;
-                }
+
+        if (!found) {
+            g_warning ("Unknown key '%s' for %s '%s'",
+                         keyfile_keys[i],
+                         type_for_error_message,
+                         group);
+            g_free (key_indexes);
+            g_strfreev (keyfile_keys);
+            return FALSE;
         }
+
+        key_indexes[i] = j;
+    }
+
+    if (id && set_screen_to > 0) {
+        screen_id = g_strdup_printf ("%s-screen%d", id, set_screen_to);
+        id = screen_id;
     }
-    g_strfreev (existing_ids);
-    g_free (dconf_path);
 
-    if (existing_id || !id)
-        unique_id = panel_profile_find_new_id (type);
+    if (!id || g_hash_table_contains (id_list->used_ids, id))
+        unique_id = panel_layout_id_list_find_new_id (id_list);
     else
         unique_id = g_strdup (id);
 
-    path = g_strdup_printf ("%s%s/", path_prefix, unique_id);
-    settings = g_settings_new_with_path (schema, path);
-    g_free (path);
+    g_free (screen_id);
+
+    panel_layout_id_list_add (id_list, unique_id);
+
+    /* add keys from the keyfile */
+    for (i = 0; keyfile_keys[i] != NULL; i++) {
+        j = key_indexes[i];
+
+        switch (key_definitions[j].type) {
+            case G_TYPE_STRING:
+                value_str = g_key_file_get_string (keyfile,
+                                                   group, keyfile_keys[i],
+                                                   NULL);
+                value = value_str ? g_variant_new_string (value_str) : NULL;
+                g_free (value_str);
+                break;
+
+            case G_TYPE_INT:
+                value = g_variant_new_int32 (g_key_file_get_integer (keyfile,
+                                                                     group, keyfile_keys[i],
+                                                                     NULL));
+                break;
+
+            case G_TYPE_BOOLEAN:
+                value = g_variant_new_boolean (g_key_file_get_boolean (keyfile,
+                                                                       group, keyfile_keys[i],
+                                                                       NULL));
+                break;
+            default:
+                g_assert_not_reached ();
+                value = NULL;
+                break;
+        }
 
-    keyfile_keys = g_key_file_get_keys (keyfile, group, NULL, NULL);
+        if (!value)
+            continue;
 
-    if (keyfile_keys) {
+        path = g_strdup_printf ("%s%s/%s", id_list->path, unique_id,
+                                key_definitions[j].name);
+        dconf_changeset_set (transaction->changeset, path, value);
+        g_free (path);
+    }
 
-        /* validate/add keys from the keyfile */
-        for (i = 0; keyfile_keys[i] != NULL; i++) {
-            gboolean found = FALSE;
+    if (set_screen_to != -1 && is_toplevel) {
+        path = g_strdup_printf ("%s%s/%s", id_list->path, unique_id,
+                                PANEL_TOPLEVEL_SCREEN_KEY);
+        dconf_changeset_set (transaction->changeset, path,
+                             g_variant_new_int32 (set_screen_to));
+        g_free (path);
+    }
 
-            for (j = 0; j < key_definitions_len; j++) {
-                if (g_strcmp0 (keyfile_keys[i],
-                               key_definitions[j].name) == 0) {
-                    found = TRUE;
-                    break;
-                }
-            }
+    g_free (key_indexes);
+    g_strfreev (keyfile_keys);
+    g_free (unique_id);
 
-            if (!found) {
-                g_warning ("Unknown key '%s' for %s",
-                             keyfile_keys[i],
-                             unique_id);
-                return FALSE;
-            }
+    return TRUE;
+}
 
-            switch (key_definitions[j].type) {
-                case G_TYPE_STRING:
-                    value_str = g_key_file_get_string (keyfile,
-                                                       group, keyfile_keys[i],
-                                                       NULL);
-                    if (value_str)
-                        g_settings_set_string (settings,
-                                               key_definitions[j].name,
-                                               value_str);
-                    g_free (value_str);
-                    break;
-
-                case G_TYPE_INT:
-                    value_int = g_key_file_get_integer (keyfile,
-                                                        group, keyfile_keys[i],
-                                                        NULL);
-                    g_settings_set_int (settings,
-                                        key_definitions[j].name,
-                                        value_int);
-                    break;
-
-                case G_TYPE_BOOLEAN:
-                    value_boolean = g_key_file_get_boolean (keyfile,
-                                                            group, keyfile_keys[i],
-                                                            NULL);
-                    g_settings_set_boolean (settings,
-                                            key_definitions[j].name,
-                                            value_boolean);
-                    break;
-                default:
-                    g_assert_not_reached ();
-                    break;
-            }
-        }
+static void
+panel_layout_apply_from_file (const char *layout_file,
+                              int         screen_n)
+{
+    GKeyFile    *keyfile;
+    gchar      **groups;
+    GError      *error = NULL;
+    int          i;
+    PanelLayoutTransaction transaction;
+    gint64       start;
+
+    keyfile = g_key_file_new ();
+    if (!g_key_file_load_from_file (keyfile,
+                                    layout_file,
+                                    G_KEY_FILE_NONE,
+                                    &error))
+    {
+        g_warning ("Error while parsing default layout from '%s': %s\n",
+                   layout_file, error->message);
+        g_error_free (error);
+        g_key_file_free (keyfile);
+        return;
+    }
+
+    start = g_get_monotonic_time ();
+
+    panel_layout_transaction_init (&transaction);
 
-        if (set_screen_to != -1 &&
-                g_strcmp0 (schema, PANEL_TOPLEVEL_SCHEMA) == 0)
-            g_settings_set_int (settings,
-                                PANEL_TOPLEVEL_SCREEN_KEY,
-                                set_screen_to);
+    groups = g_key_file_get_groups (keyfile, NULL);
 
-        GSettings *panel_settings;
-        panel_settings = g_settings_new (PANEL_SCHEMA);
-        mate_gsettings_append_strv (panel_settings,
-                                     id_list_key,
-                                     unique_id);
-        g_object_unref (panel_settings);
+    for (i = 0; groups[i] != NULL; i++) {
+
+        if (g_strcmp0 (groups[i], "Toplevel") == 0 ||
+                g_str_has_prefix (groups[i], "Toplevel "))
+
+            panel_layout_append_group_helper (
+                                &transaction,
+                                keyfile, groups[i],
+                                screen_n,
+                                "Toplevel",
+                                &transaction.toplevels,
+                                TRUE,
+                                panel_layout_toplevel_keys,
+                                G_N_ELEMENTS (panel_layout_toplevel_keys),
+                                "toplevel");
+
+        else if (g_strcmp0 (groups[i], "Object") == 0 ||
+                g_str_has_prefix (groups[i], "Object "))
+
+            panel_layout_append_group_helper (
+                                &transaction,
+                                keyfile, groups[i],
+                                -1,
+                                "Object",
+                                &transaction.objects,
+                                FALSE,
+                                panel_layout_object_keys,
+                                G_N_ELEMENTS (panel_layout_object_keys),
+                                "object");
+
+        else
+
+            g_warning ("Unknown group in default layout: '%s'",
+                       groups[i]);
 
-        retval = TRUE;
     }
 
-    if (keyfile_keys)
-        g_strfreev (keyfile_keys);
+    panel_layout_transaction_commit (&transaction);
 
-    if (settings)
-        g_object_unref (settings);
+    g_debug ("Applied layout '%s' (%u toplevels, %u objects) in %.1f ms",
+             layout_file,
+             transaction.toplevels.new_ids->len,
+             transaction.objects.new_ids->len,
+             (g_get_monotonic_time () - start) / 1000.0);
 
-    if (unique_id)
-        g_free (unique_id);
+    panel_layout_transaction_clear (&transaction);
 
-    return retval;
+    g_strfreev (groups);
+    g_key_file_free (keyfile);
 }
 
 void
 panel_layout_apply_default_from_gkeyfile (GdkScreen *screen)
 {
-    int          screen_n;
-    gchar       *layout_file = NULL;
-    GKeyFile    *keyfile = NULL;
-    gchar      **groups = NULL;
-    GError      *error = NULL;
-    int          i;
+    gchar *layout_file;
 
-    screen_n = gdk_x11_screen_get_screen_number (screen);
     layout_file = panel_layout_filename();
 
     if (layout_file)
     {
-        keyfile = g_key_file_new ();
-        if (g_key_file_load_from_file (keyfile,
-                                       layout_file,
-                                       G_KEY_FILE_NONE,
-                                       &error))
-        {
-            groups = g_key_file_get_groups (keyfile, NULL);
-
-            for (i = 0; groups[i] != NULL; i++) {
-
-                if (g_strcmp0 (groups[i], "Toplevel") == 0 ||
-                        g_str_has_prefix (groups[i], "Toplevel "))
-
-                    panel_layout_append_group_helper (
-                                        keyfile, groups[i],
-                                        screen_n,
-                                        "Toplevel",
-                                        PANEL_TOPLEVEL_ID_LIST_KEY,
-                                        PANEL_TOPLEVEL_SCHEMA,
-                                        PANEL_TOPLEVEL_PATH,
-                                        PANEL_TOPLEVEL_DEFAULT_PREFIX,
-                                        panel_layout_toplevel_keys,
-                                        G_N_ELEMENTS (panel_layout_toplevel_keys),
-                                        "toplevel");
-
-                else if (g_strcmp0 (groups[i], "Object") == 0 ||
-                        g_str_has_prefix (groups[i], "Object "))
-
-                    panel_layout_append_group_helper (
-                                        keyfile, groups[i],
-                                        -1,
-                                        "Object",
-                                        PANEL_OBJECT_ID_LIST_KEY,
-                                        PANEL_OBJECT_SCHEMA,
-                                        PANEL_OBJECT_PATH,
-                                        PANEL_OBJECT_DEFAULT_PREFIX,
-                                        panel_layout_object_keys,
-                                        G_N_ELEMENTS (panel_layout_object_keys),
-                                        "object");
-
-                else
-
-                    g_warning ("Unknown group in default layout: '%s'",
-                               groups[i]);
-
-            }
-
-        }
-        else
-        {
-            g_warning ("Error while parsing default layout from '%s': %s\n",
-                       layout_file, error->message);
-            g_error_free (error);
-        }
-
+        panel_layout_apply_from_file (layout_file,
+                                      gdk_x11_screen_get_screen_number (screen));
+        g_free (layout_file);
     }
     else {
         g_warning ("Cant find the layout file!");
         /* FIXME implement a fallback panel */
     }
-
-    if (groups)
-        g_strfreev (groups);
-
-    if (keyfile)
-        g_key_file_free (keyfile);
-
-    if (layout_file)
-        g_free (layout_file);
 }
@@ -33,7 +33,6 @@
 #include <gio/gio.h>
 #include <gdk/gdkx.h>
 
-#include <libpanel-util/panel-list.h>
 #include <libmate-desktop/mate-dconf.h>
 #include <libmate-desktop/mate-gsettings.h>
 
@@ -78,6 +77,8 @@ typedef void        (*PanelProfileDestroyFunc) (const char        *id);
 static GSettings *profile_settings = NULL;
 
 static GQuark toplevel_id_quark = 0;
+/* id -> PanelToplevel, for all the loaded toplevels */
+static GHashTable *toplevels_by_id = NULL;
 #if 0
 static GQuark queued_changes_quark = 0;
 #endif
@@ -86,6 +87,19 @@ static GQuark commit_timeout_quark = 0;
 static void panel_profile_object_id_list_update (gchar **objects);
 static void panel_profile_ensure_toplevel_per_screen (void);
 
+static void
+panel_profile_toplevel_disposed (gpointer  data,
+				 GObject  *toplevel)
+{
+	const char *id;
+
+	/* the id is only freed on finalize */
+	id = g_object_get_qdata (toplevel, toplevel_id_quark);
+
+	if (id && g_hash_table_lookup (toplevels_by_id, id) == toplevel)
+		g_hash_table_remove (toplevels_by_id, id);
+}
+
 static void
 panel_profile_set_toplevel_id (PanelToplevel *toplevel,
 			       const char    *id)
@@ -93,10 +107,18 @@ panel_profile_set_toplevel_id (PanelToplevel *toplevel,
 	if (!toplevel_id_quark)
 		toplevel_id_quark = g_quark_from_static_string ("panel-toplevel-id");
 
+	if (!toplevels_by_id)
+		toplevels_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, NULL);
+
 	g_object_set_qdata_full (G_OBJECT (toplevel),
 				 toplevel_id_quark,
 				 g_strdup (id),
 				 g_free);
+
+	g_hash_table_replace (toplevels_by_id, g_strdup (id), toplevel);
+	g_object_weak_ref (G_OBJECT (toplevel),
+			   panel_profile_toplevel_disposed, NULL);
 }
 
 const char *
@@ -111,17 +133,10 @@ panel_profile_get_toplevel_id (PanelToplevel *toplevel)
 PanelToplevel *
 panel_profile_get_toplevel_by_id (const char *toplevel_id)
 {
-	GSList *toplevels, *l;
-
-	if (!toplevel_id || !toplevel_id [0])
+	if (!toplevel_id || !toplevel_id [0] || !toplevels_by_id)
 		return NULL;
 
-	toplevels = panel_toplevel_list_toplevels ();
-	for (l = toplevels; l; l = l->next)
-		if (!strcmp (panel_profile_get_toplevel_id (l->data), toplevel_id))
-			return l->data;
-
-	return NULL;
+	return g_hash_table_lookup (toplevels_by_id, toplevel_id);
 }
 
 char *
@@ -1022,6 +1037,40 @@ panel_profile_delete_toplevel_objects (const char *toplevel_id)
 	g_strfreev (list);
 }
 
+gboolean
+panel_profile_toplevel_has_objects (const char *toplevel_id)
+{
+	gchar    **list;
+	gboolean   retval = FALSE;
+	int        i;
+
+	if (!toplevel_id || !toplevel_id [0])
+		return FALSE;
+
+	list = g_settings_get_strv (profile_settings, PANEL_OBJECT_ID_LIST_KEY);
+
+	for (i = 0; list[i] && !retval; i++) {
+		char *path;
+		char *parent_toplevel_id;
+		GSettings *settings;
+
+		path = g_strdup_printf (PANEL_OBJECT_PATH "%s/", list[i]);
+		settings = g_settings_new_with_path (PANEL_OBJECT_SCHEMA, path);
+		parent_toplevel_id = g_settings_get_string (settings, PANEL_OBJECT_TOPLEVEL_ID_KEY);
+		g_free (path);
+		g_object_unref (settings);
+
+		if (parent_toplevel_id && !strcmp (toplevel_id, parent_toplevel_id))
+			retval = TRUE;
+
+		g_free (parent_toplevel_id);
+	}
+
+	g_strfreev (list);
+
+	return retval;
+}
+
 void
 panel_profile_delete_toplevel (PanelToplevel *toplevel)
 {
@@ -1340,66 +1389,59 @@ panel_profile_delete_dir (PanelGSettingsKeyType  type,
 	}
 }
 
-static gboolean
-panel_profile_object_exists (GSList                *list,
-			     const char            *id,
-			     PanelProfileGetIdFunc  get_id_func)
+/* Returns the set of ids in a id list, which might contain duplicates */
+static GHashTable *
+panel_profile_id_set_new (gchar **id_list)
 {
-	GSList *l;
+	GHashTable *id_set;
+	int         i;
 
-	if (!list || !id)
-		return FALSE;
-
-	for (l = list; l; l = l->next) {
-		const char *check_id;
+	id_set = g_hash_table_new (g_str_hash, g_str_equal);
 
-		check_id = get_id_func (l->data);
-		g_assert (check_id != NULL);
+	for (i = 0; id_list && id_list[i]; i++)
+		g_hash_table_add (id_set, id_list[i]);
 
-		if (!strcmp (check_id, id))
-			return TRUE;
-	}
-
-	return FALSE;
-}
-
-static gboolean
-panel_profile_id_exists (GSList     *id_list,
-			 const char *id)
-{
-	GSList *l;
-
-	if (!id_list || !id)
-		return FALSE;
-
-	for (l = id_list; l; l = l->next) {
-		const char *check_id = l->data;
-
-		if (!strcmp (id, check_id))
-			return TRUE;
-	}
-
-	return FALSE;
+	return id_set;
 }
 
 static void
 panel_profile_load_added_ids (GSList                 *list,
-							  GSList                 *id_list,
+							  gchar                 **id_list,
 							  PanelProfileGetIdFunc   get_id_func,
 							  PanelProfileLoadFunc    load_handler,
 							  PanelProfileOnLoadQueue on_load_queue)
 {
+	GHashTable *known_ids;
 	GSList *added_ids = NULL;
 	GSList *l;
+	int     i;
 
-	for (l = id_list; l; l = l->next) {
-		const char *id = l->data;
+	known_ids = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (l = list; l; l = l->next) {
+		const char *id;
+
+		id = get_id_func (l->data);
+		g_assert (id != NULL);
+
+		g_hash_table_add (known_ids, (gpointer) id);
+	}
 
-		if (!panel_profile_object_exists (list, id, get_id_func) &&
-		    (on_load_queue == NULL || !on_load_queue (id)))
+	for (i = 0; id_list && id_list[i]; i++) {
+		const char *id = id_list[i];
+
+		/* this also skips duplicates in the list */
+		if (g_hash_table_contains (known_ids, id))
+			continue;
+
+		g_hash_table_add (known_ids, (gpointer) id);
+
+		if (on_load_queue == NULL || !on_load_queue (id))
 			added_ids = g_slist_prepend (added_ids, g_strdup (id));
 	}
 
+	g_hash_table_destroy (known_ids);
+
 	for (l = added_ids; l; l = l->next) {
 		char *id;
 		id = (char *) l->data;
@@ -1417,7 +1459,7 @@ panel_profile_load_added_ids (GSList                 *list,
 static void
 panel_profile_delete_removed_ids (PanelGSettingsKeyType    type,
 								  GSList                  *list,
-								  GSList                  *id_list,
+								  GHashTable              *id_set,
 								  PanelProfileGetIdFunc    get_id_func,
 								  PanelProfileDestroyFunc  destroy_handler)
 {
@@ -1429,7 +1471,7 @@ panel_profile_delete_removed_ids (PanelGSettingsKeyType    type,
 
 		id = get_id_func (l->data);
 
-		if (!panel_profile_id_exists (id_list, id))
+		if (!g_hash_table_contains (id_set, id))
 			removed_ids = g_slist_prepend (removed_ids, g_strdup (id));
 	}
 
@@ -1451,16 +1493,11 @@ panel_profile_toplevel_id_list_notify (GSettings *settings,
 									   gpointer   user_data)
 {
 	GSList     *l, *existing_toplevels;
-	GSList     *toplevel_ids;
-	gchar     **toplevel_ids_strv;
-
-	toplevel_ids_strv = g_settings_get_strv (settings, key);
+	GHashTable *toplevel_id_set;
+	gchar     **toplevel_ids;
 
-	toplevel_ids = mate_gsettings_strv_to_gslist ((const gchar **) toplevel_ids_strv);
-	toplevel_ids = panel_g_slist_make_unique (toplevel_ids,
-						  (GCompareFunc) g_strcmp0,
-						  FALSE);
-	g_strfreev (toplevel_ids_strv);
+	toplevel_ids = g_settings_get_strv (settings, key);
+	toplevel_id_set = panel_profile_id_set_new (toplevel_ids);
 
 	existing_toplevels = NULL;
 	for (l = panel_toplevel_list_toplevels (); l; l = l->next) {
@@ -1481,51 +1518,46 @@ panel_profile_toplevel_id_list_notify (GSettings *settings,
 
 	panel_profile_delete_removed_ids (PANEL_GSETTINGS_TOPLEVELS,
 									  existing_toplevels,
-									  toplevel_ids,
+									  toplevel_id_set,
 									  (PanelProfileGetIdFunc) panel_profile_get_toplevel_id,
 									  (PanelProfileDestroyFunc) panel_profile_destroy_toplevel);
 
 	/* if there are no panels, reset layout to default */
-	if (g_slist_length (toplevel_ids) == 0)
+	if (g_hash_table_size (toplevel_id_set) == 0)
 		panel_profile_ensure_toplevel_per_screen ();
 
 	g_slist_free (existing_toplevels);
-	g_slist_free (toplevel_ids);
+	g_hash_table_destroy (toplevel_id_set);
+	g_strfreev (toplevel_ids);
 }
 
 static void
 panel_profile_object_id_list_update (gchar **objects)
 {
-	GSList *existing_applets;
-	GSList *sublist = NULL, *l;
-	GSList *object_ids;
+	GSList     *existing_applets;
+	GHashTable *object_id_set;
 
-	object_ids = mate_gsettings_strv_to_gslist ((const gchar **) objects);
-	object_ids = panel_g_slist_make_unique (object_ids,
-						(GCompareFunc) g_strcmp0,
-						FALSE);
+	object_id_set = panel_profile_id_set_new (objects);
 
+	/* both functions below don't modify the list before they're done
+	 * iterating over it, so no need to copy it */
 	existing_applets = mate_panel_applet_list_applets ();
 
-	for (l = existing_applets; l; l = l->next) {
-		AppletInfo *info = l->data;
-		sublist = g_slist_prepend (sublist, info);
-	}
-
-	panel_profile_load_added_ids (sublist,
-								  object_ids,
+	panel_profile_load_added_ids (existing_applets,
+								  objects,
 								  (PanelProfileGetIdFunc) mate_panel_applet_get_id,
 								  (PanelProfileLoadFunc) panel_profile_load_object,
 								  (PanelProfileOnLoadQueue) mate_panel_applet_on_load_queue);
 
+	existing_applets = mate_panel_applet_list_applets ();
+
 	panel_profile_delete_removed_ids (PANEL_GSETTINGS_OBJECTS,
-									  sublist,
-									  object_ids,
+									  existing_applets,
+									  object_id_set,
 									  (PanelProfileGetIdFunc) mate_panel_applet_get_id,
 									  (PanelProfileDestroyFunc) panel_profile_destroy_object);
 
-	g_slist_free (sublist);
-	g_slist_free (object_ids);
+	g_hash_table_destroy (object_id_set);
 
 	mate_panel_applet_load_queued_applets (FALSE);
 }
@@ -1541,6 +1573,18 @@ panel_profile_object_id_list_notify (GSettings *settings,
 	g_strfreev (objects);
 }
 
+/* Queues the objects that are not loaded yet, for a toplevel that was
+ * created after the initial load (eg, a drawer opened for the first time) */
+void
+panel_profile_load_toplevel_objects (void)
+{
+	gchar **objects;
+
+	objects = g_settings_get_strv (profile_settings, PANEL_OBJECT_ID_LIST_KEY);
+	panel_profile_object_id_list_update (objects);
+	g_strfreev (objects);
+}
+
 static void
 panel_profile_load_list (GSettings              *settings,
 						 PanelGSettingsKeyType   type,
@@ -1575,6 +1619,12 @@ panel_profile_ensure_toplevel_per_screen ()
 	GSList     *l;
 	GdkDisplay *display;
 	GdkScreen  *screen;
+	static gboolean applying_layout = FALSE;
+
+	/* we get called again while loading the layout if it has no
+	 * toplevel */
+	if (applying_layout)
+		return;
 
 	toplevels = panel_toplevel_list_toplevels ();
 
@@ -1592,6 +1642,19 @@ panel_profile_ensure_toplevel_per_screen ()
 	for (l = empty_screens; l; l = l->next)
 		panel_layout_apply_default_from_gkeyfile (l->data);
 
+	/* The layout is written to dconf directly, in a single change: we
+	 * get notified of it asynchronously, but we want the panels now */
+	if (empty_screens) {
+		applying_layout = TRUE;
+		panel_profile_toplevel_id_list_notify (profile_settings,
+						       PANEL_TOPLEVEL_ID_LIST_KEY,
+						       NULL);
+		panel_profile_object_id_list_notify (profile_settings,
+						     PANEL_OBJECT_ID_LIST_KEY,
+						     NULL);
+		applying_layout = FALSE;
+	}
+
 	g_slist_free (empty_screens);
 }
 
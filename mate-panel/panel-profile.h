@@ -59,6 +59,8 @@ gboolean       panel_profile_id_lists_are_writable  (void);
 void           panel_profile_create_toplevel        (GdkScreen         *screen);
 PanelToplevel *panel_profile_load_toplevel          (const char        *toplevel_id);
 void           panel_profile_delete_toplevel        (PanelToplevel     *toplevel);
+gboolean       panel_profile_toplevel_has_objects   (const char        *toplevel_id);
+void           panel_profile_load_toplevel_objects  (void);
 char          *panel_profile_prepare_object         (PanelObjectType    object_type,
 						     PanelToplevel     *toplevel,
 						     int                position,
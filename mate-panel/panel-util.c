@@ -156,16 +156,118 @@ panel_pop_window_busy (GtkWidget *window)
 	}
 }
 
+/* Results of panel_is_program_in_path(), valid until one of the PATH
+ * directories changes or PATH itself does */
+static GHashTable *program_cache = NULL;
+static GSList     *program_path_monitors = NULL;
+static char       *program_cache_path = NULL;
+static guint       program_lookups = 0;
+
+static void
+program_path_changed (GFileMonitor      *monitor,
+		      GFile             *file,
+		      GFile             *other_file,
+		      GFileMonitorEvent  event_type,
+		      gpointer           user_data)
+{
+	if (event_type == G_FILE_MONITOR_EVENT_CREATED ||
+	    event_type == G_FILE_MONITOR_EVENT_DELETED ||
+	    event_type == G_FILE_MONITOR_EVENT_MOVED_IN ||
+	    event_type == G_FILE_MONITOR_EVENT_MOVED_OUT ||
+	    event_type == G_FILE_MONITOR_EVENT_RENAMED ||
+	    event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+		g_hash_table_remove_all (program_cache);
+}
+
+static void
+program_cache_ensure (void)
+{
+	const char  *path;
+	char       **dirs;
+	int          i;
+
+	/* What g_find_program_in_path() searches when PATH is unset */
+	path = g_getenv ("PATH");
+	if (path == NULL)
+		path = "/bin:/usr/bin:.";
+
+	if (program_cache != NULL &&
+	    g_strcmp0 (path, program_cache_path) == 0)
+		return;
+
+	if (program_cache == NULL)
+		program_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, NULL);
+	else
+		g_hash_table_remove_all (program_cache);
+
+	g_slist_free_full (program_path_monitors, g_object_unref);
+	program_path_monitors = NULL;
+
+	g_free (program_cache_path);
+	program_cache_path = g_strdup (path);
+
+	dirs = g_strsplit (path, G_SEARCHPATH_SEPARATOR_S, -1);
+	for (i = 0; dirs[i] != NULL; i++) {
+		GFileMonitor *monitor;
+		GFile        *dir;
+
+		/* an empty element stands for the current directory */
+		dir = g_file_new_for_path (dirs[i][0] != '\0' ? dirs[i] : ".");
+		monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_WATCH_MOVES,
+						    NULL, NULL);
+		g_object_unref (dir);
+
+		if (monitor == NULL)
+			continue;
+
+		g_signal_connect (monitor, "changed",
+				  G_CALLBACK (program_path_changed), NULL);
+		program_path_monitors = g_slist_prepend (program_path_monitors,
+							 monitor);
+	}
+	g_strfreev (dirs);
+}
+
 gboolean
 panel_is_program_in_path (const char *program)
 {
-	char *tmp = g_find_program_in_path (program);
-	if (tmp != NULL) {
+	gpointer  cached;
+	char     *tmp;
+	gboolean  found;
+
+	/* only lookups in PATH are cached */
+	if (strchr (program, G_DIR_SEPARATOR) != NULL) {
+		program_lookups++;
+		tmp = g_find_program_in_path (program);
+		found = tmp != NULL;
 		g_free (tmp);
-		return TRUE;
-	} else {
-		return FALSE;
+		return found;
 	}
+
+	program_cache_ensure ();
+
+	if (g_hash_table_lookup_extended (program_cache, program,
+					  NULL, &cached))
+		return GPOINTER_TO_INT (cached);
+
+	program_lookups++;
+	tmp = g_find_program_in_path (program);
+	found = tmp != NULL;
+	g_free (tmp);
+
+	g_hash_table_insert (program_cache, g_strdup (program),
+			     GINT_TO_POINTER (found));
+
+	return found;
+}
+
+/* Number of times panel_is_program_in_path() had to search the
+ * filesystem, as opposed to using a cached result */
+guint
+panel_get_program_lookup_count (void)
+{
+	return program_lookups;
 }
 
 static gboolean
@@ -376,7 +478,8 @@ panel_load_icon (GtkIconTheme  *icon_theme,
 	}
 
 	g_free (file);
-	g_object_unref (pixbuf);
+	if (pixbuf)
+		g_object_unref (pixbuf);
 
 	return surface;
 }
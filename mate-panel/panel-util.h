@@ -19,6 +19,7 @@ void		panel_push_window_busy	(GtkWidget *window);
 void		panel_pop_window_busy	(GtkWidget *window);
 
 gboolean	panel_is_program_in_path (const char *program);
+guint		panel_get_program_lookup_count (void);
 
 gboolean	panel_is_uri_writable	(const char *uri);
 gboolean	panel_uri_exists	(const char *uri);
@@ -85,10 +85,13 @@ orientation_change (AppletInfo  *info,
 		Drawer      *drawer = info->data;
 		PanelWidget *panel_widget;
 
-		panel_widget = panel_toplevel_get_panel_widget (drawer->toplevel);
-
 		button_widget_set_orientation (BUTTON_WIDGET (info->widget), orientation);
 
+		if (!drawer->toplevel)
+			break;
+
+		panel_widget = panel_toplevel_get_panel_widget (drawer->toplevel);
+
 		gtk_widget_queue_resize (GTK_WIDGET (drawer->toplevel));
 		gtk_container_foreach (GTK_CONTAINER (panel_widget),
 				       orient_change_foreach,
@@ -0,0 +1,298 @@
+/*
+ * test-drawers.c: checks that drawers are loaded lazily and measures what
+ * it saves at startup
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* Loads a profile with a panel holding many drawers full of launchers,
+ * the way the panel does at startup, and reports the time and resident
+ * memory it took. Only the drawer buttons may be loaded then. All the
+ * drawers are then opened, which loads their toplevels and launchers:
+ * that is the part every startup paid for before drawers were lazy.
+ *
+ * Needs an X display, such as "xvfb-run make check". */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "applet.h"
+#include "drawer.h"
+#include "panel-config-global.h"
+#include "panel-lockdown.h"
+#include "panel-multiscreen.h"
+#include "panel-profile.h"
+#include "panel-schemas.h"
+#include "panel-stock-icons.h"
+#include "test-panel-env.h"
+
+/* globals, from main.c */
+GSList *panels = NULL;
+GSList *panel_list = NULL;
+
+static gint n_drawers = 20;
+static gint n_launchers = 20;
+
+static GOptionEntry entries[] = {
+	{ "drawers", 0, 0, G_OPTION_ARG_INT, &n_drawers,
+	  "Drawers on the panel (default: 20)", "N" },
+	{ "launchers", 0, 0, G_OPTION_ARG_INT, &n_launchers,
+	  "Launchers in each drawer (default: 20)", "N" },
+	{ NULL }
+};
+
+static void
+set_string (DConfChangeset *changeset,
+	    const char     *dir,
+	    const char     *id,
+	    const char     *key,
+	    const char     *value)
+{
+	char *path;
+
+	path = g_strdup_printf ("%s%s/%s", dir, id, key);
+	dconf_changeset_set (changeset, path, g_variant_new_string (value));
+	g_free (path);
+}
+
+static void
+set_int (DConfChangeset *changeset,
+	 const char     *dir,
+	 const char     *id,
+	 const char     *key,
+	 int             value)
+{
+	char *path;
+
+	path = g_strdup_printf ("%s%s/%s", dir, id, key);
+	dconf_changeset_set (changeset, path, g_variant_new_int32 (value));
+	g_free (path);
+}
+
+static gboolean
+write_profile (void)
+{
+	DConfChangeset *changeset;
+	GPtrArray      *object_ids;
+	const char     *toplevel_ids[] = { "top", NULL };
+	char           *launcher;
+	gboolean        retval;
+	int             i;
+	int             j;
+
+	launcher = g_build_filename (test_panel_env_get_dir (), "test.desktop", NULL);
+	if (!g_file_set_contents (launcher,
+				  "[Desktop Entry]\n"
+				  "Type=Application\n"
+				  "Name=Test\n"
+				  "Exec=true\n"
+				  "Icon=application-x-executable\n",
+				  -1, NULL)) {
+		g_free (launcher);
+		return FALSE;
+	}
+
+	changeset = dconf_changeset_new ();
+	object_ids = g_ptr_array_new_with_free_func (g_free);
+
+	dconf_changeset_set (changeset, PANEL_GENERAL_PATH PANEL_TOPLEVEL_ID_LIST_KEY,
+			     g_variant_new_strv (toplevel_ids, -1));
+	set_string (changeset, PANEL_TOPLEVEL_PATH, "top",
+		    PANEL_TOPLEVEL_ORIENTATION_KEY, "top");
+	set_int (changeset, PANEL_TOPLEVEL_PATH, "top",
+		 PANEL_TOPLEVEL_SIZE_KEY, 24);
+
+	for (i = 0; i < n_drawers; i++) {
+		char *drawer_id;
+		char *toplevel_id;
+
+		drawer_id = g_strdup_printf ("drawer-%d", i);
+		toplevel_id = g_strdup_printf ("drawer-toplevel-%d", i);
+
+		set_string (changeset, PANEL_OBJECT_PATH, drawer_id,
+			    PANEL_OBJECT_TYPE_KEY, "drawer");
+		set_string (changeset, PANEL_OBJECT_PATH, drawer_id,
+			    PANEL_OBJECT_TOPLEVEL_ID_KEY, "top");
+		set_int (changeset, PANEL_OBJECT_PATH, drawer_id,
+			 PANEL_OBJECT_POSITION_KEY, i);
+		set_string (changeset, PANEL_OBJECT_PATH, drawer_id,
+			    PANEL_OBJECT_ATTACHED_TOPLEVEL_ID_KEY, toplevel_id);
+		g_ptr_array_add (object_ids, drawer_id);
+
+		set_string (changeset, PANEL_TOPLEVEL_PATH, toplevel_id,
+			    PANEL_TOPLEVEL_ORIENTATION_KEY, "top");
+
+		for (j = 0; j < n_launchers; j++) {
+			char *id;
+
+			id = g_strdup_printf ("drawer-%d-launcher-%d", i, j);
+			set_string (changeset, PANEL_OBJECT_PATH, id,
+				    PANEL_OBJECT_TYPE_KEY, "launcher");
+			set_string (changeset, PANEL_OBJECT_PATH, id,
+				    PANEL_OBJECT_TOPLEVEL_ID_KEY, toplevel_id);
+			set_int (changeset, PANEL_OBJECT_PATH, id,
+				 PANEL_OBJECT_POSITION_KEY, j);
+			set_string (changeset, PANEL_OBJECT_PATH, id,
+				    PANEL_OBJECT_LAUNCHER_LOCATION_KEY, launcher);
+			g_ptr_array_add (object_ids, id);
+		}
+
+		g_free (toplevel_id);
+	}
+
+	dconf_changeset_set (changeset, PANEL_GENERAL_PATH PANEL_OBJECT_ID_LIST_KEY,
+			     g_variant_new_strv ((const char * const *) object_ids->pdata,
+						 object_ids->len));
+
+	retval = test_panel_env_write (changeset);
+
+	g_ptr_array_free (object_ids, TRUE);
+	dconf_changeset_unref (changeset);
+	g_free (launcher);
+
+	return retval;
+}
+
+static gboolean
+n_objects_loaded (gpointer data)
+{
+	return g_slist_length (mate_panel_applet_list_applets ()) >= GPOINTER_TO_UINT (data);
+}
+
+static gboolean
+check_loaded (guint n_expected)
+{
+	GSList *l;
+	guint   n_loaded;
+
+	n_loaded = g_slist_length (mate_panel_applet_list_applets ());
+	if (n_loaded != n_expected) {
+		g_printerr ("%u objects loaded, %u expected\n", n_loaded, n_expected);
+		return FALSE;
+	}
+
+	for (l = mate_panel_applet_list_applets (); l; l = l->next) {
+		AppletInfo *info = l->data;
+		Drawer     *drawer;
+
+		if (info->type != PANEL_OBJECT_DRAWER)
+			continue;
+
+		drawer = info->data;
+		if ((n_expected == (guint) n_drawers) != (drawer->toplevel == NULL)) {
+			g_printerr ("Drawer %s %s a toplevel\n",
+				    info->id, drawer->toplevel ? "has" : "has no");
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	GSList         *l;
+	guint           n_objects;
+	guint           rss;
+	gint64          start;
+	int             retval;
+
+	context = g_option_context_new ("- time startup with lazy drawers");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (n_drawers < 1 || n_launchers < 1) {
+		g_printerr ("--drawers and --launchers must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	retval = test_panel_env_up ();
+	if (retval != EXIT_SUCCESS)
+		return retval;
+
+	gdk_set_allowed_backends ("x11");
+	if (!gtk_init_check (&argc, &argv)) {
+		g_print ("No X display, skipping\n");
+		test_panel_env_down ();
+		return EXIT_SKIP;
+	}
+
+	retval = EXIT_FAILURE;
+
+	if (!write_profile ())
+		goto out;
+
+	panel_multiscreen_init ();
+	panel_init_stock_icons_and_items ();
+	panel_global_config_load ();
+	panel_lockdown_init ();
+
+	/* Startup: only the drawer buttons get loaded */
+	rss = test_panel_env_get_rss_kb ();
+	start = g_get_monotonic_time ();
+
+	panel_profile_load ();
+	if (!test_panel_env_wait (n_objects_loaded, GUINT_TO_POINTER (n_drawers)))
+		goto out;
+
+	g_print ("Startup with %d drawers of %d launchers: %.1f ms, %+d kB RSS\n",
+		 n_drawers, n_launchers,
+		 (g_get_monotonic_time () - start) / 1000.0,
+		 (int) (test_panel_env_get_rss_kb () - rss));
+
+	if (!check_loaded (n_drawers))
+		goto out;
+
+	/* Open every drawer, as startup used to */
+	n_objects = n_drawers * (n_launchers + 1);
+	rss = test_panel_env_get_rss_kb ();
+	start = g_get_monotonic_time ();
+
+	for (l = mate_panel_applet_list_applets (); l; l = l->next) {
+		AppletInfo *info = l->data;
+
+		if (info->type == PANEL_OBJECT_DRAWER)
+			panel_drawer_ensure_toplevel (info->data);
+	}
+	if (!test_panel_env_wait (n_objects_loaded, GUINT_TO_POINTER (n_objects)))
+		goto out;
+
+	g_print ("Opening all of them afterwards: %.1f ms, %+d kB RSS\n",
+		 (g_get_monotonic_time () - start) / 1000.0,
+		 (int) (test_panel_env_get_rss_kb () - rss));
+
+	if (!check_loaded (n_objects))
+		goto out;
+
+	retval = EXIT_SUCCESS;
+
+out:
+	test_panel_env_down ();
+
+	return retval;
+}
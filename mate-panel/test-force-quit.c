@@ -0,0 +1,192 @@
+/*
+ * test-force-quit.c: checks and times how Force Quit finds the client
+ * window under the pointer in a deep window hierarchy
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* Meant for a display of its own, such as "xvfb-run make check": the test
+ * sets _NET_CLIENT_LIST on the root window, so it is skipped when a window
+ * manager already did. A frame is created with a chain of nested windows
+ * below it, each with a few siblings, and the client at the bottom. The
+ * client must be found from the frame whether or not it is listed in
+ * _NET_CLIENT_LIST, and without that property at all. */
+
+/* The functions under test are private to panel-force-quit.c */
+#include "panel-force-quit.c"
+
+#include <stdlib.h>
+
+#include <X11/Xutil.h>
+
+/* The exit status automake uses for skipped tests */
+#define EXIT_SKIP 77
+
+static gint depth = 100;
+static gint siblings = 3;
+static gint iterations = 20;
+
+static GOptionEntry entries[] = {
+	{ "depth", 0, 0, G_OPTION_ARG_INT, &depth,
+	  "Windows between the frame and the client (default: 100)", "N" },
+	{ "siblings", 0, 0, G_OPTION_ARG_INT, &siblings,
+	  "Extra windows at each level (default: 3)", "N" },
+	{ "iterations", 0, 0, G_OPTION_ARG_INT, &iterations,
+	  "Lookups timed per case (default: 20)", "N" },
+	{ NULL }
+};
+
+static Window
+create_window (Display *xdisplay,
+	       Window   parent)
+{
+	return XCreateSimpleWindow (xdisplay, parent, 0, 0, 10, 10, 0, 0, 0);
+}
+
+static void
+set_client_list (Display *xdisplay,
+		 Window  *windows,
+		 int      n_windows)
+{
+	XChangeProperty (xdisplay, DefaultRootWindow (xdisplay),
+			 net_client_list_atom, XA_WINDOW, 32,
+			 PropModeReplace, (guchar *) windows, n_windows);
+}
+
+static gboolean
+time_lookup (Display    *xdisplay,
+	     const char *name,
+	     Window      frame,
+	     Window      client)
+{
+	gint64 start;
+	Window found = None;
+	int    i;
+
+	XSync (xdisplay, False);
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < iterations; i++)
+		found = resolve_managed_window (xdisplay, frame);
+
+	g_print ("%-28s %8.2f ms/lookup\n", name,
+		 (g_get_monotonic_time () - start) / 1000.0 / iterations);
+
+	if (found != client) {
+		g_printerr ("%s: found 0x%lx instead of the client 0x%lx\n",
+			    name, found, client);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	GdkDisplay     *display;
+	Display        *xdisplay;
+	Window          root;
+	Window          frame;
+	Window          parent;
+	Window          client;
+	Window          other;
+	long            wm_state[2] = { NormalState, None };
+	Atom            type;
+	int             format;
+	gulong          nitems;
+	gulong          bytes_after;
+	guchar         *prop = NULL;
+	gboolean        ok = TRUE;
+	int             i;
+	int             j;
+
+	context = g_option_context_new ("- time finding the client window to force quit");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (depth < 1 || siblings < 0 || iterations < 1) {
+		g_printerr ("--depth and --iterations must be positive, "
+			    "--siblings can't be negative\n");
+		return EXIT_FAILURE;
+	}
+
+	gdk_set_allowed_backends ("x11");
+	if (!gtk_init_check (&argc, &argv)) {
+		g_print ("No X display, skipping\n");
+		return EXIT_SKIP;
+	}
+
+	display = gdk_display_get_default ();
+	xdisplay = GDK_DISPLAY_XDISPLAY (display);
+	root = DefaultRootWindow (xdisplay);
+
+	wm_state_atom = XInternAtom (xdisplay, "WM_STATE", False);
+	net_client_list_atom = XInternAtom (xdisplay, "_NET_CLIENT_LIST", False);
+
+	if (XGetWindowProperty (xdisplay, root, net_client_list_atom,
+				0, 0, False, AnyPropertyType, &type, &format,
+				&nitems, &bytes_after, &prop) == Success &&
+	    type != None) {
+		g_print ("A window manager is running, skipping\n");
+		if (prop)
+			XFree (prop);
+		return EXIT_SKIP;
+	}
+	if (prop)
+		XFree (prop);
+
+	frame = create_window (xdisplay, root);
+	other = create_window (xdisplay, root);
+
+	parent = frame;
+	for (i = 0; i < depth; i++) {
+		for (j = 0; j < siblings; j++)
+			create_window (xdisplay, parent);
+		parent = create_window (xdisplay, parent);
+	}
+	client = create_window (xdisplay, parent);
+
+	XChangeProperty (xdisplay, client, wm_state_atom, wm_state_atom, 32,
+			 PropModeReplace, (guchar *) wm_state, 2);
+
+	g_print ("%d levels, %d windows below the frame\n",
+		 depth, depth * (siblings + 1) + 1);
+
+	set_client_list (xdisplay, &client, 1);
+	ok &= time_lookup (xdisplay, "Listed in _NET_CLIENT_LIST", frame, client);
+
+	/* as for override-redirect windows, found through WM_STATE */
+	set_client_list (xdisplay, &other, 1);
+	ok &= time_lookup (xdisplay, "Not in _NET_CLIENT_LIST", frame, client);
+
+	XDeleteProperty (xdisplay, root, net_client_list_atom);
+	ok &= time_lookup (xdisplay, "No _NET_CLIENT_LIST", frame, client);
+
+	XDestroyWindow (xdisplay, frame);
+	XDestroyWindow (xdisplay, other);
+	XSync (xdisplay, False);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
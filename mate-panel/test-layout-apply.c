@@ -0,0 +1,186 @@
+/*
+ * test-layout-apply.c: checks and times applying a large layout
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* A layout with a panel and many objects is applied twice to an empty
+ * profile. The second time, all its ids are taken, so every object gets a
+ * new one. Both runs are timed, and the profile must end up listing each
+ * object once, with the settings of all of them written. */
+
+/* The function under test is private to panel-layout.c */
+#include "panel-layout.c"
+
+#include <stdlib.h>
+
+#include "test-panel-env.h"
+
+static gint n_objects = 500;
+
+static GOptionEntry entries[] = {
+	{ "objects", 0, 0, G_OPTION_ARG_INT, &n_objects,
+	  "Objects in the layout (default: 500)", "N" },
+	{ NULL }
+};
+
+static char *
+write_layout (void)
+{
+	GString *layout;
+	char    *filename;
+	GError  *error = NULL;
+	int      i;
+
+	layout = g_string_new ("[Toplevel top]\n"
+			       "expand=true\n"
+			       "orientation=top\n"
+			       "size=24\n");
+
+	for (i = 0; i < n_objects; i++)
+		g_string_append_printf (layout,
+					"\n[Object separator-%d]\n"
+					"object-type=separator\n"
+					"toplevel-id=top\n"
+					"position=%d\n",
+					i, i);
+
+	filename = g_build_filename (test_panel_env_get_dir (), "test.layout", NULL);
+	if (!g_file_set_contents (filename, layout->str, layout->len, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_free (filename);
+		filename = NULL;
+	}
+
+	g_string_free (layout, TRUE);
+
+	return filename;
+}
+
+static void
+time_apply (const char *name,
+	    const char *filename)
+{
+	gint64 start;
+	double ms;
+
+	start = g_get_monotonic_time ();
+	panel_layout_apply_from_file (filename, 0);
+	ms = (g_get_monotonic_time () - start) / 1000.0;
+
+	g_print ("%-22s %8.1f ms, %.3f ms/object\n", name, ms, ms / n_objects);
+}
+
+static gboolean
+check_profile (int n_expected)
+{
+	GSettings  *settings;
+	GHashTable *seen;
+	gchar     **ids;
+	gchar     **dirs;
+	gboolean    retval = TRUE;
+	int         i;
+
+	settings = g_settings_new (PANEL_SCHEMA);
+	ids = g_settings_get_strv (settings, PANEL_OBJECT_ID_LIST_KEY);
+	g_object_unref (settings);
+
+	if ((int) g_strv_length (ids) != n_expected) {
+		g_printerr ("%u objects listed, %d expected\n",
+			    g_strv_length (ids), n_expected);
+		retval = FALSE;
+	}
+
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; ids[i] != NULL; i++) {
+		if (!g_hash_table_add (seen, ids[i])) {
+			g_printerr ("Object %s listed twice\n", ids[i]);
+			retval = FALSE;
+		}
+	}
+
+	dirs = mate_dconf_list_subdirs (PANEL_OBJECT_PATH, TRUE);
+	for (i = 0; dirs && dirs[i] != NULL; i++) {
+		if (!g_hash_table_remove (seen, dirs[i])) {
+			g_printerr ("Object %s written but not listed\n", dirs[i]);
+			retval = FALSE;
+		}
+	}
+	if (g_hash_table_size (seen) != 0) {
+		g_printerr ("%u listed objects were not written\n",
+			    g_hash_table_size (seen));
+		retval = FALSE;
+	}
+
+	g_strfreev (dirs);
+	g_hash_table_destroy (seen);
+	g_strfreev (ids);
+
+	return retval;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	char           *filename;
+	int             retval;
+
+	context = g_option_context_new ("- time applying a large layout");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (n_objects < 1) {
+		g_printerr ("--objects must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	retval = test_panel_env_up ();
+	if (retval != EXIT_SUCCESS)
+		return retval;
+
+	retval = EXIT_FAILURE;
+
+	filename = write_layout ();
+	if (!filename)
+		goto out;
+
+	g_print ("Layout of %d objects\n", n_objects);
+
+	time_apply ("Empty profile", filename);
+	if (!check_profile (n_objects))
+		goto out;
+
+	time_apply ("All the ids taken", filename);
+	if (!check_profile (2 * n_objects))
+		goto out;
+
+	retval = EXIT_SUCCESS;
+
+out:
+	g_free (filename);
+	test_panel_env_down ();
+
+	return retval;
+}
@@ -0,0 +1,296 @@
+/*
+ * test-panel-env.c: a throwaway session for the panel benchmarks
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* The benchmarks run the panel code against a real dconf, so that they
+ * measure what a session does. The XDG directories point to a temporary
+ * directory and dconf-service is activated on a private session bus: the
+ * user's settings are never touched. The panel schemas are taken from
+ * the build tree, through GSETTINGS_SCHEMA_DIR. */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "panel-schemas.h"
+#include "test-panel-env.h"
+
+#define DCONF_SERVICE_NAME "ca.desrt.dconf"
+#define DCONF_WRITER_PATH  "/ca/desrt/dconf/Writer/user"
+
+/* Give up waiting for the panel after this many seconds */
+#define TIMEOUT 120
+
+static char        *env_dir = NULL;
+static GTestDBus   *env_bus = NULL;
+static DConfClient *env_client = NULL;
+
+static void
+remove_recursively (const char *path)
+{
+	GDir       *dir;
+	const char *name;
+
+	if (g_file_test (path, G_FILE_TEST_IS_DIR) &&
+	    !g_file_test (path, G_FILE_TEST_IS_SYMLINK)) {
+		dir = g_dir_open (path, 0, NULL);
+		while (dir && (name = g_dir_read_name (dir))) {
+			char *child;
+
+			child = g_build_filename (path, name, NULL);
+			remove_recursively (child);
+			g_free (child);
+		}
+		if (dir)
+			g_dir_close (dir);
+
+		g_rmdir (path);
+	} else
+		g_unlink (path);
+}
+
+static void
+set_xdg_dir (const char *variable,
+	     const char *name)
+{
+	char *path;
+
+	path = g_build_filename (env_dir, name, NULL);
+	g_mkdir (path, 0700);
+	g_setenv (variable, path, TRUE);
+	g_free (path);
+}
+
+static gboolean
+have_panel_schemas (void)
+{
+	GSettingsSchemaSource *source;
+	GSettingsSchema       *schema;
+
+	source = g_settings_schema_source_get_default ();
+	if (!source)
+		return FALSE;
+
+	schema = g_settings_schema_source_lookup (source, PANEL_SCHEMA, TRUE);
+	if (!schema)
+		return FALSE;
+
+	g_settings_schema_unref (schema);
+
+	return TRUE;
+}
+
+static void
+add_service_dirs (GTestDBus *bus)
+{
+	const char * const *dirs;
+	int                 i;
+
+	dirs = g_get_system_data_dirs ();
+	for (i = 0; dirs[i] != NULL; i++) {
+		char *path;
+
+		path = g_build_filename (dirs[i], "dbus-1", "services", NULL);
+		if (g_file_test (path, G_FILE_TEST_IS_DIR))
+			g_test_dbus_add_service_dir (bus, path);
+		g_free (path);
+	}
+}
+
+/* Activates dconf-service, if it can be found */
+static gboolean
+have_dconf_service (void)
+{
+	GDBusConnection *connection;
+	GVariant        *ret;
+	GError          *error = NULL;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	if (!connection) {
+		g_print ("%s\n", error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	ret = g_dbus_connection_call_sync (connection,
+					   DCONF_SERVICE_NAME, DCONF_WRITER_PATH,
+					   "org.freedesktop.DBus.Peer", "Ping",
+					   NULL, NULL, G_DBUS_CALL_FLAGS_NONE,
+					   -1, NULL, &error);
+	g_object_unref (connection);
+
+	if (!ret) {
+		g_print ("%s\n", error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	g_variant_unref (ret);
+
+	return TRUE;
+}
+
+/* Must be called before anything looks at the XDG directories, including
+ * gtk_init(). Returns EXIT_SUCCESS, or the status to exit with. */
+int
+test_panel_env_up (void)
+{
+	GError *error = NULL;
+	char   *display;
+
+	env_dir = g_dir_make_tmp ("mate-panel-test-XXXXXX", &error);
+	if (!env_dir) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	set_xdg_dir ("XDG_CONFIG_HOME", "config");
+	set_xdg_dir ("XDG_CACHE_HOME", "cache");
+	set_xdg_dir ("XDG_DATA_HOME", "data");
+	set_xdg_dir ("XDG_RUNTIME_DIR", "runtime");
+
+	if (!have_panel_schemas ()) {
+		g_print ("The panel schemas are not compiled in the build tree, skipping\n");
+		test_panel_env_down ();
+		return EXIT_SKIP;
+	}
+
+	/* g_test_dbus_up() unsets DISPLAY */
+	display = g_strdup (g_getenv ("DISPLAY"));
+
+	env_bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+	add_service_dirs (env_bus);
+	g_test_dbus_up (env_bus);
+
+	if (display)
+		g_setenv ("DISPLAY", display, TRUE);
+	g_free (display);
+
+	if (!have_dconf_service ()) {
+		g_print ("dconf-service can't be activated, skipping\n");
+		test_panel_env_down ();
+		return EXIT_SKIP;
+	}
+
+	env_client = dconf_client_new ();
+
+	return EXIT_SUCCESS;
+}
+
+void
+test_panel_env_down (void)
+{
+	/* let the panel's last writes reach dconf-service */
+	if (env_client)
+		g_settings_sync ();
+
+	g_clear_object (&env_client);
+
+	if (env_bus) {
+		g_test_dbus_down (env_bus);
+		g_object_unref (env_bus);
+		env_bus = NULL;
+	}
+
+	if (env_dir) {
+		remove_recursively (env_dir);
+		g_free (env_dir);
+		env_dir = NULL;
+	}
+}
+
+const char *
+test_panel_env_get_dir (void)
+{
+	return env_dir;
+}
+
+gboolean
+test_panel_env_write (DConfChangeset *changeset)
+{
+	GError *error = NULL;
+
+	if (!dconf_client_change_sync (env_client, changeset, NULL, NULL, &error)) {
+		g_printerr ("Could not write the profile: %s\n", error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	gboolean *timed_out = user_data;
+
+	*timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Iterates the main context until check() returns TRUE */
+gboolean
+test_panel_env_wait (TestPanelEnvCheckFunc check,
+		     gpointer              data)
+{
+	gboolean timed_out = FALSE;
+	guint    timeout_id;
+
+	if (check (data))
+		return TRUE;
+
+	timeout_id = g_timeout_add_seconds (TIMEOUT, timeout_cb, &timed_out);
+
+	while (!timed_out && !check (data))
+		g_main_context_iteration (NULL, TRUE);
+
+	if (timed_out) {
+		g_printerr ("Timed out after %d seconds\n", TIMEOUT);
+		return FALSE;
+	}
+
+	g_source_remove (timeout_id);
+
+	return TRUE;
+}
+
+/* Resident memory of the process, or 0 where there is no /proc */
+guint
+test_panel_env_get_rss_kb (void)
+{
+	char  *status;
+	char  *line;
+	guint  rss_kb = 0;
+
+	if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+		return 0;
+
+	line = strstr (status, "\nVmRSS:");
+	if (line)
+		rss_kb = strtoul (line + strlen ("\nVmRSS:"), NULL, 10);
+
+	g_free (status);
+
+	return rss_kb;
+}
@@ -0,0 +1,44 @@
+/*
+ * test-panel-env.h: a throwaway session for the panel benchmarks
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __TEST_PANEL_ENV_H__
+#define __TEST_PANEL_ENV_H__
+
+#include <glib.h>
+#include <dconf.h>
+
+G_BEGIN_DECLS
+
+/* The exit status automake uses for skipped tests */
+#define EXIT_SKIP 77
+
+typedef gboolean (*TestPanelEnvCheckFunc) (gpointer data);
+
+int         test_panel_env_up         (void);
+void        test_panel_env_down       (void);
+
+const char *test_panel_env_get_dir    (void);
+gboolean    test_panel_env_write      (DConfChangeset        *changeset);
+gboolean    test_panel_env_wait       (TestPanelEnvCheckFunc  check,
+				       gpointer               data);
+guint       test_panel_env_get_rss_kb (void);
+
+G_END_DECLS
+
+#endif /* __TEST_PANEL_ENV_H__ */
@@ -0,0 +1,259 @@
+/*
+ * test-profile-objects.c: times adding and removing objects one at a
+ * time on a large profile
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* Loads a profile with a panel of many separators, then adds objects to
+ * it and removes them again, one dconf change each, the way the "Add to
+ * Panel" dialog and "Remove From Panel" do. Each change goes through the
+ * object-id-list handler of the profile, which used to compare the old
+ * and new lists in quadratic time. The time until the panel has loaded
+ * or destroyed each object is reported.
+ *
+ * Needs an X display, such as "xvfb-run make check". */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "applet.h"
+#include "panel-config-global.h"
+#include "panel-lockdown.h"
+#include "panel-multiscreen.h"
+#include "panel-profile.h"
+#include "panel-schemas.h"
+#include "panel-stock-icons.h"
+#include "test-panel-env.h"
+
+/* globals, from main.c */
+GSList *panels = NULL;
+GSList *panel_list = NULL;
+
+static gint n_objects = 500;
+static gint n_changes = 50;
+
+static GOptionEntry entries[] = {
+	{ "objects", 0, 0, G_OPTION_ARG_INT, &n_objects,
+	  "Objects in the profile (default: 500)", "N" },
+	{ "changes", 0, 0, G_OPTION_ARG_INT, &n_changes,
+	  "Objects added, then removed (default: 50)", "N" },
+	{ NULL }
+};
+
+/* The object-id-list of the profile, as last written */
+static GPtrArray *object_ids = NULL;
+
+static void
+set_object_id_list (DConfChangeset *changeset)
+{
+	dconf_changeset_set (changeset, PANEL_GENERAL_PATH PANEL_OBJECT_ID_LIST_KEY,
+			     g_variant_new_strv ((const char * const *) object_ids->pdata,
+						 object_ids->len));
+}
+
+/* Adds the keys of a separator to the changeset, and its id to the list */
+static void
+add_separator (DConfChangeset *changeset,
+	       int             n)
+{
+	char *id;
+	char *path;
+
+	id = g_strdup_printf ("separator-%d", n);
+
+	path = g_strdup_printf (PANEL_OBJECT_PATH "%s/" PANEL_OBJECT_TYPE_KEY, id);
+	dconf_changeset_set (changeset, path, g_variant_new_string ("separator"));
+	g_free (path);
+
+	path = g_strdup_printf (PANEL_OBJECT_PATH "%s/" PANEL_OBJECT_TOPLEVEL_ID_KEY, id);
+	dconf_changeset_set (changeset, path, g_variant_new_string ("top"));
+	g_free (path);
+
+	path = g_strdup_printf (PANEL_OBJECT_PATH "%s/" PANEL_OBJECT_POSITION_KEY, id);
+	dconf_changeset_set (changeset, path, g_variant_new_int32 (n));
+	g_free (path);
+
+	g_ptr_array_add (object_ids, id);
+}
+
+static gboolean
+write_profile (void)
+{
+	DConfChangeset *changeset;
+	const char     *toplevel_ids[] = { "top", NULL };
+	gboolean        retval;
+	int             i;
+
+	changeset = dconf_changeset_new ();
+
+	dconf_changeset_set (changeset, PANEL_GENERAL_PATH PANEL_TOPLEVEL_ID_LIST_KEY,
+			     g_variant_new_strv (toplevel_ids, -1));
+	dconf_changeset_set (changeset,
+			     PANEL_TOPLEVEL_PATH "top/" PANEL_TOPLEVEL_ORIENTATION_KEY,
+			     g_variant_new_string ("top"));
+	dconf_changeset_set (changeset,
+			     PANEL_TOPLEVEL_PATH "top/" PANEL_TOPLEVEL_SIZE_KEY,
+			     g_variant_new_int32 (24));
+
+	for (i = 0; i < n_objects; i++)
+		add_separator (changeset, i);
+	set_object_id_list (changeset);
+
+	retval = test_panel_env_write (changeset);
+	dconf_changeset_unref (changeset);
+
+	return retval;
+}
+
+static gboolean
+n_objects_loaded (gpointer data)
+{
+	return g_slist_length (mate_panel_applet_list_applets ()) == GPOINTER_TO_UINT (data);
+}
+
+static gboolean
+add_objects (void)
+{
+	gint64 start;
+	int    i;
+
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < n_changes; i++) {
+		DConfChangeset *changeset;
+		gboolean        written;
+
+		changeset = dconf_changeset_new ();
+		add_separator (changeset, n_objects + i);
+		set_object_id_list (changeset);
+		written = test_panel_env_write (changeset);
+		dconf_changeset_unref (changeset);
+
+		if (!written ||
+		    !test_panel_env_wait (n_objects_loaded,
+					  GUINT_TO_POINTER (object_ids->len)))
+			return FALSE;
+	}
+
+	g_print ("Adding %d objects: %8.2f ms/object\n", n_changes,
+		 (g_get_monotonic_time () - start) / 1000.0 / n_changes);
+
+	return TRUE;
+}
+
+static gboolean
+remove_objects (void)
+{
+	gint64 start;
+	int    i;
+
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < n_changes; i++) {
+		DConfChangeset *changeset;
+		gboolean        written;
+
+		/* the objects the panel had before, so that ids are taken
+		 * from all over the list */
+		g_ptr_array_remove_index (object_ids, i * (n_objects / n_changes));
+
+		changeset = dconf_changeset_new ();
+		set_object_id_list (changeset);
+		written = test_panel_env_write (changeset);
+		dconf_changeset_unref (changeset);
+
+		if (!written ||
+		    !test_panel_env_wait (n_objects_loaded,
+					  GUINT_TO_POINTER (object_ids->len)))
+			return FALSE;
+	}
+
+	g_print ("Removing %d objects: %8.2f ms/object\n", n_changes,
+		 (g_get_monotonic_time () - start) / 1000.0 / n_changes);
+
+	return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	gint64          start;
+	int             retval;
+
+	context = g_option_context_new ("- time adding and removing objects");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (n_objects < 1 || n_changes < 1 || n_changes > n_objects) {
+		g_printerr ("--objects and --changes must be positive, "
+			    "with no more changes than objects\n");
+		return EXIT_FAILURE;
+	}
+
+	retval = test_panel_env_up ();
+	if (retval != EXIT_SUCCESS)
+		return retval;
+
+	gdk_set_allowed_backends ("x11");
+	if (!gtk_init_check (&argc, &argv)) {
+		g_print ("No X display, skipping\n");
+		test_panel_env_down ();
+		return EXIT_SKIP;
+	}
+
+	retval = EXIT_FAILURE;
+	object_ids = g_ptr_array_new_with_free_func (g_free);
+
+	if (!write_profile ())
+		goto out;
+
+	panel_multiscreen_init ();
+	panel_init_stock_icons_and_items ();
+	panel_global_config_load ();
+	panel_lockdown_init ();
+
+	start = g_get_monotonic_time ();
+
+	panel_profile_load ();
+	if (!test_panel_env_wait (n_objects_loaded, GUINT_TO_POINTER (object_ids->len)))
+		goto out;
+
+	g_print ("Loading %d objects: %8.1f ms\n", n_objects,
+		 (g_get_monotonic_time () - start) / 1000.0);
+
+	if (!add_objects () || !remove_objects ())
+		goto out;
+
+	retval = EXIT_SUCCESS;
+
+out:
+	g_ptr_array_free (object_ids, TRUE);
+	test_panel_env_down ();
+
+	return retval;
+}
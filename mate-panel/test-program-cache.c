@@ -0,0 +1,174 @@
+/*
+ * test-program-cache.c: checks that panel_is_program_in_path() answers
+ * repeated queries without searching PATH again
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* The menus check the same few programs every time they are built; after
+ * the first build, that must not touch the filesystem until a directory
+ * of PATH changes. */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "panel-util.h"
+
+/* Menu builds simulated per step */
+#define N_BUILDS 100
+
+/* Give up waiting for the directory monitor after this many seconds */
+#define TIMEOUT 10
+
+static const char *programs[] = {
+	"panel-test-program",
+	"panel-test-missing-program",
+	"mate-screensaver-command",
+	"xscreensaver-command"
+};
+
+static gboolean failed = FALSE;
+
+static void
+build_menus (void)
+{
+	guint i;
+	guint j;
+
+	for (i = 0; i < N_BUILDS; i++)
+		for (j = 0; j < G_N_ELEMENTS (programs); j++)
+			panel_is_program_in_path (programs[j]);
+}
+
+static void
+check_no_lookups (const char *step)
+{
+	guint lookups;
+
+	lookups = panel_get_program_lookup_count ();
+	build_menus ();
+
+	if (panel_get_program_lookup_count () != lookups) {
+		g_printerr ("%s: %u menu builds searched PATH %u times\n",
+			    step, N_BUILDS,
+			    panel_get_program_lookup_count () - lookups);
+		failed = TRUE;
+	}
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	gboolean *timed_out = user_data;
+
+	*timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Lets the directory monitors see a change, then waits for the cache to
+ * drop the result it had for the program */
+static void
+wait_for_program (gboolean expected)
+{
+	gboolean timed_out = FALSE;
+	guint    timeout_id;
+
+	timeout_id = g_timeout_add_seconds (TIMEOUT, timeout_cb, &timed_out);
+
+	while (!timed_out &&
+	       panel_is_program_in_path ("panel-test-program") != expected)
+		g_main_context_iteration (NULL, TRUE);
+
+	if (timed_out) {
+		g_printerr ("panel-test-program still %s after %d seconds\n",
+			    expected ? "missing" : "found", TIMEOUT);
+		failed = TRUE;
+		return;
+	}
+
+	g_source_remove (timeout_id);
+}
+
+int
+main (int argc, char **argv)
+{
+	GError *error = NULL;
+	char   *dir;
+	char   *program;
+
+	dir = g_dir_make_tmp ("mate-panel-test-XXXXXX", &error);
+	if (!dir) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+	program = g_build_filename (dir, "panel-test-program", NULL);
+
+	/* The default path includes the current directory, which must not
+	 * change behind the test's back */
+	g_chdir (dir);
+	g_setenv ("PATH", dir, TRUE);
+
+	if (!g_file_set_contents (program, "#!/bin/sh\n", -1, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		failed = TRUE;
+		goto out;
+	}
+	g_chmod (program, 0755);
+
+	/* The first build fills the cache */
+	if (!panel_is_program_in_path ("panel-test-program")) {
+		g_printerr ("panel-test-program not found in %s\n", dir);
+		failed = TRUE;
+		goto out;
+	}
+	build_menus ();
+
+	check_no_lookups ("Unchanged PATH");
+
+	/* Removing the program must be noticed, once */
+	g_unlink (program);
+	wait_for_program (FALSE);
+	check_no_lookups ("After removing a program");
+
+	/* And so must a new PATH */
+	g_setenv ("PATH", "/nonexistent", TRUE);
+	if (panel_is_program_in_path ("panel-test-program")) {
+		g_printerr ("panel-test-program found outside of PATH\n");
+		failed = TRUE;
+	}
+	check_no_lookups ("After changing PATH");
+
+	/* Without PATH, g_find_program_in_path() still searches a default
+	 * path, which must be cached too */
+	g_unsetenv ("PATH");
+	panel_is_program_in_path ("sh");
+	check_no_lookups ("Without PATH");
+
+out:
+	g_unlink (program);
+	g_rmdir (dir);
+	g_free (program);
+	g_free (dir);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}